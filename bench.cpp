@@ -0,0 +1,645 @@
+// Headless benchmark of the io2d canvas: draws fixed workloads into an offscreen target and
+// reports the frame rate, the CPU tessellation time and the amount of geometry submitted.
+//
+// Usage: io2d_bench [frames] [suite]
+
+// Includes Sokol GFX, Sokol GP and Sokol APP, doing all implementations. Sokol APP is only
+// needed by sokol_glue, the GL context is created with EGL without any window.
+#define SOKOL_IMPL
+#define SOKOL_GLES3
+#define SOKOL_NO_ENTRY
+#define STB_IMAGE_IMPLEMENTATION
+
+#include "sokol_app.h"
+#include "sokol_log.h"
+
+#include "io2d.h"
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+constexpr int bench_width = 1280;
+constexpr int bench_height = 720;
+constexpr int warmup_frames = 10;
+
+struct bench_suite
+{
+    const char *name;
+    void (*draw)(io2d::canvas &c);
+};
+
+// Deterministic pseudo random sequence so every run draws the same geometry.
+static float bench_random(uint32_t &state)
+{
+    state = state * 1664525u + 1013904223u;
+    return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+static sgp_point bench_point(uint32_t &state)
+{
+    return sgp_point{bench_random(state) * bench_width, bench_random(state) * bench_height};
+}
+
+static void draw_lines(io2d::canvas &c)
+{
+    uint32_t state = 1;
+    c.begin_path();
+    for (int i = 0; i < 10000; i++)
+        c.line(bench_point(state), bench_point(state));
+    c.stroke_style.width = 1.0f;
+    c.stroke_style.color = io2d::rgba_color(0xff2a9d8f);
+    c.stroke();
+}
+
+static void draw_thick_lines(io2d::canvas &c)
+{
+    uint32_t state = 2;
+    c.begin_path();
+    c.move_to(bench_point(state));
+    for (int i = 0; i < 10000; i++)
+        c.line_to(bench_point(state));
+    c.stroke_style.width = 6.0f;
+    c.stroke_style.join = io2d::line_join::round;
+    c.stroke_style.cap = io2d::line_cap::round;
+    c.stroke_style.color = io2d::rgba_color(0x80e76f51);
+    c.stroke();
+}
+
+static void draw_dashed_lines(io2d::canvas &c)
+{
+    // Same polyline as draw_thick_lines with butt dashes, the offset moves on every frame
+    static int frame = 0;
+    uint32_t state = 2;
+    c.begin_path();
+    c.move_to(bench_point(state));
+    for (int i = 0; i < 10000; i++)
+        c.line_to(bench_point(state));
+    c.stroke_style.width = 6.0f;
+    c.stroke_style.set_line_dash({24.0f, 8.0f}, (float)(frame++ % 32));
+    c.stroke_style.color = io2d::rgba_color(0x80e76f51);
+    c.stroke();
+}
+
+static void draw_ellipses(io2d::canvas &c)
+{
+    uint32_t state = 3;
+    c.begin_path();
+    for (int i = 0; i < 1000; i++)
+    {
+        sgp_point center = bench_point(state);
+        float rx = 4.0f + bench_random(state) * 40.0f;
+        float ry = 4.0f + bench_random(state) * 40.0f;
+        c.ellipse(sgp_point{center.x - rx, center.y - ry}, sgp_point{center.x + rx, center.y + ry});
+    }
+    c.fill_style.color = io2d::rgba_color(0x80264653);
+    c.fill();
+    c.stroke_style.width = 2.0f;
+    c.stroke_style.color = io2d::rgba_color(0xffe9c46a);
+    c.stroke();
+}
+
+static void draw_gradient_ellipses(io2d::canvas &c)
+{
+    // Same ellipses as draw_ellipses with gradients, the vertices are the same as the solid colors
+    static io2d::gradient fill = io2d::gradient::radial({640, 360}, 0.0f, {640, 360}, 600.0f);
+    static io2d::gradient stroke = io2d::gradient::linear({0, 0}, {bench_width, bench_height});
+    if (fill.stops.empty())
+    {
+        fill.add_color_stop(0.0f, io2d::rgba_color(0x80264653));
+        fill.add_color_stop(1.0f, io2d::rgba_color(0x80e76f51));
+        stroke.add_color_stop(0.0f, io2d::rgba_color(0xffe9c46a));
+        stroke.add_color_stop(1.0f, io2d::rgba_color(0xff2a9d8f));
+    }
+    c.fill_style.gradient = &fill;
+    c.stroke_style.gradient = &stroke;
+    draw_ellipses(c);
+}
+
+static void draw_sdf_ellipses(io2d::canvas &c)
+{
+    // Same ellipses as draw_ellipses, one antialiased quad each
+    uint32_t state = 3;
+    c.fill_style.color = io2d::rgba_color(0x80264653);
+    c.stroke_style.width = 2.0f;
+    c.stroke_style.color = io2d::rgba_color(0xffe9c46a);
+    sgp_set_blend_mode(SGP_BLENDMODE_BLEND);
+    for (int i = 0; i < 1000; i++)
+    {
+        sgp_point center = bench_point(state);
+        float rx = 4.0f + bench_random(state) * 40.0f;
+        float ry = 4.0f + bench_random(state) * 40.0f;
+        c.draw_ellipse(sgp_point{center.x - rx, center.y - ry}, sgp_point{center.x + rx, center.y + ry});
+    }
+    sgp_reset_blend_mode();
+}
+
+static void draw_panned_chart(io2d::canvas &c)
+{
+    // A chart 10 screens wide seen through the window, most segments are culled
+    uint32_t state = 9;
+    sgp_push_transform();
+    sgp_translate(-bench_width * 4.5f, 0.0f);
+    c.begin_path();
+    for (int series = 0; series < 4; series++)
+    {
+        float y = bench_height * (0.2f + 0.2f * series);
+        for (int i = 0; i < 5000; i++)
+        {
+            float x = i * bench_width * 10.0f / 5000;
+            float next_y = y + (bench_random(state) - 0.5f) * 40.0f;
+            c.line(sgp_point{x, y}, sgp_point{x + bench_width * 10.0f / 5000, next_y});
+            y = next_y;
+        }
+    }
+    c.stroke_style.width = 2.0f;
+    c.stroke_style.color = io2d::rgba_color(0xff2a9d8f);
+    c.stroke();
+    sgp_pop_transform();
+}
+
+static void draw_polygon(io2d::canvas &c)
+{
+    // Concave star, it exercises the ear clipping triangulation
+    constexpr int spikes = 2000;
+    const sgp_point center = {bench_width * 0.5f, bench_height * 0.5f};
+    c.begin_path();
+    for (int i = 0; i < spikes * 2; i++)
+    {
+        float a = i * static_cast<float>(M_PI) / spikes;
+        float r = (i & 1) ? 150.0f : 340.0f;
+        sgp_point pt = {center.x + std::cos(a) * r, center.y + std::sin(a) * r};
+        if (i == 0)
+            c.move_to(pt);
+        else
+            c.line_to(pt);
+    }
+    c.close_path();
+    c.fill_style.color = io2d::rgba_color(0xfff4a261);
+    c.fill();
+}
+
+static void draw_polygon_stencil(io2d::canvas &c)
+{
+    uint32_t state = 4;
+    c.begin_path();
+    c.move_to(bench_point(state));
+    for (int i = 0; i < 5000; i++)
+        c.line_to(bench_point(state));
+    c.close_path();
+    c.fill_style.color = io2d::rgba_color(0xff8ab17d);
+    c.fill(io2d::fill_rule::evenodd);
+}
+
+static void draw_roundrects(io2d::canvas &c)
+{
+    uint32_t state = 5;
+    c.begin_path();
+    for (int i = 0; i < 1000; i++)
+    {
+        sgp_point pt = bench_point(state);
+        float w = 20.0f + bench_random(state) * 100.0f;
+        float h = 20.0f + bench_random(state) * 60.0f;
+        c.roundrect(pt, sgp_point{pt.x + w, pt.y + h}, 8.0f, 8.0f);
+    }
+    c.fill_style.color = io2d::rgba_color(0xc0287271);
+    c.fill();
+    c.stroke_style.width = 1.5f;
+    c.stroke_style.color = io2d::rgba_color(0xffffffff);
+    c.stroke();
+}
+
+// Icons of 4 cubic curves each, like an imported SVG icon set, added to a canvas or a path
+template <typename Target>
+static void add_curve_icons(Target &c)
+{
+    uint32_t state = 11;
+    for (int i = 0; i < 1000; i++)
+    {
+        sgp_point pt = bench_point(state);
+        float s = 8.0f + bench_random(state) * 24.0f;
+        c.move_to(sgp_point{pt.x, pt.y + s});
+        c.bezier_curve_to(sgp_point{pt.x - s, pt.y + s * 0.4f}, sgp_point{pt.x - s * 0.8f, pt.y - s * 0.6f}, sgp_point{pt.x - s * 0.3f, pt.y - s * 0.6f});
+        c.bezier_curve_to(sgp_point{pt.x - s * 0.1f, pt.y - s * 0.6f}, sgp_point{pt.x, pt.y - s * 0.4f}, sgp_point{pt.x, pt.y - s * 0.2f});
+        c.bezier_curve_to(sgp_point{pt.x, pt.y - s * 0.4f}, sgp_point{pt.x + s * 0.1f, pt.y - s * 0.6f}, sgp_point{pt.x + s * 0.3f, pt.y - s * 0.6f});
+        c.bezier_curve_to(sgp_point{pt.x + s * 0.8f, pt.y - s * 0.6f}, sgp_point{pt.x + s, pt.y + s * 0.4f}, sgp_point{pt.x, pt.y + s});
+        c.close_path();
+    }
+}
+
+// The curves are flattened on every frame
+static void draw_curves(io2d::canvas &c)
+{
+    c.begin_path();
+    add_curve_icons(c);
+    c.fill_style.color = io2d::rgba_color(0xc0e76f51);
+    c.fill();
+    c.stroke_style.width = 1.5f;
+    c.stroke_style.color = io2d::rgba_color(0xff264653);
+    c.stroke();
+}
+
+// The same icons flattened once, then drawn from the cached vertices
+static void draw_cached_curves(io2d::canvas &c)
+{
+    static io2d::cached_path icons;
+    if (icons.get_path().empty())
+    {
+        c.begin_path();
+        add_curve_icons(c);
+        icons = c.make_cached_path();
+    }
+
+    c.fill_style.color = io2d::rgba_color(0xc0e76f51);
+    c.stroke_style.width = 1.5f;
+    c.stroke_style.color = io2d::rgba_color(0xff264653);
+    c.draw(icons);
+}
+
+// The same icons uploaded once into a vertex buffer, no vertex is copied per frame
+static void draw_uploaded_curves(io2d::canvas &c, io2d::static_geometry &icons, io2d::vertex_format format)
+{
+    if (icons.empty())
+    {
+        c.begin_path();
+        add_curve_icons(c);
+        io2d::cached_path p = c.make_cached_path();
+        io2d::fill_style_s fill;
+        fill.color = io2d::rgba_color(0xc0e76f51);
+        io2d::stroke_style_s stroke;
+        stroke.width = 1.5f;
+        stroke.color = io2d::rgba_color(0xff264653);
+        icons.add_fill(p.get_path(), fill);
+        icons.add_stroke(p.get_path(), stroke);
+        icons.upload(format);
+    }
+
+    c.draw(icons);
+}
+
+static void draw_static_curves(io2d::canvas &c)
+{
+    static io2d::static_geometry icons;
+    draw_uploaded_curves(c, icons, io2d::vertex_format::standard);
+}
+
+// Uploaded with 16-bit positions, 8 bytes per vertex instead of 20
+static void draw_packed_curves(io2d::canvas &c)
+{
+    static io2d::static_geometry icons;
+    draw_uploaded_curves(c, icons, io2d::vertex_format::packed);
+}
+
+// The same icons recorded into a display list by a worker thread while the frame before is
+// replayed, the frame only copies the vertices into sokol_gp
+struct curve_recorder
+{
+    io2d::display_list_pipeline lists;
+    std::mutex mutex;
+    std::condition_variable replayed;
+    uint64_t replays = 0;
+    bool running = true;
+    std::thread worker;
+
+    curve_recorder() : worker([this]
+                              { record(); })
+    {
+    }
+
+    ~curve_recorder()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        replayed.notify_one();
+        worker.join();
+    }
+
+    // Record one list per replayed frame, like a producer paced by the display
+    void record()
+    {
+        io2d::path icons;
+        add_curve_icons(icons);
+        for (uint64_t recorded = 1;; recorded++)
+        {
+            io2d::display_list &l = lists.begin_recording();
+            l.fill_style.color = io2d::rgba_color(0xc0e76f51);
+            l.fill(icons);
+            l.stroke_style.width = 1.5f;
+            l.stroke_style.color = io2d::rgba_color(0xff264653);
+            l.stroke(icons);
+            lists.end_recording();
+
+            std::unique_lock<std::mutex> lock(mutex);
+            replayed.wait(lock, [&]
+                          { return !running || replays >= recorded; });
+            if (!running)
+                return;
+        }
+    }
+};
+
+static void draw_pipelined_curves(io2d::canvas &c)
+{
+    static curve_recorder recorder;
+    c.draw(recorder.lists);
+    {
+        std::lock_guard<std::mutex> lock(recorder.mutex);
+        recorder.replays++;
+    }
+    recorder.replayed.notify_one();
+}
+
+// Grid of small widgets, each filled with its own color and outlined with 1 pixel lines, so
+// triangle and line draws alternate
+static void draw_widgets(io2d::canvas &c)
+{
+    uint32_t state = 8;
+    for (int y = 0; y < bench_height / 20; y++)
+    {
+        for (int x = 0; x < bench_width / 20; x++)
+        {
+            sgp_point pt = {x * 20.0f + 2.0f, y * 20.0f + 2.0f};
+            c.begin_path();
+            c.rectangle(pt, sgp_point{pt.x + 16.0f, pt.y + 16.0f});
+            c.fill_style.color = io2d::rgba_color(bench_random(state), bench_random(state), bench_random(state));
+            c.fill();
+            c.stroke_style.width = 1.0f;
+            c.stroke_style.color = io2d::rgba_color(0xffffffff);
+            c.stroke();
+        }
+    }
+}
+
+static void draw_widgets_unsorted(io2d::canvas &c)
+{
+    c.sort_draws = false;
+    draw_widgets(c);
+}
+
+// Icons of an atlas page, drawn by one textured draw
+static void draw_icons(io2d::canvas &c)
+{
+    static std::vector<uint32_t> icons;
+    if (icons.empty())
+    {
+        uint32_t state = 9;
+        std::vector<uint8_t> pixels(32 * 32 * 4);
+        for (int i = 0; i < 64; i++)
+        {
+            for (uint8_t &p : pixels)
+                p = (uint8_t)(bench_random(state) * 255.0f);
+            icons.push_back(io2d::image_atlas::get_default().add(pixels.data(), 32, 32));
+        }
+    }
+
+    uint32_t state = 10;
+    sgp_set_blend_mode(SGP_BLENDMODE_BLEND);
+    for (int i = 0; i < 10000; i++)
+        c.draw_image(icons[i % icons.size()], bench_point(state));
+    sgp_reset_blend_mode();
+}
+
+// A dashboard of numeric labels, each one a textured draw of its cached glyphs
+static void draw_labels(io2d::canvas &c)
+{
+    uint32_t state = 12;
+    char label[16];
+    c.fill_style.color = io2d::rgba_color(0xff264653);
+    c.text_style.size = 12.0f;
+    for (int i = 0; i < 5000; i++)
+    {
+        std::snprintf(label, sizeof(label), "%d.%02d", i % 250, i % 100);
+        c.fill_text(label, bench_point(state));
+    }
+}
+
+// Scrolled panels, each one drawing its share of the widgets through a clip: a scissor for
+// the square panels, the stencil for the rounded ones
+static void draw_clipped_panels(io2d::canvas &c)
+{
+    float w = bench_width / 4.0f;
+    float h = bench_height / 4.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        sgp_point pt = {(i % 4) * w + 4.0f, (i / 4) * h + 4.0f};
+        c.save();
+        c.begin_path();
+        if (i & 1)
+            c.roundrect(pt, sgp_point{pt.x + w - 8.0f, pt.y + h - 8.0f}, 12.0f, 12.0f);
+        else
+            c.rectangle(pt, sgp_point{pt.x + w - 8.0f, pt.y + h - 8.0f});
+        c.clip();
+        c.translate(-7.0f * i, -5.0f * i);
+        draw_widgets(c);
+        c.restore();
+    }
+}
+
+static void draw_rect_batch(io2d::canvas &c)
+{
+    static std::vector<io2d::rect_instance> rects;
+    if (rects.empty())
+    {
+        uint32_t state = 6;
+        for (int i = 0; i < 100000; i++)
+        {
+            sgp_point pt = bench_point(state);
+            rects.push_back({sgp_rect{pt.x, pt.y, 2.0f + bench_random(state) * 6.0f, 2.0f + bench_random(state) * 6.0f},
+                             io2d::rgba_color(bench_random(state), bench_random(state), bench_random(state))});
+        }
+    }
+    c.draw_rects(rects);
+}
+
+static void draw_circle_batch(io2d::canvas &c)
+{
+    static std::vector<io2d::circle_instance> circles;
+    if (circles.empty())
+    {
+        uint32_t state = 7;
+        for (int i = 0; i < 100000; i++)
+            circles.push_back({bench_point(state), 1.0f + bench_random(state) * 4.0f,
+                               io2d::rgba_color(bench_random(state), bench_random(state), bench_random(state), 0.8f)});
+    }
+    sgp_set_blend_mode(SGP_BLENDMODE_BLEND);
+    c.draw_circles(circles);
+    sgp_reset_blend_mode();
+}
+
+static const bench_suite suites[] = {
+    {"lines", draw_lines},
+    {"thick_lines", draw_thick_lines},
+    {"dashed_lines", draw_dashed_lines},
+    {"ellipses", draw_ellipses},
+    {"sdf_ellipses", draw_sdf_ellipses},
+    {"gradient_ellipses", draw_gradient_ellipses},
+    {"panned_chart", draw_panned_chart},
+    {"polygon", draw_polygon},
+    {"polygon_stencil", draw_polygon_stencil},
+    {"roundrects", draw_roundrects},
+    {"curves", draw_curves},
+    {"cached_curves", draw_cached_curves},
+    {"static_curves", draw_static_curves},
+    {"packed_curves", draw_packed_curves},
+    {"pipelined_curves", draw_pipelined_curves},
+    {"widgets", draw_widgets},
+    {"widgets_unsorted", draw_widgets_unsorted},
+    {"icons", draw_icons},
+    {"labels", draw_labels},
+    {"clipped_panels", draw_clipped_panels},
+    {"rect_batch", draw_rect_batch},
+    {"circle_batch", draw_circle_batch},
+};
+
+// Create a GL ES 3 context without any window, surfaceless when the driver supports it.
+static bool create_headless_context()
+{
+    EGLDisplay display = EGL_NO_DISPLAY;
+    auto get_platform_display = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (get_platform_display)
+        display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (display == EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr))
+        return false;
+
+    const EGLint config_attrs[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_NONE};
+    EGLConfig config;
+    EGLint count = 0;
+    if (!eglChooseConfig(display, config_attrs, &config, 1, &count) || count == 0)
+        return false;
+
+    eglBindAPI(EGL_OPENGL_ES_API);
+    const EGLint context_attrs[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 0, EGL_NONE};
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, context_attrs);
+    if (context == EGL_NO_CONTEXT)
+        return false;
+
+    const EGLint surface_attrs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surface_attrs);
+    return eglMakeCurrent(display, surface, surface, context);
+}
+
+int main(int argc, char *argv[])
+{
+    int frames = argc > 1 ? std::atoi(argv[1]) : 100;
+    const char *filter = argc > 2 ? argv[2] : nullptr;
+    if (frames <= 0)
+    {
+        std::cerr << "Usage: io2d_bench [frames] [suite]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (!create_headless_context())
+    {
+        std::cerr << "Failed to create a headless EGL context!" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Sokol GFX has no swapchain here, the defaults describe the offscreen target formats.
+    sg_desc sgdesc = {};
+    sgdesc.environment.defaults.color_format = SG_PIXELFORMAT_RGBA8;
+    sgdesc.environment.defaults.depth_format = SG_PIXELFORMAT_DEPTH_STENCIL;
+    sgdesc.environment.defaults.sample_count = 1;
+    sgdesc.logger.func = slog_func;
+    sg_setup(&sgdesc);
+    if (!sg_isvalid())
+    {
+        std::cerr << "Failed to create Sokol GFX context!" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The suites submit far more vertices than the sokol_gp defaults allow.
+    sgp_desc sgpdesc = {};
+    sgpdesc.max_vertices = 1 << 21;
+    sgpdesc.max_commands = 1 << 16;
+    sgp_setup(&sgpdesc);
+    if (!sgp_is_valid())
+    {
+        std::cerr << "Failed to create Sokol GP context: " << sgp_get_error_message(sgp_get_last_error()) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    {
+        io2d::offscreen_target target(bench_width, bench_height);
+        if (!target.valid())
+        {
+            std::cerr << "Failed to create the offscreen target!" << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        std::cout << "tessellation workers: " << io2d::job_pool::get_default().size() << std::endl;
+        std::cout << std::left << std::setw(16) << "suite" << std::right
+                  << std::setw(10) << "fps"
+                  << std::setw(12) << "frame ms"
+                  << std::setw(14) << "tessellate ms"
+                  << std::setw(12) << "flush ms"
+                  << std::setw(10) << "vertices"
+                  << std::setw(10) << "commands"
+                  << std::setw(8) << "draws"
+                  << std::setw(8) << "culled" << std::endl;
+
+        for (const bench_suite &suite : suites)
+        {
+            if (filter && std::strcmp(filter, suite.name) != 0)
+                continue;
+
+            for (int i = 0; i < warmup_frames; i++)
+            {
+                io2d::canvas c(target);
+                suite.draw(c);
+            }
+            glFinish();
+
+            // The frame rate includes the GPU time, each frame waits for the GPU to finish.
+            double tessellate_ms = 0.0;
+            double flush_ms = 0.0;
+            io2d::frame_stats last;
+            uint64_t start = stm_now();
+            for (int i = 0; i < frames; i++)
+            {
+                {
+                    io2d::canvas c(target);
+                    suite.draw(c);
+                }
+                glFinish();
+                last = io2d::frame_arena::get_default().last_stats;
+                tessellate_ms += last.tessellate_ms;
+                flush_ms += last.flush_ms;
+            }
+            double total_ms = stm_ms(stm_since(start));
+
+            std::cout << std::left << std::setw(16) << suite.name << std::right << std::fixed
+                      << std::setprecision(1) << std::setw(10) << frames * 1000.0 / total_ms
+                      << std::setprecision(3) << std::setw(12) << total_ms / frames
+                      << std::setw(14) << tessellate_ms / frames
+                      << std::setw(12) << flush_ms / frames
+                      << std::setw(10) << last.vertices
+                      << std::setw(10) << last.commands
+                      << std::setw(8) << last.gpu_draws
+                      << std::setw(8) << last.culled << std::endl;
+        }
+    }
+
+    sgp_shutdown();
+    sg_shutdown();
+    return EXIT_SUCCESS;
+}
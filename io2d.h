@@ -1,869 +1,6193 @@
 #include "sokol_gfx.h"
 #include "sokol_gp.h"
 #include "sokol_glue.h"
+#include "stb_image.h"
 
+#include "io2d_geometry.h"
+
+#include <cstddef>
 #include <cstdint>
 #include <vector>
-#include <memory>
+#include <array>
+#include <utility>
+#include <initializer_list>
 #include <cmath>
-#include <numbers>
 #include <limits>
+#include <algorithm>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <type_traits>
+#include <string>
+#include <deque>
+#include <string_view>
+#include <unordered_map>
+#include <cstring>
 
 namespace io2d
 {
 
-    class rgba_color
-    {
-    public:
-        using channel_t = float;
-
-        rgba_color() {}
-        rgba_color(channel_t r, channel_t g, channel_t b, channel_t a = 1.0f) : r(r), g(g), b(b), a(a) {}
-        rgba_color(uint32_t argb)
-        {
-            a = ((argb >> 24) & 0xff) / 255.0f;
-            r = ((argb >> 16) & 0xff) / 255.0f;
-            g = ((argb >> 8) & 0xff) / 255.0f;
-            b = (argb & 0xff) / 255.0f;
-        }
-
-    public:
-        channel_t r = 0.0f;
-        channel_t g = 0.0f;
-        channel_t b = 0.0f;
-        channel_t a = 1.0f;
-    };
-
     /**
-     * @brief Stroke style for path drawing
+     * @brief Path element types recorded in the path command stream
      */
-    class stroke_style_s
+    enum class path_verb : uint8_t
     {
-    public:
-        stroke_style_s() {}
-        stroke_style_s(const rgba_color &color) : color(color) {}
-
-    public:
-        rgba_color color;
-        float width = 1.0f;
+        line,               // 4 operands: x1, y1, x2, y2
+        rect,               // 4 operands: x1, y1, x2, y2
+        roundrect,          // 6 operands: x1, y1, x2, y2, rx, ry
+        ellipse,            // 6 operands: x1, y1, x2, y2, alpha_start, alpha_end
+        move_to,            // 2 operands: x, y
+        line_to,            // 2 operands: x, y
+        arc_to,             // 5 operands: x1, y1, x2, y2, radius
+        quadratic_curve_to, // 4 operands: cpx, cpy, x, y
+        bezier_curve_to,    // 6 operands: cp1x, cp1y, cp2x, cp2y, x, y
+        close_path          // no operands
     };
 
     /**
-     * @brief Fill style for path drawing
+     * @brief A contiguous run of path verbs that starts with a complete element
      */
-    class fill_style_s
+    class path_range
     {
     public:
-        rgba_color color;
+        size_t first_verb = 0;
+        size_t last_verb = 0;    // One past the last verb
+        size_t first_operand = 0;
+        size_t first_element = 0;
     };
 
     /**
-     * @brief Base class for path elements
+     * @brief A path stored as a flat command stream
+     *
+     * Each element is a verb followed by its packed float operands. begin() only clears the
+     * containers so, once they have grown to the size of the largest path, recording a path
+     * does not allocate. Elements are rebuilt on the stack when the path is drawn.
+     *
+     * The bounding box of every element, and of the whole path, is updated as the path is
+     * built, so elements that are not visible can be skipped without being rebuilt. The boxes
+     * hold the control points: they contain the fill, not the stroke width.
      */
-    class abstract_sub_path
+    class path
     {
     public:
-        abstract_sub_path() {}
-        virtual ~abstract_sub_path() {}
+        path() {}
 
-        virtual void stroke(const stroke_style_s &style) = 0;
-        virtual void fill(const fill_style_s &style) = 0;
-    };
+        /**
+         * @brief Copy the command stream, the scratch sub path is not copied
+         */
+        path(const path &other) : _verbs(other._verbs),
+                                  _operands(other._operands),
+                                  _element_bounds(other._element_bounds),
+                                  _bounds(other._bounds),
+                                  _current(other._current),
+                                  _start(other._start)
+        {
+        }
 
-    /**
-     * @brief A line path element
-     */
-    class path_line : public abstract_sub_path
-    {
-    public:
-        path_line(const sgp_point &pt1, const sgp_point &pt2) : _pt1(pt1),
-                                                                _pt2(pt2)
+        path &operator=(const path &other)
         {
+            _verbs = other._verbs;
+            _operands = other._operands;
+            _element_bounds = other._element_bounds;
+            _bounds = other._bounds;
+            _current = other._current;
+            _start = other._start;
+            _version++;
+            return *this;
         }
-        virtual ~path_line() {}
 
-        /**
-         * @brief Draw the line using the stroke style
-         */
-        void stroke(const stroke_style_s &style) override
+        void begin()
         {
-            sgp_set_color(style.color.r, style.color.g, style.color.b, style.color.a);
-            if (style.width == 1.0f)
-            {
-                sgp_draw_line(_pt1.x, _pt1.y, _pt2.x, _pt2.y);
-            }
-            else
-            {
-                draw_thik_line(_pt1, _pt2, style.width);
-            }
+            _verbs.clear();
+            _operands.clear();
+            _element_bounds.clear();
+            _bounds = aabb();
+            _version++;
         }
 
-        /**
-         * @brief Fill does nothing for line
-         */
-        void fill(const fill_style_s &style) override
+        void line(const sgp_point &pt1, const sgp_point &pt2)
         {
+            add(path_verb::line, {pt1.x, pt1.y, pt2.x, pt2.y});
         }
 
-        /**
-         * @brief Get an array of 4 points for draw a thick line using triangle strip
-         *
-         * 0  S   1
-         * +--+--+
-         * |    /|
-         * |   / |
-         * |  /  |
-         * | /   |
-         * |/    |
-         * +--+--+
-         * 3  E   2
-         *
-         * To draw a line with thickness starting from S end ending to E we need to create
-         * a rectangle using 2 triangles 0-1-3 and 1-3-2. This means the triangle strip must be
-         * drawn using the points in the order 0, 1, 3, 2
-         *
-         * @param start The start point
-         * @param end The end point
-         * @param thickness The line thickness
-         * @return std::vector<sgp_point> The array of points
-         */
-        static std::vector<sgp_point> get_thick_line_points(sgp_point start, sgp_point end, float thickness)
+        void rectangle(const sgp_point &pt1, const sgp_point &pt2)
         {
-            GLfloat d = std::sqrt((end.x - start.x) * (end.x - start.x) + (end.y - start.y) * (end.y - start.y));
-            GLfloat y_shift = thickness * (end.x - start.x) / (d * 2.0f);
-            GLfloat x_shift = -thickness * (end.y - start.y) / (d * 2.0f);
+            add(path_verb::rect, {pt1.x, pt1.y, pt2.x, pt2.y});
+        }
 
-            return std::vector<sgp_point>{
-                sgp_point{start.x - x_shift, start.y - y_shift},
-                sgp_point{start.x + x_shift, start.y + y_shift},
-                sgp_point{end.x + x_shift, end.y + y_shift},
-                sgp_point{end.x - x_shift, end.y - y_shift}};
+        void roundrect(const sgp_point &pt1, const sgp_point &pt2, float rx, float ry)
+        {
+            add(path_verb::roundrect, {pt1.x, pt1.y, pt2.x, pt2.y, rx, ry});
         }
 
-        /**
-         * @brief Draw a thick line using triangle strip
-         */
-        static void draw_thik_line(sgp_point start, sgp_point end, float thickness)
+        void ellipse(const sgp_point &pt1, const sgp_point &pt2, float alpha_start, float alpha_end)
         {
-            auto line_points = get_thick_line_points(start, end, thickness);
+            add(path_verb::ellipse, {pt1.x, pt1.y, pt2.x, pt2.y, alpha_start, alpha_end});
+        }
 
-            std::array<sgp_point, 4> points = {line_points[0],
-                                               line_points[1],
-                                               line_points[3],
-                                               line_points[2]};
+        void move_to(const sgp_point &pt)
+        {
+            add(path_verb::move_to, {pt.x, pt.y});
+        }
 
-            sgp_draw_filled_triangles_strip(points.data(), points.size());
+        void line_to(const sgp_point &pt)
+        {
+            add(path_verb::line_to, {pt.x, pt.y});
         }
 
-        static void draw_thik_lines(const std::vector<sgp_point> &points, float thickness)
+        void arc_to(const sgp_point &pt1, const sgp_point &pt2, float radius)
         {
-            if (points.size() < 2)
-                return;
+            add(path_verb::arc_to, {pt1.x, pt1.y, pt2.x, pt2.y, radius});
+        }
 
-            for (int i = 1; i < points.size(); i++)
-            {
-                draw_thik_line(points[i - 1], points[i], thickness);
-            }
+        void quadratic_curve_to(const sgp_point &cp, const sgp_point &pt)
+        {
+            add(path_verb::quadratic_curve_to, {cp.x, cp.y, pt.x, pt.y});
         }
 
-    protected:
-        sgp_point _pt1;
-        sgp_point _pt2;
-    };
+        void bezier_curve_to(const sgp_point &cp1, const sgp_point &cp2, const sgp_point &pt)
+        {
+            add(path_verb::bezier_curve_to, {cp1.x, cp1.y, cp2.x, cp2.y, pt.x, pt.y});
+        }
 
-    /**
-     * @brief A rectangle path element
-     */
-    class path_rect : public abstract_sub_path
-    {
-    public:
-        path_rect(const sgp_point &pt1, const sgp_point &pt2) : _pt1(pt1),
-                                                                _pt2(pt2)
+        void close_path()
         {
+            add(path_verb::close_path, {});
         }
-        virtual ~path_rect() {}
 
         /**
-         * @brief Draw the rectangle using the stroke style
+         * @brief Stroke the whole path, the geometry is built in t.output
          */
-        void stroke(const stroke_style_s &style) override
+        void stroke(const stroke_style_s &style, tessellator &t = tessellator::get_default()) const
         {
-            sgp_set_color(style.color.r, style.color.g, style.color.b, style.color.a);
-            if (style.width == 1.0f)
-            {
-                std::array<sgp_point, 5> points = {sgp_point{_pt1.x, _pt1.y},
-                                                   sgp_point{_pt2.x, _pt1.y},
-                                                   sgp_point{_pt2.x, _pt2.y},
-                                                   sgp_point{_pt1.x, _pt2.y},
-                                                   sgp_point{_pt1.x, _pt1.y}};
-                sgp_draw_lines_strip(points.data(), points.size());
-            }
-            else
-            {
-                path_line::draw_thik_line(sgp_point{_pt1.x, _pt1.y}, sgp_point{_pt2.x, _pt1.y}, style.width);
-                path_line::draw_thik_line(sgp_point{_pt2.x, _pt1.y}, sgp_point{_pt2.x, _pt2.y}, style.width);
-                path_line::draw_thik_line(sgp_point{_pt2.x, _pt2.y}, sgp_point{_pt1.x, _pt2.y}, style.width);
-                path_line::draw_thik_line(sgp_point{_pt1.x, _pt2.y}, sgp_point{_pt1.x, _pt1.y}, style.width);
-            }
+            IO2D_STATS_ADD(primitives, element_count());
+            t.output.clear();
+            tessellate_stroke(style, t.output, t);
+            t.output.draw(style.color, style.gradient);
         }
 
         /**
-         * @brief Fill the rectangle using the fill style
+         * @brief Fill the whole path, the geometry is built in t.output
          */
-        void fill(const fill_style_s &style) override
+        void fill(const fill_style_s &style, tessellator &t = tessellator::get_default()) const
         {
-            sgp_set_color(style.color.r, style.color.g, style.color.b, style.color.a);
-            sgp_draw_filled_rect(_pt1.x, _pt1.y, _pt2.x - _pt1.x, _pt2.y - _pt1.y);
+            IO2D_STATS_ADD(primitives, element_count());
+            t.output.clear();
+            tessellate_fill(t.output, t);
+            t.output.draw(style.color, style.gradient);
         }
 
-    protected:
-        sgp_point _pt1;
-        sgp_point _pt2;
-    };
-
-    /**
-     * @brief An ellipse path element
-     */
-    class path_ellipse : public abstract_sub_path
-    {
-    public:
-        struct ellipse_data
+        void tessellate_stroke(const stroke_style_s &style, geometry &out, tessellator &t) const
         {
-            float cx; // Center x
-            float cy; // Center y
-            float rx; // Radius x
-            float ry; // Radius y
-        };
+            IO2D_STATS_TIME(tessellate_ms);
+            visit(t.tolerance, [&](auto &e)
+                  { e.tessellate_stroke(style, out, t); });
+        }
 
-    public:
-        path_ellipse(const sgp_point &pt1, const sgp_point &pt2, float alpha_start = 0.0f, float alpha_end = M_PI * 2) : _pt1(pt1),
-                                                                                                                         _pt2(pt2),
-                                                                                                                         _alpha_start(alpha_start),
-                                                                                                                         _alpha_end(alpha_end)
+        void tessellate_fill(geometry &out, tessellator &t) const
         {
+            IO2D_STATS_TIME(tessellate_ms);
+            visit(t.tolerance, [&](auto &e)
+                  { e.tessellate_fill(out, t); });
         }
-        virtual ~path_ellipse() {}
 
         /**
-         * @brief Draw the ellipse using the stroke style
+         * @brief Append the triangles to draw in the stencil buffer to fill the path with a fill rule
+         *
+         * Every element outline is fanned from its first point without any triangulation, the
+         * fill rule is applied by the stencil operations. Self-intersecting outlines and holes
+         * are handled, and the cost is linear in the number of points.
+         *
+         * @param out The fan triangles
+         * @param bounds The bounding box of all the outlines, to be covered after the stencil pass
+         * @return false if the path has no area
          */
-        void stroke(const stroke_style_s &style) override
+        bool tessellate_stencil(std::vector<sgp_triangle> &out, sgp_rect &bounds, tessellator &t) const
         {
-            auto points = get_ellipse_points(_pt1, _pt2, _alpha_start, _alpha_end);
+            float min_x = std::numeric_limits<float>::max();
+            float min_y = std::numeric_limits<float>::max();
+            float max_x = std::numeric_limits<float>::lowest();
+            float max_y = std::numeric_limits<float>::lowest();
+            size_t first = out.size();
+            IO2D_STATS_TIME(tessellate_ms);
+
+            visit(t.tolerance, [&](auto &e)
+                  {
+                      t.outline.clear();
+                      e.append_outline(t.outline, t);
+                      const std::vector<sgp_point> &o = t.outline;
+                      for (size_t i = 0; i < o.size(); i++)
+                      {
+                          min_x = std::min(min_x, o[i].x);
+                          min_y = std::min(min_y, o[i].y);
+                          max_x = std::max(max_x, o[i].x);
+                          max_y = std::max(max_y, o[i].y);
+                          if (i >= 2)
+                              out.emplace_back(sgp_triangle{o[0], o[i - 1], o[i]});
+                      } });
+
+            if (out.size() == first)
+                return false;
+
+            bounds = sgp_rect{min_x, min_y, max_x - min_x, max_y - min_y};
+            return true;
+        }
 
-            sgp_set_color(style.color.r, style.color.g, style.color.b, style.color.a);
-            if (style.width == 1.0f)
-            {
-                sgp_draw_lines_strip(points.data(), points.size());
-            }
-            else
-            {
-                for (int i = 1; i < points.size() - 1; i++)
-                {
-                    path_line::draw_thik_line(points[i - 1], points[i], style.width);
-                }
-            }
+        bool empty() const
+        {
+            return _verbs.empty();
         }
 
         /**
-         * @brief Fill the ellipse using the fill style
+         * @brief Get the number of elements recorded, sub path commands included
          */
-        void fill(const fill_style_s &style) override
+        size_t element_count() const
         {
-            sgp_set_color(style.color.r, style.color.g, style.color.b, style.color.a);
-
-            auto triangles = get_ellipse_triangles(_pt1, _pt2, _alpha_start, _alpha_end);
+            return _verbs.size();
+        }
 
-            sgp_draw_filled_triangles(triangles.data(), triangles.size());
+        /**
+         * @brief Get the bounding box of all the elements, empty if the path is
+         */
+        const aabb &bounds() const
+        {
+            return _bounds;
         }
 
         /**
-         * @brief Get an array of points approximating the ellipse
-         *
-         * The number of points is calculated based on the ellipse perimeter to have a good approximation
+         * @brief Check if the path is a single rectangle
          *
-         * @param start The bounding box start point
-         * @param end The bounding box end point
-         * @param alpha_start The starting angle in radians
-         * @param alpha_end The ending angle in radians
-         * @return std::vector<sgp_point> The array of points
+         * @param out The rectangle, with x0 <= x1 and y0 <= y1
          */
-        static std::vector<sgp_point> get_ellipse_points(sgp_point start, sgp_point end, float alpha_start = 0.0f, float alpha_end = M_PI * 2)
+        bool is_rectangle(aabb &out) const
         {
-            auto ed = get_ellipse_data(start, end);
+            if (_verbs.size() != 1 || _verbs[0] != path_verb::rect)
+                return false;
 
-            float alpha = alpha_start;
-
-            float perimeter = 2 * M_PI * std::sqrt((ed.rx * ed.rx + ed.ry * ed.ry) / 2.0f);
-            float alpha_step = (2 * M_PI) / perimeter;
-
-            std::vector<sgp_point> points;
-
-            while (alpha <= alpha_end)
-            {
-                float px = ed.cx + (std::cos(alpha) * ed.rx);
-                float py = ed.cy + (std::sin(alpha) * ed.ry);
-                points.emplace_back(sgp_point{px, py});
+            out = aabb(std::min(_operands[0], _operands[2]), std::min(_operands[1], _operands[3]),
+                       std::max(_operands[0], _operands[2]), std::max(_operands[1], _operands[3]));
+            return true;
+        }
 
-                alpha += alpha_step;
-            }
+        /**
+         * @brief Get a number changed by every modification of the path
+         */
+        uint64_t version() const
+        {
+            return _version;
+        }
 
-            if (alpha_end - alpha < alpha_step)
+        /**
+         * @brief Split the path into ranges of about max_verbs verbs that can be tessellated independently
+         *
+         * Ranges are cut only where a new element starts, so a sub path is never split. Ranges
+         * are appended to out in path order.
+         */
+        void split(size_t max_verbs, std::vector<path_range> &out) const
+        {
+            path_range r;
+            size_t operand = 0;
+            size_t element = 0;
+            for (size_t i = 0; i < _verbs.size(); i++)
             {
-                alpha = alpha_end;
-                float px = ed.cx + (std::cos(alpha) * ed.rx);
-                float py = ed.cy + (std::sin(alpha) * ed.ry);
-                points.emplace_back(sgp_point{px, py});
+                path_verb v = _verbs[i];
+                if (starts_element(v) && i - r.first_verb >= max_verbs)
+                {
+                    r.last_verb = i;
+                    out.emplace_back(r);
+                    r.first_verb = i;
+                    r.first_operand = operand;
+                    r.first_element = element;
+                }
+                operand += operand_count(v);
+                if (starts_element(v) || i == 0)
+                    element++;
             }
 
-            return points;
+            r.last_verb = _verbs.size();
+            if (r.last_verb > r.first_verb)
+                out.emplace_back(r);
         }
 
-        static std::vector<sgp_triangle> get_ellipse_triangles(sgp_point start, sgp_point end, float alpha_start = 0.0f, float alpha_end = M_PI * 2)
+        /**
+         * @brief Get the number of float operands following a verb
+         */
+        static size_t operand_count(path_verb v)
         {
-            auto points = get_ellipse_points(start, end, alpha_start, alpha_end);
-            auto ed = get_ellipse_data(start, end);
-            sgp_point center_point{ed.cx, ed.cy};
-            std::vector<sgp_triangle> triangles;
-
-            for (int i = 1; i < points.size(); i++)
+            switch (v)
             {
-                sgp_triangle t{center_point, points[i - 1], points[i]};
-                triangles.emplace_back(t);
+            case path_verb::line:
+            case path_verb::rect:
+            case path_verb::quadratic_curve_to:
+                return 4;
+            case path_verb::roundrect:
+            case path_verb::ellipse:
+            case path_verb::bezier_curve_to:
+                return 6;
+            case path_verb::move_to:
+            case path_verb::line_to:
+                return 2;
+            case path_verb::arc_to:
+                return 5;
+            case path_verb::close_path:
+                break;
             }
-
-            return triangles;
+            return 0;
         }
 
-        static ellipse_data get_ellipse_data(sgp_point start, sgp_point end)
+        /**
+         * @brief Check if a verb starts an element, the other verbs extend the sub path before them
+         *
+         * Verbs extending nothing, at the start of the path, form an element too.
+         */
+        static bool starts_element(path_verb v)
         {
-            ellipse_data e;
+            return v != path_verb::line_to && v != path_verb::arc_to && v != path_verb::quadratic_curve_to &&
+                   v != path_verb::bezier_curve_to && v != path_verb::close_path;
+        }
 
-            e.rx = (end.x - start.x) / 2.0f;
-            e.ry = (end.y - start.y) / 2.0f;
-            e.cx = start.x + e.rx;
-            e.cy = start.y + e.ry;
+        /**
+         * @brief Check if the last element is a sub path that line_to/arc_to/curves can extend
+         */
+        bool has_open_sub_path() const
+        {
+            if (_verbs.empty())
+                return false;
 
-            return e;
+            path_verb v = _verbs.back();
+            return v == path_verb::move_to || !starts_element(v);
         }
 
-    protected:
-        sgp_point _pt1;
-        sgp_point _pt2;
-        float _alpha_start;
-        float _alpha_end;
-    };
-
-    /**
-     * @brief A rounded rectangle path element
-     */
-    class path_roundrect : public abstract_sub_path
-    {
-    public:
-        path_roundrect(const sgp_point &pt1, const sgp_point &pt2, float rx, float ry) : _pt1(pt1),
-                                                                                         _pt2(pt2),
-                                                                                         _rx(rx),
-                                                                                         _ry(ry)
+        /**
+         * @brief Rebuild each element on the stack and pass it to the visitor
+         *
+         * Sub paths are accumulated in a scratch sub_path reused between calls.
+         *
+         * @param tolerance The maximum chord error of the arcs and curves added to sub paths, in path units
+         */
+        template <typename Visitor>
+        void visit(float tolerance, Visitor &&visitor) const
         {
+            visit(path_range{0, _verbs.size(), 0, 0}, tolerance, _sub_path, nullptr, visitor);
         }
-        virtual ~path_roundrect() {}
 
         /**
-         * @brief Draw the rounded rectangle using the stroke style
+         * @brief Rebuild the elements of a range, see split()
+         *
+         * The path is only read, so ranges can be visited from several threads at once as long
+         * as each thread gives its own scratch sub path.
+         *
+         * @param cull When not null, the elements whose bounding box is outside of it are skipped
+         * @return The number of elements skipped
          */
-        void stroke(const stroke_style_s &style) override
+        template <typename Visitor>
+        size_t visit(const path_range &range, float tolerance, sub_path &scratch, const aabb *cull, Visitor &&visitor) const
         {
-            auto arc_top_left = path_ellipse::get_ellipse_points(sgp_point{_pt1.x, _pt1.y},
-                                                                 sgp_point{_pt1.x + _rx * 2, _pt1.y + _ry * 2},
-                                                                 M_PI,
-                                                                 M_PI_2 * 3.0f);
+            const float *op = _operands.data() + range.first_operand;
+            size_t element = range.first_element;
+            size_t culled = 0;
+            bool hidden = false;
+            bool sub_path_open = false;
 
-            auto arc_top_right = path_ellipse::get_ellipse_points(sgp_point{_pt2.x - _rx * 2, _pt1.y},
-                                                                  sgp_point{_pt2.x, _pt1.y + _ry * 2},
-                                                                  M_PI_2 * 3.0f,
-                                                                  M_PI * 2.0f);
-
-            auto arc_bottom_right = path_ellipse::get_ellipse_points(sgp_point{_pt2.x - _rx * 2, _pt2.y - _ry * 2},
-                                                                     sgp_point{_pt2.x, _pt2.y},
-                                                                     0,
-                                                                     M_PI_2);
-
-            auto arc_bottom_left = path_ellipse::get_ellipse_points(sgp_point{_pt1.x, _pt2.y - _ry * 2},
-                                                                    sgp_point{_pt1.x + _rx * 2, _pt2.y},
-                                                                    M_PI_2,
-                                                                    M_PI);
-
-            sgp_set_color(style.color.r, style.color.g, style.color.b, style.color.a);
-
-            if (style.width == 1.0f)
+            auto flush_sub_path = [&]()
             {
-                std::array<sgp_line, 4> lines = {sgp_line{sgp_point{_pt1.x + _rx, _pt1.y}, sgp_point{_pt2.x - _rx, _pt1.y}},
-                                                 sgp_line{sgp_point{_pt2.x, _pt1.y + _ry}, sgp_point{_pt2.x, _pt2.y - _ry}},
-                                                 sgp_line{sgp_point{_pt2.x - _rx, _pt2.y}, sgp_point{_pt1.x + _rx, _pt2.y}},
-                                                 sgp_line{sgp_point{_pt1.x, _pt2.y - _ry}, sgp_point{_pt1.x, _pt1.y + _ry}}};
+                if (sub_path_open)
+                    visitor(scratch);
+                sub_path_open = false;
+            };
 
-                sgp_draw_lines(lines.data(), lines.size());
-
-                sgp_draw_lines_strip(arc_top_left.data(), arc_top_left.size());
-                sgp_draw_lines_strip(arc_top_right.data(), arc_top_right.size());
-                sgp_draw_lines_strip(arc_bottom_right.data(), arc_bottom_right.size());
-                sgp_draw_lines_strip(arc_bottom_left.data(), arc_bottom_left.size());
-            }
-            else
+            for (size_t i = range.first_verb; i < range.last_verb; i++)
             {
-                path_line::draw_thik_line(sgp_point{_pt1.x + _rx, _pt1.y}, sgp_point{_pt2.x - _rx, _pt1.y}, style.width);
-                path_line::draw_thik_line(sgp_point{_pt2.x, _pt1.y + _ry}, sgp_point{_pt2.x, _pt2.y - _ry}, style.width);
-                path_line::draw_thik_line(sgp_point{_pt2.x - _rx, _pt2.y}, sgp_point{_pt1.x + _rx, _pt2.y}, style.width);
-                path_line::draw_thik_line(sgp_point{_pt1.x, _pt2.y - _ry}, sgp_point{_pt1.x, _pt1.y + _ry}, style.width);
+                path_verb v = _verbs[i];
+                if (starts_element(v) || i == 0)
+                {
+                    hidden = cull && !_element_bounds[element].intersects(*cull);
+                    culled += hidden;
+                    element++;
+                }
+                if (hidden)
+                {
+                    if (starts_element(v))
+                        flush_sub_path();
+                    op += operand_count(v);
+                    continue;
+                }
 
-                path_line::draw_thik_lines(arc_top_left, style.width);
-                path_line::draw_thik_lines(arc_top_right, style.width);
-                path_line::draw_thik_lines(arc_bottom_left, style.width);
-                path_line::draw_thik_lines(arc_bottom_right, style.width);
+                switch (v)
+                {
+                case path_verb::line:
+                {
+                    flush_sub_path();
+                    path_line e(sgp_point{op[0], op[1]}, sgp_point{op[2], op[3]});
+                    visitor(e);
+                    op += 4;
+                    break;
+                }
+                case path_verb::rect:
+                {
+                    flush_sub_path();
+                    path_rect e(sgp_point{op[0], op[1]}, sgp_point{op[2], op[3]});
+                    visitor(e);
+                    op += 4;
+                    break;
+                }
+                case path_verb::roundrect:
+                {
+                    flush_sub_path();
+                    path_roundrect e(sgp_point{op[0], op[1]}, sgp_point{op[2], op[3]}, op[4], op[5]);
+                    visitor(e);
+                    op += 6;
+                    break;
+                }
+                case path_verb::ellipse:
+                {
+                    flush_sub_path();
+                    path_ellipse e(sgp_point{op[0], op[1]}, sgp_point{op[2], op[3]}, op[4], op[5]);
+                    visitor(e);
+                    op += 6;
+                    break;
+                }
+                case path_verb::move_to:
+                    flush_sub_path();
+                    scratch.clear();
+                    scratch.move_to(sgp_point{op[0], op[1]});
+                    sub_path_open = true;
+                    op += 2;
+                    break;
+                case path_verb::line_to:
+                    scratch.line_to(sgp_point{op[0], op[1]});
+                    op += 2;
+                    break;
+                case path_verb::arc_to:
+                    scratch.arc_to(sgp_point{op[0], op[1]}, sgp_point{op[2], op[3]}, op[4], tolerance);
+                    op += 5;
+                    break;
+                case path_verb::quadratic_curve_to:
+                    scratch.quadratic_curve_to(sgp_point{op[0], op[1]}, sgp_point{op[2], op[3]}, tolerance);
+                    op += 4;
+                    break;
+                case path_verb::bezier_curve_to:
+                    scratch.bezier_curve_to(sgp_point{op[0], op[1]}, sgp_point{op[2], op[3]}, sgp_point{op[4], op[5]}, tolerance);
+                    op += 6;
+                    break;
+                case path_verb::close_path:
+                    scratch.close_path();
+                    break;
+                }
             }
+
+            flush_sub_path();
+            return culled;
+        }
+
+    protected:
+        void add(path_verb v, std::initializer_list<float> operands)
+        {
+            _verbs.emplace_back(v);
+            _operands.insert(_operands.end(), operands);
+            _version++;
+
+            if (starts_element(v) || _verbs.size() == 1)
+                _element_bounds.emplace_back();
+            add_bounds(v, operands.begin(), _element_bounds.back());
+            _bounds.add(_element_bounds.back());
         }
 
         /**
-         * @brief Fill the rounded rectangle using the fill style
+         * @brief Grow the bounding box of the current element with the points of a verb
+         *
+         * Ellipse arcs use the box of the whole ellipse, arc_to arcs the box of their circle and
+         * Bezier curves the box of their control points, which contains the curve.
          */
-        void fill(const fill_style_s &style) override
+        void add_bounds(path_verb v, const float *op, aabb &b)
         {
-            sgp_set_color(style.color.r, style.color.g, style.color.b, style.color.a);
-
-            auto arc_top_left = path_ellipse::get_ellipse_triangles(sgp_point{_pt1.x, _pt1.y},
-                                                                    sgp_point{_pt1.x + _rx * 2, _pt1.y + _ry * 2},
-                                                                    M_PI,
-                                                                    M_PI_2 * 3.0f);
-
-            auto arc_top_right = path_ellipse::get_ellipse_triangles(sgp_point{_pt2.x - _rx * 2, _pt1.y},
-                                                                     sgp_point{_pt2.x, _pt1.y + _ry * 2},
-                                                                     M_PI_2 * 3.0f,
-                                                                     M_PI * 2.0f);
-
-            auto arc_bottom_right = path_ellipse::get_ellipse_triangles(sgp_point{_pt2.x - _rx * 2, _pt2.y - _ry * 2},
-                                                                        sgp_point{_pt2.x, _pt2.y},
-                                                                        0,
-                                                                        M_PI_2);
-
-            auto arc_bottom_left = path_ellipse::get_ellipse_triangles(sgp_point{_pt1.x, _pt2.y - _ry * 2},
-                                                                       sgp_point{_pt1.x + _rx * 2, _pt2.y},
-                                                                       M_PI_2,
-                                                                       M_PI);
-
-            sgp_draw_filled_rect(_pt1.x + _rx, _pt1.y, _pt2.x - _pt1.x - _rx * 2, _pt2.y - _pt1.y);
-            sgp_draw_filled_rect(_pt1.x, _pt1.y + _ry, _pt2.x - _pt1.x, _pt2.y - _pt1.y - _ry * 2);
-
-            sgp_draw_filled_triangles(arc_top_left.data(), arc_top_left.size());
-            sgp_draw_filled_triangles(arc_top_right.data(), arc_top_right.size());
-            sgp_draw_filled_triangles(arc_bottom_right.data(), arc_bottom_right.size());
-            sgp_draw_filled_triangles(arc_bottom_left.data(), arc_bottom_left.size());
+            switch (v)
+            {
+            case path_verb::line:
+            case path_verb::rect:
+            case path_verb::roundrect:
+            case path_verb::ellipse:
+                b.add(sgp_point{op[0], op[1]});
+                b.add(sgp_point{op[2], op[3]});
+                break;
+            case path_verb::move_to:
+                _start = _current = sgp_point{op[0], op[1]};
+                b.add(_current);
+                break;
+            case path_verb::line_to:
+                _current = sgp_point{op[0], op[1]};
+                b.add(_current);
+                break;
+            case path_verb::arc_to:
+            {
+                sgp_point p1 = {op[0], op[1]};
+                sgp_point center, end;
+                b.add(p1);
+                if (sub_path::arc_to_circle(_current, p1, sgp_point{op[2], op[3]}, op[4], center, end))
+                {
+                    float r = std::abs(op[4]);
+                    b.add(sgp_point{center.x - r, center.y - r});
+                    b.add(sgp_point{center.x + r, center.y + r});
+                    _current = end;
+                }
+                else
+                {
+                    _current = p1;
+                }
+                break;
+            }
+            case path_verb::quadratic_curve_to:
+                b.add(sgp_point{op[0], op[1]});
+                _current = sgp_point{op[2], op[3]};
+                b.add(_current);
+                break;
+            case path_verb::bezier_curve_to:
+                b.add(sgp_point{op[0], op[1]});
+                b.add(sgp_point{op[2], op[3]});
+                _current = sgp_point{op[4], op[5]};
+                b.add(_current);
+                break;
+            case path_verb::close_path:
+                _current = _start;
+                break;
+            }
         }
 
     protected:
-        sgp_point _pt1;
-        sgp_point _pt2;
-        float _rx;
-        float _ry;
+        std::vector<path_verb> _verbs;
+        std::vector<float> _operands;
+        std::vector<aabb> _element_bounds; // One box per element
+        aabb _bounds;
+        sgp_point _current{0.0f, 0.0f}; // End of the last sub path verb, for arc_to
+        sgp_point _start{0.0f, 0.0f};   // First point of the last sub path, for close_path
+        uint64_t _version = 0;
+        mutable sub_path _sub_path;
     };
 
-    class sub_path : public abstract_sub_path
+    /**
+     * @brief A retained path that keeps its tessellated vertices between frames
+     *
+     * The fill geometry is built the first time the path is filled, the stroke geometry
+     * the first time it is stroked. Both are rebuilt only when the path is modified
+     * (see edit()), when the tessellation tolerance changes by more than a factor of 2
+     * (the path is drawn with a different zoom) or, for the stroke, when the stroke width,
+     * join or cap changes.
+     */
+    class cached_path
     {
     public:
-        sub_path() {}
-        virtual ~sub_path() {}
+        cached_path() {}
+        cached_path(const path &p) : _path(p) {}
 
-        void move_to(const sgp_point &pt)
+        /**
+         * @brief Access the path to modify it, the cached geometry is invalidated
+         */
+        path &edit()
         {
-            _points.emplace_back(pt);
+            invalidate();
+            return _path;
         }
 
-        void line_to(const sgp_point &pt)
+        const path &get_path() const
         {
-            if (_points.empty())
-                return;
-
-            _points.emplace_back(pt);
+            return _path;
         }
 
-        void arc_to(const sgp_point &pt1, const sgp_point &pt2, float radius)
+        /**
+         * @brief Discard the cached geometry, it will be tessellated again on next draw
+         */
+        void invalidate()
         {
-            if (_points.empty())
-                return;
+            _fill_valid = false;
+            _stroke_valid = false;
+        }
 
-            auto arc_points = get_arc_to_points(_points.back(), pt1, pt2, radius);
+        const geometry &fill_geometry(tessellator &t = tessellator::get_default()) const
+        {
+            if (!_fill_valid || !similar_tolerance(_fill_tolerance, t.tolerance))
+            {
+                _fill.clear();
+                _path.tessellate_fill(_fill, t);
+                _fill_tolerance = t.tolerance;
+                _fill_valid = true;
+            }
 
-            _points.insert(_points.end(), arc_points.begin(), arc_points.end());
+            return _fill;
         }
 
-        void close_path()
+        /**
+         * @brief Get the stroke geometry, tessellated again when the style or the tolerance changed
+         *
+         * @param dash_distances Keep a dashed stroke whole with the arc length of its vertices, see
+         *        dash_shader. The geometry then only depends on the width, joins and caps: the
+         *        dash pattern and offset can change without tessellating it again
+         */
+        const geometry &stroke_geometry(const stroke_style_s &style, tessellator &t = tessellator::get_default(),
+                                        bool dash_distances = false) const
         {
-            if (_points.empty())
-                return;
-            _points.emplace_back(_points.front());
+            bool same = dash_distances ? _stroke_style.same_outline(style) : _stroke_style.same_geometry(style);
+            if (!_stroke_valid || !same || _stroke_distances != dash_distances || !similar_tolerance(_stroke_tolerance, t.tolerance))
+            {
+                _stroke.clear();
+                t.dash_distances = dash_distances;
+                _path.tessellate_stroke(style, _stroke, t);
+                t.dash_distances = false;
+                _stroke_style = style;
+                _stroke_distances = dash_distances;
+                _stroke_tolerance = t.tolerance;
+                _stroke_valid = true;
+            }
+
+            return _stroke;
         }
 
-        void stroke(const stroke_style_s &style) override
+        void fill(const fill_style_s &style, tessellator &t = tessellator::get_default()) const
         {
-            sgp_set_color(style.color.r, style.color.g, style.color.b, style.color.a);
+            IO2D_STATS_ADD(primitives, _path.element_count());
+            fill_geometry(t).draw(style.color, style.gradient);
+            _filled = true;
+        }
+
+        /**
+         * @brief Stroke the path, dashes are drawn by dash_shader when it supports the style
+         */
+        void stroke(const stroke_style_s &style, tessellator &t = tessellator::get_default()) const;
 
-            if (style.width == 1.0f)
+        /**
+         * @brief Get the bounding box, in path units, of the geometry the path is drawn with
+         *
+         * The geometries rebuilt by the last edit() are tessellated again, with the last stroke
+         * style for the stroke. A path never drawn is measured by its fill.
+         *
+         * @return false if the path covers nothing
+         */
+        bool bounds(sgp_rect &out, tessellator &t = tessellator::get_default()) const
+        {
+            sgp_rect r;
+            bool found = false;
+            if (_stroked && stroke_geometry(_stroke_style, t, _stroke_distances).bounds(r))
             {
-                sgp_draw_lines_strip(_points.data(), _points.size());
+                out = r;
+                found = true;
             }
-            else
+            if ((_filled || !_stroked) && fill_geometry(t).bounds(r))
             {
-                for (int i = 1; i < _points.size() - 1; i++)
-                {
-                    path_line::draw_thik_line(_points[i - 1], _points[i], style.width);
-                }
+                out = found ? rect_union(out, r) : r;
+                found = true;
             }
+
+            return found;
         }
 
-        void fill(const fill_style_s &style) override
+        /**
+         * @brief Check if a point is inside the fill, like isPointInPath() of the HTML5 canvas
+         *
+         * The point is tested against the cached fill triangles, tessellated if needed, after
+         * the bounding box of the path.
+         *
+         * @param p The point, in path units
+         */
+        bool contains(const sgp_point &p, tessellator &t = tessellator::get_default()) const
         {
-            sgp_set_color(style.color.r, style.color.g, style.color.b, style.color.a);
+            if (!_path.bounds().contains(p))
+                return false;
 
-            auto triangles = triangulate_polygon(_points);
-
-            sgp_draw_filled_triangles(triangles.data(), triangles.size());
+            for (const sgp_triangle &tri : fill_geometry(t).triangles)
+            {
+                if (sub_path::point_in_triangle(p, tri))
+                    return true;
+            }
+            return false;
         }
 
-        static float cross_product(const sgp_point &a, const sgp_point &b, const sgp_point &c)
+        /**
+         * @brief Check if a point is on the stroke, like isPointInStroke() of the HTML5 canvas
+         *
+         * When the cached stroke has the arc lengths of a dashed style with the same outline, the
+         * dash at the hit point is checked instead of tessellating the dashes.
+         *
+         * @param p The point, in path units
+         */
+        bool stroke_contains(const sgp_point &p, const stroke_style_s &style, tessellator &t = tessellator::get_default()) const
         {
-            return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+            if (!_path.bounds().grown(style.extent()).contains(p))
+                return false;
+
+            bool distances = _stroke_valid && _stroke_distances && style.dashed();
+            const geometry &g = stroke_geometry(style, t, distances);
+            for (size_t i = 0; i < g.triangles.size(); i++)
+            {
+                const sgp_triangle &tri = g.triangles[i];
+                if (!sub_path::point_in_triangle(p, tri))
+                    continue;
+                if (!distances)
+                    return true;
+
+                // Arc length at the point, interpolated from the triangle vertices
+                float d = (tri.b.x - tri.a.x) * (tri.c.y - tri.a.y) - (tri.c.x - tri.a.x) * (tri.b.y - tri.a.y);
+                float u = 0.0f, v = 0.0f;
+                if (d != 0.0f)
+                {
+                    u = ((p.x - tri.a.x) * (tri.c.y - tri.a.y) - (tri.c.x - tri.a.x) * (p.y - tri.a.y)) / d;
+                    v = ((tri.b.x - tri.a.x) * (p.y - tri.a.y) - (p.x - tri.a.x) * (tri.b.y - tri.a.y)) / d;
+                }
+                const float *s = &g.triangle_distances[i * 3];
+                if (style.dash_on(s[0] + (s[1] - s[0]) * u + (s[2] - s[0]) * v))
+                    return true;
+            }
+
+            // One pixel wide strokes are lines, they are hit within half a pixel
+            for (size_t i = 0; i < g.lines.size(); i++)
+            {
+                const sgp_line &l = g.lines[i];
+                float dx = l.b.x - l.a.x;
+                float dy = l.b.y - l.a.y;
+                float length2 = dx * dx + dy * dy;
+                float u = length2 > 0.0f ? std::clamp(((p.x - l.a.x) * dx + (p.y - l.a.y) * dy) / length2, 0.0f, 1.0f) : 0.0f;
+                float ex = l.a.x + dx * u - p.x;
+                float ey = l.a.y + dy * u - p.y;
+                if (ex * ex + ey * ey > 0.25f)
+                    continue;
+                if (!distances)
+                    return true;
+                const float *s = &g.line_distances[i * 2];
+                if (style.dash_on(s[0] + (s[1] - s[0]) * u))
+                    return true;
+            }
+            return false;
         }
 
-        static float distance(const sgp_point &p1, const sgp_point &p2)
+        /**
+         * @brief Record the device bounds of a draw, the draws of the same frame are merged
+         *
+         * @param frame Identifier of the frame, see redraw_target
+         * @param device The bounding box in device pixels
+         */
+        void mark_drawn(uint64_t frame, const sgp_rect &device) const
         {
-            return std::sqrt(std::pow(p2.x - p1.x, 2) + std::pow(p2.y - p1.y, 2));
+            _drawn_bounds = _drawn_frame == frame ? rect_union(_drawn_bounds, device) : device;
+            _drawn_frame = frame;
         }
 
-        static float angle_between_vectors(const sgp_point &p1, const sgp_point &p2, const sgp_point &p3)
+        /**
+         * @brief Get the device bounds of the draws of the last frame the path was drawn in
+         *
+         * @return false if the path was never drawn into a redraw_target
+         */
+        bool drawn_bounds(sgp_rect &out) const
         {
-            double v1_x = p2.x - p1.x;
-            double v1_y = p2.y - p1.y;
-            double v2_x = p3.x - p2.x;
-            double v2_y = p3.y - p2.y;
-            double dot = v1_x * v2_x + v1_y * v2_y;
-            double mag1 = std::sqrt(v1_x * v1_x + v1_y * v1_y);
-            double mag2 = std::sqrt(v2_x * v2_x + v2_y * v2_y);
-            return std::acos(dot / (mag1 * mag2));
+            if (_drawn_frame == 0)
+                return false;
+
+            out = _drawn_bounds;
+            return true;
         }
 
-        static std::vector<sgp_point> get_arc_to_points(const sgp_point &p0, const sgp_point &p1, const sgp_point &p2, float radius)
+    protected:
+        /**
+         * @brief Check if geometry tessellated with the cached tolerance is still good for the requested one
+         */
+        static bool similar_tolerance(float cached, float requested)
         {
+            return requested >= cached * 0.5f && requested <= cached * 2.0f;
+        }
 
-            std::vector<sgp_point> arcPoints;
+    protected:
+        path _path;
 
-            // Direction vectors
-            float dx1 = p0.x - p1.x;
-            float dy1 = p0.y - p1.y;
-            float dx2 = p2.x - p1.x;
-            float dy2 = p2.y - p1.y;
+        mutable geometry _fill;
+        mutable geometry _stroke;
+        mutable stroke_style_s _stroke_style;
+        mutable bool _stroke_distances = false; // _stroke is kept whole with its arc lengths, see stroke_geometry()
+        mutable float _fill_tolerance = default_tessellation_tolerance;
+        mutable float _stroke_tolerance = default_tessellation_tolerance;
+        mutable bool _fill_valid = false;
+        mutable bool _stroke_valid = false;
+        mutable bool _filled = false;
+        mutable bool _stroked = false;
+        mutable sgp_rect _drawn_bounds{};
+        mutable uint64_t _drawn_frame = 0;
+    };
 
-            // Normalize direction vectors
-            float len1 = std::hypot(dx1, dy1);
-            float len2 = std::hypot(dx2, dy2);
-            dx1 /= len1;
-            dy1 /= len1;
-            dx2 /= len2;
-            dy2 /= len2;
+    /**
+     * @brief Helpers to make shaders and pipelines using the sokol_gp vertex layout
+     *
+     * sgp_make_pipeline() does not expose the stencil state, so custom pipelines are made with
+     * sg_make_pipeline() using the same vertex layout, bindings and blend states as sokol_gp.
+     * Shader sources are provided for the GL backends only, on the other backends make_shader()
+     * returns an invalid shader and callers fall back to their CPU path.
+     */
+    class gpu
+    {
+    public:
+        static constexpr const char *vs_glsl300es = R"(#version 300 es
+layout(location = 0) in vec4 coord;
+layout(location = 1) in vec4 color;
+out vec2 texUV;
+out vec4 iColor;
+void main()
+{
+    gl_Position = vec4(coord.xy, 0.0, 1.0);
+    texUV = coord.zw;
+    iColor = color;
+}
+)";
+
+        static constexpr const char *fs_glsl300es = R"(#version 300 es
+precision mediump float;
+uniform highp sampler2D iTexChannel0_iSmpChannel0;
+in highp vec2 texUV;
+in highp vec4 iColor;
+layout(location = 0) out highp vec4 fragColor;
+void main()
+{
+    fragColor = texture(iTexChannel0_iSmpChannel0, texUV) * iColor;
+}
+)";
+
+        static constexpr const char *vs_glsl410 = R"(#version 410
+layout(location = 0) in vec4 coord;
+layout(location = 1) in vec4 color;
+layout(location = 0) out vec2 texUV;
+layout(location = 1) out vec4 iColor;
+void main()
+{
+    gl_Position = vec4(coord.xy, 0.0, 1.0);
+    texUV = coord.zw;
+    iColor = color;
+}
+)";
+
+        static constexpr const char *fs_glsl410 = R"(#version 410
+uniform sampler2D iTexChannel0_iSmpChannel0;
+layout(location = 0) in vec2 texUV;
+layout(location = 1) in vec4 iColor;
+layout(location = 0) out vec4 fragColor;
+void main()
+{
+    fragColor = texture(iTexChannel0_iSmpChannel0, texUV) * iColor;
+}
+)";
+
+        /**
+         * @brief Check if a resource must be made again
+         *
+         * The resources are made on first use and kept by thread_local objects, which outlive
+         * sokol_gfx when it is shut down and set up again: the ids of the old resources are then
+         * invalid.
+         */
+        static bool needs_setup(sg_shader shader)
+        {
+            return shader.id == SG_INVALID_ID || sg_query_shader_state(shader) != SG_RESOURCESTATE_VALID;
+        }
+
+        static bool needs_setup(sg_pipeline pipeline)
+        {
+            return pipeline.id == SG_INVALID_ID || sg_query_pipeline_state(pipeline) != SG_RESOURCESTATE_VALID;
+        }
+
+        static bool needs_setup(sg_image image)
+        {
+            return image.id == SG_INVALID_ID || sg_query_image_state(image) != SG_RESOURCESTATE_VALID;
+        }
+
+        /**
+         * @brief Make a shader with the sokol_gp attributes and texture binding
+         *
+         * @param desc Shader description to complete, used to add uniform blocks or to change the image sample type
+         * @param fs_300es The GLSL 300 es fragment shader source
+         * @param fs_410 The GLSL 410 fragment shader source
+         * @param vs_300es The GLSL 300 es vertex shader source
+         * @param vs_410 The GLSL 410 vertex shader source
+         */
+        static sg_shader make_shader(sg_shader_desc desc, const char *fs_300es = fs_glsl300es, const char *fs_410 = fs_glsl410,
+                                     const char *vs_300es = vs_glsl300es, const char *vs_410 = vs_glsl410)
+        {
+            desc.images[0].stage = SG_SHADERSTAGE_FRAGMENT;
+            desc.images[0].image_type = SG_IMAGETYPE_2D;
+            if (desc.images[0].sample_type == _SG_IMAGESAMPLETYPE_DEFAULT)
+                desc.images[0].sample_type = SG_IMAGESAMPLETYPE_FLOAT;
+            desc.samplers[0].stage = SG_SHADERSTAGE_FRAGMENT;
+            if (desc.samplers[0].sampler_type == _SG_SAMPLERTYPE_DEFAULT)
+                desc.samplers[0].sampler_type = SG_SAMPLERTYPE_FILTERING;
+            desc.image_sampler_pairs[0].stage = SG_SHADERSTAGE_FRAGMENT;
+            desc.image_sampler_pairs[0].image_slot = 0;
+            desc.image_sampler_pairs[0].sampler_slot = 0;
+            desc.image_sampler_pairs[0].glsl_name = "iTexChannel0_iSmpChannel0";
+            desc.attrs[SGP_VS_ATTR_COORD].glsl_name = "coord";
+            desc.attrs[SGP_VS_ATTR_COLOR].glsl_name = "color";
+            desc.vertex_func.entry = "main";
+            desc.fragment_func.entry = "main";
+
+            switch (sg_query_backend())
+            {
+            case SG_BACKEND_GLCORE:
+                desc.vertex_func.source = vs_410;
+                desc.fragment_func.source = fs_410;
+                break;
+            case SG_BACKEND_GLES3:
+                desc.vertex_func.source = vs_300es;
+                desc.fragment_func.source = fs_300es;
+                break;
+            case SG_BACKEND_DUMMY:
+                desc.vertex_func.source = "";
+                desc.fragment_func.source = "";
+                break;
+            default:
+                return sg_shader{SG_INVALID_ID};
+            }
+
+            return sg_make_shader(&desc);
+        }
+
+        /**
+         * @brief Make a pipeline for the sokol_gp vertex layout and render target, triangles by default
+         *
+         * @return The pipeline, it has an invalid id if the creation failed
+         */
+        static sg_pipeline make_pipeline(sg_shader shader, sgp_blend_mode blend_mode,
+                                         const sg_stencil_state &stencil = {}, sg_color_mask color_mask = SG_COLORMASK_RGBA,
+                                         sg_primitive_type primitive = SG_PRIMITIVETYPE_TRIANGLES)
+        {
+            sg_pipeline_desc desc = pipeline_desc(shader, blend_mode, stencil, color_mask, primitive);
+            return make_pipeline(desc);
+        }
+
+        /**
+         * @brief Make a pipeline from a description, e.g. a pipeline_desc() with another vertex layout
+         *
+         * @return The pipeline, it has an invalid id if the creation failed
+         */
+        static sg_pipeline make_pipeline(const sg_pipeline_desc &desc)
+        {
+            sg_pipeline pip = sg_make_pipeline(&desc);
+            if (pip.id != SG_INVALID_ID && sg_query_pipeline_state(pip) != SG_RESOURCESTATE_VALID)
+            {
+                sg_destroy_pipeline(pip);
+                pip.id = SG_INVALID_ID;
+            }
+            return pip;
+        }
+
+        /**
+         * @brief Describe a pipeline for the sokol_gp vertex layout and render target
+         */
+        static sg_pipeline_desc pipeline_desc(sg_shader shader, sgp_blend_mode blend_mode,
+                                              const sg_stencil_state &stencil = {}, sg_color_mask color_mask = SG_COLORMASK_RGBA,
+                                              sg_primitive_type primitive = SG_PRIMITIVETYPE_TRIANGLES)
+        {
+            sgp_desc sd = sgp_query_desc();
+
+            sg_pipeline_desc desc = {};
+            desc.shader = shader;
+            desc.layout.buffers[0].stride = sizeof(sgp_vertex);
+            desc.layout.attrs[SGP_VS_ATTR_COORD].offset = offsetof(sgp_vertex, position);
+            desc.layout.attrs[SGP_VS_ATTR_COORD].format = SG_VERTEXFORMAT_FLOAT4;
+            desc.layout.attrs[SGP_VS_ATTR_COLOR].offset = offsetof(sgp_vertex, color);
+            desc.layout.attrs[SGP_VS_ATTR_COLOR].format = SG_VERTEXFORMAT_UBYTE4N;
+            desc.sample_count = sd.sample_count;
+            desc.depth.pixel_format = sd.depth_format;
+            desc.stencil = stencil;
+            desc.colors[0].pixel_format = sd.color_format;
+            desc.colors[0].write_mask = color_mask;
+            desc.colors[0].blend = blend_state(blend_mode);
+            desc.primitive_type = primitive;
+            return desc;
+        }
+
+        /**
+         * @brief Get the blend state sokol_gp uses for a blend mode
+         */
+        static sg_blend_state blend_state(sgp_blend_mode blend_mode)
+        {
+            // Source and destination factors for rgb, then for alpha
+            struct factors
+            {
+                sg_blend_factor src_rgb, dst_rgb, src_alpha, dst_alpha;
+            };
+            static constexpr factors table[_SGP_BLENDMODE_NUM] = {
+                {SG_BLENDFACTOR_ONE, SG_BLENDFACTOR_ZERO, SG_BLENDFACTOR_ONE, SG_BLENDFACTOR_ZERO},
+                {SG_BLENDFACTOR_SRC_ALPHA, SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SG_BLENDFACTOR_ONE, SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA},
+                {SG_BLENDFACTOR_ONE, SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SG_BLENDFACTOR_ONE, SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA},
+                {SG_BLENDFACTOR_SRC_ALPHA, SG_BLENDFACTOR_ONE, SG_BLENDFACTOR_ZERO, SG_BLENDFACTOR_ONE},
+                {SG_BLENDFACTOR_ONE, SG_BLENDFACTOR_ONE, SG_BLENDFACTOR_ZERO, SG_BLENDFACTOR_ONE},
+                {SG_BLENDFACTOR_DST_COLOR, SG_BLENDFACTOR_ZERO, SG_BLENDFACTOR_ZERO, SG_BLENDFACTOR_ONE},
+                {SG_BLENDFACTOR_DST_COLOR, SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SG_BLENDFACTOR_DST_ALPHA, SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA}};
+
+            const factors &f = table[blend_mode < _SGP_BLENDMODE_NUM ? blend_mode : SGP_BLENDMODE_NONE];
+
+            sg_blend_state blend = {};
+            blend.enabled = blend_mode != SGP_BLENDMODE_NONE;
+            blend.src_factor_rgb = f.src_rgb;
+            blend.dst_factor_rgb = f.dst_rgb;
+            blend.op_rgb = SG_BLENDOP_ADD;
+            blend.src_factor_alpha = f.src_alpha;
+            blend.dst_factor_alpha = f.dst_alpha;
+            blend.op_alpha = SG_BLENDOP_ADD;
+            return blend;
+        }
+    };
+
+    /**
+     * @brief Stencil mask of the paths clipping the draws, see canvas::clip()
+     *
+     * The clip is the highest bit of the stencil buffer, the fill rules of stencil_fill count in
+     * the lower bits. While active is set every io2d pipeline tests the bit: the shaders keep a
+     * clipped variant of their pipelines, and a scope sets one for the draws of the sokol_gp
+     * shader. A path is applied by counting its fans in the lower bits, only inside the clip
+     * when one is active, then covering a rectangle containing every bit set so far: the clip
+     * bit is set where the count is not zero and cleared elsewhere, the count is reset to zero.
+     */
+    class clip_mask
+    {
+    public:
+        static constexpr uint8_t clip_bit = 0x80;   // Set inside the clip
+        static constexpr uint8_t count_mask = 0x7f; // Bits counting the fill rules
+
+        /**
+         * @brief Set the pipeline drawing a primitive of the sokol_gp shader inside the clip, until it is destroyed
+         *
+         * Nothing is changed without an active clip, or when a custom pipeline is already set.
+         */
+        class scope
+        {
+        public:
+            explicit scope(sg_primitive_type primitive)
+            {
+                clip_mask &m = get_default();
+                const sgp_state *state = sgp_query_state();
+                if (!m.active || state->pipeline.id != SG_INVALID_ID)
+                    return;
+                sg_pipeline pip = m.pipeline(primitive, state->blend_mode);
+                if (pip.id == SG_INVALID_ID)
+                    return;
+                sgp_set_pipeline(pip);
+                _set = true;
+            }
+
+            scope(const scope &) = delete;
+            scope &operator=(const scope &) = delete;
+
+            ~scope()
+            {
+                if (_set)
+                    sgp_reset_pipeline();
+            }
+
+        protected:
+            bool _set = false;
+        };
+
+        /**
+         * @brief Get the clip mask of the calling thread
+         */
+        static clip_mask &get_default()
+        {
+            thread_local clip_mask m;
+            return m;
+        }
+
+        /**
+         * @brief Check if the mask can be used, the render pass needs a depth-stencil attachment
+         */
+        bool available()
+        {
+            if (sgp_query_desc().depth_format != SG_PIXELFORMAT_DEPTH_STENCIL)
+                return false;
+
+            if (gpu::needs_setup(_shader))
+                setup();
+
+            return _shader.id != SG_INVALID_ID;
+        }
+
+        /**
+         * @brief Get the stencil state of a draw, testing the clip bit while the clip is active
+         */
+        sg_stencil_state test() const
+        {
+            return active ? clip_test() : sg_stencil_state{};
+        }
+
+        /**
+         * @brief Get the stencil state drawing only inside the clip
+         */
+        static sg_stencil_state clip_test()
+        {
+            sg_stencil_state s = {};
+            s.enabled = true;
+            s.front = {SG_COMPAREFUNC_EQUAL, SG_STENCILOP_KEEP, SG_STENCILOP_KEEP, SG_STENCILOP_KEEP};
+            s.back = s.front;
+            s.read_mask = clip_bit;
+            s.write_mask = 0;
+            s.ref = clip_bit;
+            return s;
+        }
+
+        /**
+         * @brief Get the pipeline counting fans with a fill rule in the lower bits, only inside the clip while it is active
+         */
+        sg_pipeline count_pipeline(fill_rule rule)
+        {
+            return _count[active][(int)rule];
+        }
+
+        /**
+         * @brief Get the pipeline of the sokol_gp shader drawing inside the clip
+         */
+        sg_pipeline pipeline(sg_primitive_type primitive, sgp_blend_mode blend_mode)
+        {
+            blend_mode = blend_mode < _SGP_BLENDMODE_NUM ? blend_mode : SGP_BLENDMODE_NONE;
+            sg_pipeline &pip = _pipelines[primitive < _SG_PRIMITIVETYPE_NUM ? primitive : SG_PRIMITIVETYPE_TRIANGLES][blend_mode];
+            if (pip.id == SG_INVALID_ID && _shader.id != SG_INVALID_ID)
+                pip = gpu::make_pipeline(_shader, blend_mode, clip_test(), SG_COLORMASK_RGBA, primitive);
+            return pip;
+        }
+
+        /**
+         * @brief Intersect the clip with the fans of a path, and make it active
+         *
+         * @param fans The fans built by path::tessellate_stencil(), in the units of the current sokol_gp transform
+         * @param rule The fill rule
+         * @param cover A rectangle in pixels containing the fans and every clip bit set since the render pass began
+         */
+        void apply(const sgp_triangle *fans, size_t count, fill_rule rule, const sgp_rect &cover)
+        {
+            sgp_state *state = sgp_query_state();
+            sgp_set_pipeline(count_pipeline(rule));
+            sgp_draw_filled_triangles(fans, (uint32_t)count);
+
+            sgp_mat2x3 transform = state->transform;
+            state->transform = mat2x3_identity();
+            state->mvp = state->proj;
+            sgp_set_pipeline(_cover);
+            sgp_draw_filled_rect(cover.x, cover.y, cover.w, cover.h);
+            sgp_reset_pipeline();
+            state->transform = transform;
+            state->mvp = mat2x3_multiply(state->proj, transform);
+            IO2D_SUBMIT_ADD(commands, 2);
+            IO2D_SUBMIT_ADD(vertices, count * 3 + 6);
+            active = true;
+        }
+
+    public:
+        bool active = false; // Set by the canvas while a path clips its draws
+
+    protected:
+        void setup()
+        {
+            _shader = gpu::make_shader(sg_shader_desc{});
+            for (auto &p : _pipelines)
+                p.fill(sg_pipeline{SG_INVALID_ID});
+            for (int clipped = 0; clipped < 2; clipped++)
+            {
+                _count[clipped][(int)fill_rule::nonzero] = gpu::make_pipeline(_shader, SGP_BLENDMODE_NONE,
+                                                                              count_stencil(SG_STENCILOP_INCR_WRAP, SG_STENCILOP_DECR_WRAP, clipped),
+                                                                              SG_COLORMASK_NONE);
+                _count[clipped][(int)fill_rule::evenodd] = gpu::make_pipeline(_shader, SGP_BLENDMODE_NONE,
+                                                                              count_stencil(SG_STENCILOP_INVERT, SG_STENCILOP_INVERT, clipped),
+                                                                              SG_COLORMASK_NONE);
+            }
+
+            // Where the count is not zero the stencil becomes clip_bit, elsewhere zero
+            sg_stencil_state cover = {};
+            cover.enabled = true;
+            cover.front = {SG_COMPAREFUNC_NOT_EQUAL, SG_STENCILOP_ZERO, SG_STENCILOP_ZERO, SG_STENCILOP_REPLACE};
+            cover.back = cover.front;
+            cover.read_mask = count_mask;
+            cover.write_mask = 0xff;
+            cover.ref = clip_bit;
+            _cover = gpu::make_pipeline(_shader, SGP_BLENDMODE_NONE, cover, SG_COLORMASK_NONE);
+
+            bool valid = _cover.id != SG_INVALID_ID;
+            for (auto &rules : _count)
+                for (sg_pipeline &p : rules)
+                    valid = valid && p.id != SG_INVALID_ID;
+            if (!valid)
+            {
+                sg_destroy_shader(_shader);
+                _shader.id = SG_INVALID_ID;
+            }
+        }
+
+        static sg_stencil_state count_stencil(sg_stencil_op front_op, sg_stencil_op back_op, bool clipped)
+        {
+            sg_stencil_state s = {};
+            s.enabled = true;
+            sg_compare_func compare = clipped ? SG_COMPAREFUNC_EQUAL : SG_COMPAREFUNC_ALWAYS;
+            s.front = {compare, SG_STENCILOP_KEEP, SG_STENCILOP_KEEP, front_op};
+            s.back = {compare, SG_STENCILOP_KEEP, SG_STENCILOP_KEEP, back_op};
+            s.read_mask = clip_bit;
+            s.write_mask = count_mask;
+            s.ref = clip_bit;
+            return s;
+        }
+
+    protected:
+        sg_shader _shader{SG_INVALID_ID};
+        std::array<std::array<sg_pipeline, 2>, 2> _count{}; // By clipped, then fill rule
+        sg_pipeline _cover{SG_INVALID_ID};
+        std::array<std::array<sg_pipeline, _SGP_BLENDMODE_NUM>, _SG_PRIMITIVETYPE_NUM> _pipelines{}; // By primitive
+    };
+
+    /**
+     * @brief Paints geometry with gradients evaluated per fragment
+     *
+     * Every gradient drawn in a frame gets a row of an RGBA32F texture: two texels with its
+     * geometry, then its color stops baked into a ramp of ramp_size texels. The vertices keep
+     * their path coordinates in the texture coordinates and the row in their color, so a gradient
+     * costs as many vertices as a solid color and one pipeline per primitive draws all of them.
+     *
+     * Without float textures, or once the texture is full or uploaded for the frame, the gradient
+     * is evaluated at the vertices instead. The texture grows for the next frames.
+     */
+    class gradient_shader
+    {
+    public:
+        static constexpr int ramp_size = 254;                 // Colors baked per gradient
+        static constexpr int texture_width = ramp_size + 2;   // Texels per row, one row per gradient
+        static constexpr size_t floats_per_row = texture_width * 4;
+
+        /**
+         * @brief Get the gradient pipelines and texture of the calling thread
+         */
+        static gradient_shader &get_default()
+        {
+            thread_local gradient_shader s;
+            return s;
+        }
+
+        /**
+         * @brief Check if the shader can be used, the texture and the shader are made if needed
+         */
+        bool available()
+        {
+            if (gpu::needs_setup(_shader))
+                setup();
+
+            return _shader.id != SG_INVALID_ID;
+        }
+
+        /**
+         * @brief Draw triangles or lines painted with a gradient
+         *
+         * The vertices are in path units like the sokol_gp draws. When the gradient is evaluated
+         * at the vertices the current pipeline is used.
+         *
+         * @param g The gradient, it must not change until the frame is submitted
+         * @param primitive SG_PRIMITIVETYPE_TRIANGLES or SG_PRIMITIVETYPE_LINES
+         * @param stencil The stencil state of the draw, only the cover pass of stencil_fill sets it
+         */
+        void draw(const gradient &g, sg_primitive_type primitive, const sgp_point *points, size_t count,
+                  const sg_stencil_state &stencil = {})
+        {
+            if (count == 0)
+                return;
+
+            int r = available() ? row(g) : -1;
+            _vertices.resize(count);
+            if (r < 0)
+            {
+                for (size_t i = 0; i < count; i++)
+                {
+                    rgba_color c = g.color_at(points[i]);
+                    _vertices[i] = sgp_vertex{points[i], {0.0f, 0.0f}, c.ub4()};
+                }
+                clip_mask::scope clip(primitive);
+                sgp_draw(primitive, _vertices.data(), (uint32_t)count);
+            }
+            else
+            {
+                const sgp_state *state = sgp_query_state();
+                sgp_blend_mode blend_mode = state->blend_mode < _SGP_BLENDMODE_NUM ? state->blend_mode : SGP_BLENDMODE_NONE;
+                // The cover pass of stencil_fill only draws inside the clip already
+                bool clipped = !stencil.enabled && clip_mask::get_default().active;
+                int target = stencil.enabled ? 2 : (clipped ? 3 : 0) + (primitive == SG_PRIMITIVETYPE_LINES ? 1 : 0);
+                sg_pipeline &pip = _pipelines[target][blend_mode];
+                if (pip.id == SG_INVALID_ID)
+                    pip = gpu::make_pipeline(_shader, blend_mode, clipped ? clip_mask::clip_test() : stencil, SG_COLORMASK_RGBA, primitive);
+
+                sgp_color_ub4 id = {(uint8_t)(r & 0xff), (uint8_t)((r >> 8) & 0xff), (uint8_t)((r >> 16) & 0xff), 255};
+                for (size_t i = 0; i < count; i++)
+                    _vertices[i] = sgp_vertex{points[i], points[i], id};
+
+                sg_pipeline previous = state->pipeline;
+                sgp_set_pipeline(pip);
+                sgp_set_image(0, _texture);
+                sgp_set_sampler(0, _sampler);
+                sgp_draw(primitive, _vertices.data(), (uint32_t)count);
+                sgp_reset_sampler(0);
+                sgp_reset_image(0);
+                sgp_set_pipeline(previous);
+            }
+            IO2D_SUBMIT_ADD(commands, 1);
+            IO2D_SUBMIT_ADD(vertices, count);
+        }
+
+        /**
+         * @brief Upload the gradients of the frame, the canvas calls it before the frame is flushed
+         */
+        void upload()
+        {
+            if (_gradients.empty() || _uploaded || _texture.id == SG_INVALID_ID)
+                return;
+
+            // The whole image must be updated
+            _texels.resize(_capacity * floats_per_row, 0.0f);
+            sg_image_data data = {};
+            data.subimage[0][0] = sg_range{_texels.data(), _texels.size() * sizeof(float)};
+            sg_update_image(_texture, &data);
+            _uploaded = true;
+        }
+
+    protected:
+        static constexpr const char *fs_gradient_glsl300es = R"(#version 300 es
+precision highp float;
+precision highp int;
+uniform highp sampler2D iTexChannel0_iSmpChannel0;
+in highp vec2 texUV;
+in highp vec4 iColor;
+layout(location = 0) out highp vec4 fragColor;
+)";
+
+        static constexpr const char *fs_gradient_glsl410 = R"(#version 410
+uniform sampler2D iTexChannel0_iSmpChannel0;
+layout(location = 0) in vec2 texUV;
+layout(location = 1) in vec4 iColor;
+layout(location = 0) out vec4 fragColor;
+)";
+
+        // Same offsets as gradient::offset_at()
+        static constexpr const char *fs_gradient_main = R"(
+void main()
+{
+    ivec3 id = ivec3(iColor.rgb * 255.0 + 0.5);
+    int row = id.r + id.g * 256 + id.b * 65536;
+    vec4 g0 = texelFetch(iTexChannel0_iSmpChannel0, ivec2(0, row), 0);
+    vec4 g1 = texelFetch(iTexChannel0_iSmpChannel0, ivec2(1, row), 0);
+    vec2 p0 = g0.yz;
+    vec2 p1 = vec2(g0.w, g1.x);
+    vec2 d = texUV - p0;
+
+    float t;
+    if (g0.x < 0.5)
+    {
+        vec2 a = p1 - p0;
+        t = dot(d, a) / max(dot(a, a), 1e-12);
+    }
+    else if (g0.x < 1.5)
+    {
+        float r0 = g1.y;
+        float dr = g1.z - g1.y;
+        vec2 c = p1 - p0;
+        float qa = dot(c, c) - dr * dr;
+        float qb = dot(d, c) + r0 * dr;
+        float qc = dot(d, d) - r0 * r0;
+        if (abs(qa) < 1e-6)
+        {
+            if (abs(qb) < 1e-6)
+                discard;
+            t = qc / (2.0 * qb);
+        }
+        else
+        {
+            float disc = qb * qb - qa * qc;
+            if (disc < 0.0)
+                discard;
+            float s = sqrt(disc);
+            float t0 = max((qb + s) / qa, (qb - s) / qa);
+            float t1 = min((qb + s) / qa, (qb - s) / qa);
+            t = r0 + t0 * dr >= 0.0 ? t0 : t1;
+        }
+        if (r0 + t * dr < 0.0)
+            discard;
+    }
+    else
+    {
+        float a = (atan(d.y, d.x) - g1.w) * 0.15915494309189535;
+        t = a - floor(a);
+    }
+
+    float x = clamp(t, 0.0, 1.0) * float(RAMP_SIZE - 1);
+    int i = min(int(x), RAMP_SIZE - 2);
+    vec4 c0 = texelFetch(iTexChannel0_iSmpChannel0, ivec2(2 + i, row), 0);
+    vec4 c1 = texelFetch(iTexChannel0_iSmpChannel0, ivec2(3 + i, row), 0);
+    fragColor = mix(c0, c1, x - float(i));
+}
+)";
+
+        /**
+         * @brief Get the texture row of a gradient, its texels are added the first time it is drawn in the frame
+         *
+         * @return -1 if the gradient must be evaluated at the vertices
+         */
+        int row(const gradient &g)
+        {
+            uint32_t frame = sg_query_frame_stats().frame_index + 1;
+            if (frame != _frame)
+            {
+                _frame = frame;
+                _gradients.clear();
+                _texels.clear();
+                _uploaded = false;
+                begin_frame();
+            }
+
+            for (size_t i = 0; i < _gradients.size(); i++)
+                if (_gradients[i] == &g)
+                    return (int)i;
+
+            // The texture can be updated once per frame
+            if (_uploaded)
+                return -1;
+            if (_gradients.size() >= _capacity)
+            {
+                _wanted = std::max(_wanted, _gradients.size() + 1);
+                return -1;
+            }
+
+            _gradients.push_back(&g);
+            size_t at = _texels.size();
+            _texels.resize(at + floats_per_row);
+            float *t = &_texels[at];
+            const float params[8] = {
+                (float)g.type, g.p0.x, g.p0.y, g.p1.x,
+                g.p1.y, g.r0, g.r1, g.angle};
+            std::copy(params, params + 8, t);
+            for (int i = 0; i < ramp_size; i++)
+            {
+                rgba_color c = g.color_at(i / (float)(ramp_size - 1));
+                float *texel = t + (2 + i) * 4;
+                texel[0] = c.r;
+                texel[1] = c.g;
+                texel[2] = c.b;
+                texel[3] = c.a;
+            }
+            return (int)_gradients.size() - 1;
+        }
+
+        void setup()
+        {
+            for (auto &p : _pipelines)
+                p.fill(sg_pipeline{SG_INVALID_ID});
+            _shader.id = SG_INVALID_ID;
+            _texture.id = SG_INVALID_ID;
+            _capacity = 0;
+            _frame = 0;
+
+            if (!sg_query_pixelformat(SG_PIXELFORMAT_RGBA32F).sample)
+                return;
+
+            sg_shader_desc desc = {};
+            desc.images[0].sample_type = SG_IMAGESAMPLETYPE_UNFILTERABLE_FLOAT;
+            desc.samplers[0].sampler_type = SG_SAMPLERTYPE_NONFILTERING;
+            std::string define = "#define RAMP_SIZE " + std::to_string(ramp_size) + "\n";
+            std::string fs_300es = fs_gradient_glsl300es + define + fs_gradient_main;
+            std::string fs_410 = fs_gradient_glsl410 + define + fs_gradient_main;
+            _shader = gpu::make_shader(desc, fs_300es.c_str(), fs_410.c_str());
+            if (_shader.id == SG_INVALID_ID || sg_query_shader_state(_shader) != SG_RESOURCESTATE_VALID)
+            {
+                _shader.id = SG_INVALID_ID;
+                return;
+            }
+
+            sg_sampler_desc smp = {};
+            smp.min_filter = SG_FILTER_NEAREST;
+            smp.mag_filter = SG_FILTER_NEAREST;
+            _sampler = sg_make_sampler(&smp);
+
+            _wanted = std::max(_wanted, initial_capacity);
+        }
+
+        /**
+         * @brief Grow the texture if the last frames needed more gradients, no draw of the frame uses it yet
+         */
+        void begin_frame()
+        {
+            if (_wanted <= _capacity)
+                return;
+
+            size_t rows = initial_capacity;
+            while (rows < _wanted)
+                rows *= 2;
+
+            sg_destroy_image(_texture);
+            sg_image_desc desc = {};
+            desc.width = texture_width;
+            desc.height = (int)rows;
+            desc.usage = SG_USAGE_STREAM;
+            desc.pixel_format = SG_PIXELFORMAT_RGBA32F;
+            _texture = sg_make_image(&desc);
+            _capacity = _texture.id != SG_INVALID_ID ? rows : 0;
+        }
+
+    protected:
+        static constexpr size_t initial_capacity = 64;
+
+        sg_shader _shader{SG_INVALID_ID};
+        std::array<std::array<sg_pipeline, _SGP_BLENDMODE_NUM>, 5> _pipelines{}; // Triangles, lines, stencil cover, clipped triangles and lines
+        sg_image _texture{SG_INVALID_ID};
+        sg_sampler _sampler{SG_INVALID_ID};
+        size_t _capacity = 0;                   // Gradients the texture can hold
+        size_t _wanted = 0;                     // Gradients needed by the largest frame
+        uint32_t _frame = 0;                    // Frame of _gradients
+        bool _uploaded = false;                 // The texture has been updated in the frame
+        std::vector<const gradient *> _gradients; // Gradients of the frame, by row
+        std::vector<float> _texels;
+        std::vector<sgp_vertex> _vertices;      // Scratch
+    };
+
+    /**
+     * @brief Dashes evaluated per fragment from the arc length of the stroke vertices
+     *
+     * The geometry is a whole dashed stroke tessellated with tessellator::dash_distances: the arc
+     * lengths go in the texture coordinates and the pattern and its offset in a uniform, so
+     * changing the offset, e.g. for marching ants, tessellates nothing again. The dashes have butt
+     * ends, the strokes it does not support are cut into dashes on the CPU.
+     */
+    class dash_shader
+    {
+    public:
+        static constexpr size_t max_dashes = 6; // Lengths fitting in the sokol_gp uniform
+
+        /**
+         * @brief Get the dash pipelines of the calling thread
+         */
+        static dash_shader &get_default()
+        {
+            thread_local dash_shader s;
+            return s;
+        }
+
+        /**
+         * @brief Check if the shader can be used, the shader is made if needed
+         */
+        bool available()
+        {
+            if (gpu::needs_setup(_shader))
+                setup();
+
+            return _shader.id != SG_INVALID_ID;
+        }
+
+        /**
+         * @brief Check if a dashed style can be drawn by the shader: butt caps, a color and a short pattern
+         */
+        bool supports(const stroke_style_s &style)
+        {
+            return style.dashed() && style.cap == line_cap::butt && !style.gradient &&
+                   style.dash_count <= max_dashes && available();
+        }
+
+        /**
+         * @brief Draw a stroke geometry with arc lengths, dashed with the pattern and offset of style
+         */
+        void draw(const geometry &g, const stroke_style_s &style)
+        {
+            float params[8] = {style.dash_offset, (float)style.dash_count};
+            std::copy(style.dashes.begin(), style.dashes.begin() + style.dash_count, params + 2);
+            sgp_color_ub4 color = style.color.ub4();
+
+            const sgp_state *state = sgp_query_state();
+            sgp_blend_mode blend_mode = state->blend_mode < _SGP_BLENDMODE_NUM ? state->blend_mode : SGP_BLENDMODE_NONE;
+            sg_pipeline previous = state->pipeline;
+            const clip_mask &clip = clip_mask::get_default();
+            auto submit = [&](sg_primitive_type primitive, const sgp_point *points, const float *distances, size_t count)
+            {
+                if (count == 0)
+                    return;
+                sg_pipeline &pip = _pipelines[(clip.active ? 2 : 0) + (primitive == SG_PRIMITIVETYPE_LINES ? 1 : 0)][blend_mode];
+                if (pip.id == SG_INVALID_ID)
+                    pip = gpu::make_pipeline(_shader, blend_mode, clip.test(), SG_COLORMASK_RGBA, primitive);
+
+                _vertices.resize(count);
+                for (size_t i = 0; i < count; i++)
+                    _vertices[i] = sgp_vertex{points[i], {distances[i], 0.0f}, color};
+                sgp_set_pipeline(pip);
+                sgp_set_uniform(nullptr, 0, params, sizeof(params));
+                sgp_draw(primitive, _vertices.data(), (uint32_t)count);
+                IO2D_SUBMIT_ADD(commands, 1);
+                IO2D_SUBMIT_ADD(vertices, count);
+            };
+            if (!g.triangles.empty())
+                submit(SG_PRIMITIVETYPE_TRIANGLES, &g.triangles[0].a, g.triangle_distances.data(), g.triangles.size() * 3);
+            if (!g.lines.empty())
+                submit(SG_PRIMITIVETYPE_LINES, &g.lines[0].a, g.line_distances.data(), g.lines.size() * 2);
+            sgp_set_pipeline(previous);
+        }
+
+    protected:
+        static constexpr const char *fs_dash_glsl300es = R"(#version 300 es
+precision highp float;
+precision highp int;
+uniform highp sampler2D iTexChannel0_iSmpChannel0;
+uniform highp vec4 dash[2];
+in highp vec2 texUV;
+in highp vec4 iColor;
+layout(location = 0) out highp vec4 fragColor;
+)";
+
+        static constexpr const char *fs_dash_glsl410 = R"(#version 410
+uniform sampler2D iTexChannel0_iSmpChannel0;
+uniform vec4 dash[2];
+layout(location = 0) in vec2 texUV;
+layout(location = 1) in vec4 iColor;
+layout(location = 0) out vec4 fragColor;
+)";
+
+        // dash[0] is the offset, the number of lengths and the first 2 lengths, dash[1] the others
+        static constexpr const char *fs_dash_main = R"(
+void main()
+{
+    float lengths[6] = float[6](dash[0].z, dash[0].w, dash[1].x, dash[1].y, dash[1].z, dash[1].w);
+    int count = int(dash[0].y + 0.5);
+    float period = 0.0;
+    for (int i = 0; i < 6; i++)
+    {
+        if (i < count)
+            period += lengths[i];
+    }
+
+    float s = mod(texUV.x + dash[0].x, period);
+    for (int i = 0; i < 6; i++)
+    {
+        if (i >= count)
+            break;
+        if (s < lengths[i])
+        {
+            if (i % 2 == 1)
+                discard;
+            break;
+        }
+        s -= lengths[i];
+    }
+    fragColor = texture(iTexChannel0_iSmpChannel0, vec2(0.5)) * iColor;
+}
+)";
+
+        void setup()
+        {
+            for (auto &p : _pipelines)
+                p.fill(sg_pipeline{SG_INVALID_ID});
+            _shader.id = SG_INVALID_ID;
+
+            sg_shader_desc desc = {};
+            sg_shader_uniform_block &block = desc.uniform_blocks[SGP_UNIFORM_SLOT_FRAGMENT];
+            block.stage = SG_SHADERSTAGE_FRAGMENT;
+            block.size = 8 * sizeof(float);
+            block.glsl_uniforms[0] = {SG_UNIFORMTYPE_FLOAT4, 2, "dash"};
+            std::string fs_300es = std::string(fs_dash_glsl300es) + fs_dash_main;
+            std::string fs_410 = std::string(fs_dash_glsl410) + fs_dash_main;
+            _shader = gpu::make_shader(desc, fs_300es.c_str(), fs_410.c_str());
+            if (_shader.id != SG_INVALID_ID && sg_query_shader_state(_shader) != SG_RESOURCESTATE_VALID)
+                _shader.id = SG_INVALID_ID;
+        }
+
+    protected:
+        sg_shader _shader{SG_INVALID_ID};
+        std::array<std::array<sg_pipeline, _SGP_BLENDMODE_NUM>, 4> _pipelines{}; // Triangles, lines, clipped triangles and lines
+        std::vector<sgp_vertex> _vertices;                                       // Scratch
+    };
+
+    inline void cached_path::stroke(const stroke_style_s &style, tessellator &t) const
+    {
+        IO2D_STATS_ADD(primitives, _path.element_count());
+        dash_shader &d = dash_shader::get_default();
+        if (d.supports(style))
+            d.draw(stroke_geometry(style, t, true), style);
+        else
+            stroke_geometry(style, t).draw(style.color, style.gradient);
+        _stroked = true;
+    }
+
+    inline void geometry::draw(const rgba_color &color, const gradient *paint) const
+    {
+        draw_triangles(color, paint);
+        draw_lines(color, paint);
+    }
+
+    inline void geometry::draw_triangles(const rgba_color &color, const gradient *paint) const
+    {
+        if (!paint)
+        {
+            clip_mask::scope clip(SG_PRIMITIVETYPE_TRIANGLES);
+            return draw_triangles(color);
+        }
+        if (!triangles.empty())
+            gradient_shader::get_default().draw(*paint, SG_PRIMITIVETYPE_TRIANGLES, &triangles[0].a, triangles.size() * 3);
+    }
+
+    inline void geometry::draw_lines(const rgba_color &color, const gradient *paint) const
+    {
+        if (!paint)
+        {
+            clip_mask::scope clip(SG_PRIMITIVETYPE_LINES);
+            return draw_lines(color);
+        }
+        if (!lines.empty())
+            gradient_shader::get_default().draw(*paint, SG_PRIMITIVETYPE_LINES, &lines[0].a, lines.size() * 2);
+    }
+
+    /**
+     * @brief Layout of the vertices uploaded by static_geometry::upload()
+     */
+    enum class vertex_format : uint8_t
+    {
+        standard, // sgp_vertex: float position and texture coordinates, 32-bit color, 20 bytes
+        packed    // packed_vertex: 16-bit fixed point position, 32-bit color, 8 bytes
+    };
+
+    /**
+     * @brief A vertex of vertex_format::packed
+     *
+     * The position is normalized to the bounding box of the geometry: -32767 and 32767 are its
+     * edges, so the error is at most the box size divided by 131068.
+     */
+    class packed_vertex
+    {
+    public:
+        int16_t x;
+        int16_t y;
+        sgp_color_ub4 color;
+    };
+
+    /**
+     * @brief Fills and strokes tessellated once and uploaded into an immutable vertex buffer
+     *
+     * sokol_gp copies every vertex into its streaming buffer on each frame, even the vertices
+     * of a cached path. A static geometry is drawn from its own buffer by
+     * static_geometry_shader instead: nothing is copied or uploaded after upload(), and its
+     * vertices do not count against sgp_desc.max_vertices. It suits large backgrounds that do
+     * not change, e.g. maps.
+     *
+     * The colors are stored in the vertices, gradients are evaluated at the vertices. The
+     * geometry keeps the order fills and strokes were added in. Uploaded with
+     * vertex_format::packed the buffer takes 8 bytes per vertex instead of 20, for geometry
+     * whose size allows 16-bit positions, e.g. user interfaces.
+     */
+    class static_geometry
+    {
+    public:
+        /**
+         * @brief A run of vertices drawn with the same primitive
+         */
+        class run
+        {
+        public:
+            sg_primitive_type primitive;
+            uint32_t first;
+            uint32_t count;
+        };
+
+        static_geometry() {}
+        ~static_geometry()
+        {
+            release();
+        }
+
+        static_geometry(const static_geometry &) = delete;
+        static_geometry &operator=(const static_geometry &) = delete;
+
+        static_geometry(static_geometry &&other) noexcept
+        {
+            *this = std::move(other);
+        }
+
+        static_geometry &operator=(static_geometry &&other) noexcept
+        {
+            if (this != &other)
+            {
+                release();
+                _vertices = std::move(other._vertices);
+                _runs = std::move(other._runs);
+                _bounds = other._bounds;
+                _vertex_count = other._vertex_count;
+                _format = other._format;
+                _buffer = other._buffer;
+                other._buffer.id = SG_INVALID_ID;
+                other.clear();
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Tessellate the fill of a path and append it
+         *
+         * @param t The tessellator, its tolerance is in path units
+         */
+        void add_fill(const path &p, const fill_style_s &style, tessellator &t = tessellator::get_default())
+        {
+            _scratch.clear();
+            p.tessellate_fill(_scratch, t);
+            add(_scratch, style.color, style.gradient);
+        }
+
+        /**
+         * @brief Tessellate the stroke of a path and append it, dashes are cut on the CPU
+         *
+         * @param t The tessellator, its tolerance is in path units
+         */
+        void add_stroke(const path &p, const stroke_style_s &style, tessellator &t = tessellator::get_default())
+        {
+            _scratch.clear();
+            p.tessellate_stroke(style, _scratch, t);
+            add(_scratch, style.color, style.gradient);
+        }
+
+        /**
+         * @brief Append the triangles then the lines of a geometry
+         */
+        void add(const geometry &g, const rgba_color &color, const gradient *paint = nullptr)
+        {
+            if (!g.triangles.empty())
+                append(SG_PRIMITIVETYPE_TRIANGLES, &g.triangles[0].a, g.triangles.size() * 3, color, paint);
+            if (!g.lines.empty())
+                append(SG_PRIMITIVETYPE_LINES, &g.lines[0].a, g.lines.size() * 2, color, paint);
+        }
+
+        /**
+         * @brief Make the vertex buffer and release the vertices
+         *
+         * Nothing can be added afterwards, until clear(). When there is no GL shader the vertices
+         * are kept and drawn through sokol_gp.
+         *
+         * @param format The layout of the buffer, packed positions are rounded to 16 bits
+         * @return false if the geometry is drawn through sokol_gp
+         */
+        bool upload(vertex_format format = vertex_format::standard);
+
+        /**
+         * @brief Destroy the vertex buffer and the vertices
+         */
+        void clear()
+        {
+            release();
+            _vertices.clear();
+            _runs.clear();
+            _bounds = aabb();
+            _vertex_count = 0;
+            _format = vertex_format::standard;
+        }
+
+        bool empty() const
+        {
+            return _vertex_count == 0;
+        }
+
+        /**
+         * @brief Check if the geometry is drawn from its vertex buffer
+         */
+        bool uploaded() const
+        {
+            return _buffer.id != SG_INVALID_ID && sg_query_buffer_state(_buffer) == SG_RESOURCESTATE_VALID;
+        }
+
+        size_t vertex_count() const
+        {
+            return _vertex_count;
+        }
+
+        /**
+         * @brief Get the bounding box of the vertices, in path units
+         */
+        const aabb &bounds() const
+        {
+            return _bounds;
+        }
+
+        const std::vector<run> &runs() const
+        {
+            return _runs;
+        }
+
+        sg_buffer buffer() const
+        {
+            return _buffer;
+        }
+
+        vertex_format format() const
+        {
+            return _format;
+        }
+
+        /**
+         * @brief Get the center and the half size of the bounds, packed positions are relative to them
+         */
+        void packing(sgp_point &center, sgp_point &half_size) const
+        {
+            center = sgp_point{(_bounds.x0 + _bounds.x1) * 0.5f, (_bounds.y0 + _bounds.y1) * 0.5f};
+            // A degenerate axis keeps a non zero scale, all its positions are 0
+            half_size = sgp_point{std::max((_bounds.x1 - _bounds.x0) * 0.5f, 1e-6f), std::max((_bounds.y1 - _bounds.y0) * 0.5f, 1e-6f)};
+        }
+
+        /**
+         * @brief Draw the vertices through sokol_gp, when they could not be uploaded
+         */
+        void draw_streamed() const
+        {
+            for (const run &r : _runs)
+            {
+                clip_mask::scope clip(r.primitive);
+                sgp_draw(r.primitive, &_vertices[r.first], r.count);
+                IO2D_SUBMIT_ADD(commands, 1);
+                IO2D_SUBMIT_ADD(vertices, r.count);
+            }
+        }
+
+    protected:
+        void append(sg_primitive_type primitive, const sgp_point *points, size_t count, const rgba_color &color, const gradient *paint)
+        {
+            if (_buffer.id != SG_INVALID_ID)
+                return;
+
+            // Consecutive runs of the same primitive are drawn at once
+            if (_runs.empty() || _runs.back().primitive != primitive)
+                _runs.emplace_back(run{primitive, (uint32_t)_vertex_count, 0});
+            _runs.back().count += (uint32_t)count;
+
+            sgp_color_ub4 c = color.ub4();
+            for (size_t i = 0; i < count; i++)
+            {
+                if (paint)
+                    c = paint->color_at(points[i]).ub4();
+                _vertices.emplace_back(sgp_vertex{points[i], {0.0f, 0.0f}, c});
+                _bounds.add(points[i]);
+            }
+            _vertex_count += count;
+        }
+
+        void release()
+        {
+            if (_buffer.id != SG_INVALID_ID && sg_isvalid())
+                sg_destroy_buffer(_buffer);
+            _buffer.id = SG_INVALID_ID;
+        }
+
+    protected:
+        std::vector<sgp_vertex> _vertices; // Released by upload()
+        std::vector<run> _runs;
+        aabb _bounds;
+        size_t _vertex_count = 0;
+        vertex_format _format = vertex_format::standard;
+        sg_buffer _buffer{SG_INVALID_ID};
+        geometry _scratch;
+    };
+
+    /**
+     * @brief Draws static_geometry buffers with the projection and transform in a uniform
+     *
+     * The sokol_gp vertex shader expects vertices already transformed on the CPU. This one
+     * transforms them itself, so the same buffer is drawn at any position, rotation or zoom.
+     * The draws are issued to sokol_gfx directly: the render pass must be active and the
+     * sokol_gp commands recorded before must have been flushed, see canvas::flush().
+     */
+    class static_geometry_shader
+    {
+    public:
+        /**
+         * @brief Get the static geometry pipelines of the calling thread
+         */
+        static static_geometry_shader &get_default()
+        {
+            thread_local static_geometry_shader s;
+            return s;
+        }
+
+        /**
+         * @brief Check if the shader can be used, the shader is made if needed
+         */
+        bool available()
+        {
+            if (gpu::needs_setup(_shader))
+                setup();
+
+            return _shader.id != SG_INVALID_ID;
+        }
+
+        /**
+         * @brief Draw an uploaded geometry
+         *
+         * @param mvp The projection multiplied by the transform, like the sgp_state::mvp of a draw
+         * @param blend_mode The blend mode, like the sokol_gp draws
+         */
+        void draw(const static_geometry &g, const sgp_mat2x3 &mvp, sgp_blend_mode blend_mode)
+        {
+            if (!g.uploaded() || !available())
+                return;
+
+            blend_mode = blend_mode < _SGP_BLENDMODE_NUM ? blend_mode : SGP_BLENDMODE_NONE;
+            const clip_mask &clip = clip_mask::get_default();
+            bool packed = g.format() == vertex_format::packed;
+            sgp_point center = {0.0f, 0.0f}, half_size = {1.0f, 1.0f};
+            if (packed)
+                g.packing(center, half_size);
+            const float uniform[12] = {mvp.v[0][0], mvp.v[0][1], mvp.v[0][2], 0.0f,
+                                       mvp.v[1][0], mvp.v[1][1], mvp.v[1][2], 0.0f,
+                                       center.x, center.y, half_size.x, half_size.y};
+            sg_bindings bind = {};
+            bind.vertex_buffers[0] = g.buffer();
+            bind.images[0] = _white;
+            bind.samplers[0] = _sampler;
+
+            for (const static_geometry::run &r : g.runs())
+            {
+                sg_pipeline &pip = _pipelines[packed][(clip.active ? 2 : 0) + (r.primitive == SG_PRIMITIVETYPE_LINES ? 1 : 0)][blend_mode];
+                if (pip.id == SG_INVALID_ID)
+                    pip = make_pipeline(packed, blend_mode, r.primitive, clip.test());
+                if (pip.id == SG_INVALID_ID)
+                    continue;
+
+                sg_apply_pipeline(pip);
+                sg_apply_bindings(&bind);
+                sg_apply_uniforms(SGP_UNIFORM_SLOT_VERTEX, SG_RANGE(uniform));
+                sg_draw((int)r.first, (int)r.count, 1);
+                IO2D_STATS_ADD(commands, 1);
+                IO2D_STATS_ADD(static_vertices, r.count);
+            }
+        }
+
+    protected:
+        // mvp holds the 2 rows of the 2x3 matrix, then the offset and the scale of the positions
+        static constexpr const char *vs_static_glsl300es = R"(#version 300 es
+uniform highp vec4 mvp[3];
+layout(location = 0) in vec4 coord;
+layout(location = 1) in vec4 color;
+out vec2 texUV;
+out vec4 iColor;
+void main()
+{
+    vec3 p = vec3(mvp[2].xy + coord.xy * mvp[2].zw, 1.0);
+    gl_Position = vec4(dot(mvp[0].xyz, p), dot(mvp[1].xyz, p), 0.0, 1.0);
+    texUV = coord.zw;
+    iColor = color;
+}
+)";
+
+        static constexpr const char *vs_static_glsl410 = R"(#version 410
+uniform vec4 mvp[3];
+layout(location = 0) in vec4 coord;
+layout(location = 1) in vec4 color;
+layout(location = 0) out vec2 texUV;
+layout(location = 1) out vec4 iColor;
+void main()
+{
+    vec3 p = vec3(mvp[2].xy + coord.xy * mvp[2].zw, 1.0);
+    gl_Position = vec4(dot(mvp[0].xyz, p), dot(mvp[1].xyz, p), 0.0, 1.0);
+    texUV = coord.zw;
+    iColor = color;
+}
+)";
+
+        void setup()
+        {
+            for (auto &format : _pipelines)
+                for (auto &p : format)
+                    p.fill(sg_pipeline{SG_INVALID_ID});
+            _shader.id = SG_INVALID_ID;
+
+            sg_shader_desc desc = {};
+            sg_shader_uniform_block &block = desc.uniform_blocks[SGP_UNIFORM_SLOT_VERTEX];
+            block.stage = SG_SHADERSTAGE_VERTEX;
+            block.size = 12 * sizeof(float);
+            block.glsl_uniforms[0] = {SG_UNIFORMTYPE_FLOAT4, 3, "mvp"};
+            _shader = gpu::make_shader(desc, gpu::fs_glsl300es, gpu::fs_glsl410, vs_static_glsl300es, vs_static_glsl410);
+            if (_shader.id == SG_INVALID_ID || sg_query_shader_state(_shader) != SG_RESOURCESTATE_VALID)
+            {
+                _shader.id = SG_INVALID_ID;
+                return;
+            }
+
+            // The sokol_gp fragment shader samples its texture, a white texel keeps the vertex colors
+            static const uint32_t white = 0xffffffff;
+            sg_image_desc img = {};
+            img.width = 1;
+            img.height = 1;
+            img.data.subimage[0][0] = SG_RANGE(white);
+            _white = sg_make_image(&img);
+
+            sg_sampler_desc smp = {};
+            smp.min_filter = SG_FILTER_NEAREST;
+            smp.mag_filter = SG_FILTER_NEAREST;
+            _sampler = sg_make_sampler(&smp);
+        }
+
+        sg_pipeline make_pipeline(bool packed, sgp_blend_mode blend_mode, sg_primitive_type primitive, const sg_stencil_state &stencil)
+        {
+            sg_pipeline_desc desc = gpu::pipeline_desc(_shader, blend_mode, stencil, SG_COLORMASK_RGBA, primitive);
+            if (packed)
+            {
+                // The missing texture coordinates read as (0, 1), inside the white texel
+                desc.layout.buffers[0].stride = sizeof(packed_vertex);
+                desc.layout.attrs[SGP_VS_ATTR_COORD].offset = offsetof(packed_vertex, x);
+                desc.layout.attrs[SGP_VS_ATTR_COORD].format = SG_VERTEXFORMAT_SHORT2N;
+                desc.layout.attrs[SGP_VS_ATTR_COLOR].offset = offsetof(packed_vertex, color);
+                desc.layout.attrs[SGP_VS_ATTR_COLOR].format = SG_VERTEXFORMAT_UBYTE4N;
+            }
+            return gpu::make_pipeline(desc);
+        }
+
+    protected:
+        sg_shader _shader{SG_INVALID_ID};
+        std::array<std::array<std::array<sg_pipeline, _SGP_BLENDMODE_NUM>, 4>, 2> _pipelines{}; // By format, then triangles, lines, clipped triangles and lines
+        sg_image _white{SG_INVALID_ID};
+        sg_sampler _sampler{SG_INVALID_ID};
+    };
+
+    inline bool static_geometry::upload(vertex_format format)
+    {
+        if (_buffer.id != SG_INVALID_ID || _vertices.empty() || !static_geometry_shader::get_default().available())
+            return uploaded();
+
+        sg_buffer_desc desc = {};
+        desc.usage = SG_USAGE_IMMUTABLE;
+        std::vector<packed_vertex> packed;
+        if (format == vertex_format::packed)
+        {
+            sgp_point center, half_size;
+            packing(center, half_size);
+            auto quantize = [](float v)
+            { return static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f)); };
+
+            packed.reserve(_vertices.size());
+            for (const sgp_vertex &v : _vertices)
+                packed.push_back(packed_vertex{quantize((v.position.x - center.x) / half_size.x),
+                                               quantize((v.position.y - center.y) / half_size.y), v.color});
+            desc.data = sg_range{packed.data(), packed.size() * sizeof(packed_vertex)};
+        }
+        else
+            desc.data = sg_range{_vertices.data(), _vertices.size() * sizeof(sgp_vertex)};
+        _buffer = sg_make_buffer(&desc);
+        if (sg_query_buffer_state(_buffer) != SG_RESOURCESTATE_VALID)
+        {
+            release();
+            return false;
+        }
+        _format = format;
+
+        std::vector<sgp_vertex>().swap(_vertices);
+        _scratch = geometry();
+        return true;
+    }
+
+    /**
+     * @brief Stencil then cover fill of paths with a fill rule
+     *
+     * The path outlines are fanned into the stencil buffer with the color writes disabled:
+     * with nonzero front faces increment and back faces decrement the stencil value, with
+     * evenodd every triangle inverts it. The bounding box is then covered drawing only where
+     * the stencil is not zero, and the stencil is reset to zero at the same time. Only the
+     * lower bits of clip_mask are used, and only inside the clip while one is active.
+     *
+     * The pipelines are made the first time they are used. The render pass must have a
+     * depth-stencil attachment, when sokol_gp has been set up without one available()
+     * returns false.
+     */
+    class stencil_fill
+    {
+    public:
+        /**
+         * @brief Get the stencil pipelines of the calling thread
+         */
+        static stencil_fill &get_default()
+        {
+            thread_local stencil_fill s;
+            return s;
+        }
+
+        /**
+         * @brief Check if the stencil fill can be used, the pipelines are made if needed
+         */
+        bool available()
+        {
+            if (sgp_query_desc().depth_format != SG_PIXELFORMAT_DEPTH_STENCIL)
+                return false;
+
+            if (gpu::needs_setup(_shader))
+                setup();
+
+            return _shader.id != SG_INVALID_ID && clip_mask::get_default().available();
+        }
+
+        /**
+         * @brief Fill the triangles fans with the current color using the fill rule
+         *
+         * @param triangles The fans built by path::tessellate_stencil()
+         * @param bounds The rectangle covering all the triangles
+         * @param rule The fill rule
+         * @param paint Gradient covering the fill instead of the current color, can be null
+         */
+        void draw(const std::vector<sgp_triangle> &triangles, const sgp_rect &bounds, fill_rule rule,
+                  const gradient *paint = nullptr)
+        {
+            sgp_blend_mode blend_mode = sgp_query_state()->blend_mode;
+            sg_pipeline &cover = _cover[blend_mode];
+            if (cover.id == SG_INVALID_ID)
+                cover = gpu::make_pipeline(_shader, blend_mode, cover_stencil());
+
+            sgp_set_pipeline(clip_mask::get_default().count_pipeline(rule));
+            sgp_draw_filled_triangles(triangles.data(), triangles.size());
+            sgp_set_pipeline(cover);
+            if (paint)
+            {
+                float x1 = bounds.x + bounds.w;
+                float y1 = bounds.y + bounds.h;
+                const sgp_point quad[6] = {{bounds.x, bounds.y}, {x1, bounds.y}, {x1, y1},
+                                           {bounds.x, bounds.y}, {x1, y1}, {bounds.x, y1}};
+                gradient_shader::get_default().draw(*paint, SG_PRIMITIVETYPE_TRIANGLES, quad, 6, cover_stencil());
+            }
+            else
+            {
+                sgp_draw_filled_rect(bounds.x, bounds.y, bounds.w, bounds.h);
+                IO2D_SUBMIT_ADD(commands, 1);
+                IO2D_SUBMIT_ADD(vertices, 6);
+            }
+            sgp_reset_pipeline();
+            IO2D_SUBMIT_ADD(commands, 1);
+            IO2D_SUBMIT_ADD(vertices, triangles.size() * 3);
+        }
+
+    protected:
+        void setup()
+        {
+            _shader = gpu::make_shader(sg_shader_desc{});
+            _cover.fill(sg_pipeline{SG_INVALID_ID});
+            if (_shader.id != SG_INVALID_ID && sg_query_shader_state(_shader) != SG_RESOURCESTATE_VALID)
+            {
+                sg_destroy_shader(_shader);
+                _shader.id = SG_INVALID_ID;
+            }
+        }
+
+        static sg_stencil_state cover_stencil()
+        {
+            sg_stencil_state s = {};
+            s.enabled = true;
+            s.front = {SG_COMPAREFUNC_NOT_EQUAL, SG_STENCILOP_KEEP, SG_STENCILOP_KEEP, SG_STENCILOP_ZERO};
+            s.back = s.front;
+            s.read_mask = clip_mask::count_mask;
+            s.write_mask = clip_mask::count_mask;
+            s.ref = 0;
+            return s;
+        }
+
+    protected:
+        sg_shader _shader{SG_INVALID_ID};
+        std::array<sg_pipeline, _SGP_BLENDMODE_NUM> _cover{};
+    };
+
+    /**
+     * @brief A filled rectangle drawn by canvas::draw_rects()
+     */
+    class rect_instance
+    {
+    public:
+        sgp_rect rect;
+        rgba_color color;
+    };
+
+    /**
+     * @brief A filled circle drawn by canvas::draw_circles()
+     */
+    class circle_instance
+    {
+    public:
+        sgp_point center;
+        float radius;
+        rgba_color color;
+    };
+
+    /**
+     * @brief Draws large batches of rectangles and circles differing only by position, size and color
+     *
+     * sokol_gp has no instanced draws and its command queue must keep the draw order, so every
+     * instance is expanded into one quad of 6 vertices carrying its color, and a whole batch is
+     * queued with a single sgp_draw(). Circles are not tessellated: their quad has coordinates
+     * going from -1 to 1 at the radius and a distance fragment shader cuts the disc. With a
+     * blending mode the edge is antialiased, without blending it is sharp.
+     *
+     * When the shader is not available, e.g. on a backend without GLSL, circles are tessellated.
+     */
+    class shape_batch
+    {
+    public:
+        /**
+         * @brief Get the shape pipelines of the calling thread
+         */
+        static shape_batch &get_default()
+        {
+            thread_local shape_batch b;
+            return b;
+        }
+
+        /**
+         * @brief How the edge coverage of a shader cut shape is applied, it depends on the blend mode
+         */
+        enum class coverage
+        {
+            none,          // No blending, pixels outside the shape are discarded
+            alpha,         // The alpha is multiplied by the coverage
+            premultiplied, // The whole color is multiplied by the coverage
+            count
+        };
+
+        /**
+         * @brief Get how the edge coverage is applied with a blend mode
+         */
+        static coverage blend_coverage(sgp_blend_mode blend_mode)
+        {
+            switch (blend_mode)
+            {
+            case SGP_BLENDMODE_BLEND:
+            case SGP_BLENDMODE_ADD:
+                return coverage::alpha;
+            case SGP_BLENDMODE_BLEND_PREMULTIPLIED:
+            case SGP_BLENDMODE_ADD_PREMULTIPLIED:
+            case SGP_BLENDMODE_MUL:
+                return coverage::premultiplied;
+            default:
+                return coverage::none;
+            }
+        }
+
+        void draw_rects(const rect_instance *rects, size_t count)
+        {
+            for (size_t first = 0; first < count; first += max_batch)
+            {
+                size_t n = std::min(count - first, max_batch);
+                _vertices.resize(n * 6);
+                sgp_vertex *v = _vertices.data();
+                for (size_t i = 0; i < n; i++, v += 6)
+                {
+                    const sgp_rect &r = rects[first + i].rect;
+                    write_quad(v, r.x, r.y, r.x + r.w, r.y + r.h, 0.0f, rects[first + i].color.ub4());
+                }
+                submit(nullptr);
+            }
+        }
+
+        void draw_circles(const circle_instance *circles, size_t count)
+        {
+            const sgp_state *state = sgp_query_state();
+            float scale = mat2x3_max_scale(state->transform);
+            sg_pipeline pip = circle_pipeline(state->blend_mode);
+            if (pip.id == SG_INVALID_ID)
+            {
+                draw_tessellated_circles(circles, count, scale > 0.0f ? default_tessellation_tolerance / scale : default_tessellation_tolerance);
+                return;
+            }
+
+            // The quads are grown by one pixel so the antialiased edge is not cut
+            float pixel = scale > 0.0f ? 1.0f / scale : 1.0f;
+            for (size_t first = 0; first < count; first += max_batch)
+            {
+                size_t n = std::min(count - first, max_batch);
+                _vertices.resize(n * 6);
+                sgp_vertex *v = _vertices.data();
+                for (size_t i = 0; i < n; i++, v += 6)
+                {
+                    const circle_instance &c = circles[first + i];
+                    float r = c.radius + pixel;
+                    float uv = c.radius > 0.0f ? r / c.radius : 0.0f;
+                    write_quad(v, c.center.x - r, c.center.y - r, c.center.x + r, c.center.y + r, uv, c.color.ub4());
+                }
+                submit(&pip);
+            }
+        }
+
+        static constexpr size_t max_batch = 4096; // Instances queued by one sgp_draw()
+
+    protected:
+        static constexpr const char *fs_circle_glsl300es = R"(#version 300 es
+precision mediump float;
+uniform highp sampler2D iTexChannel0_iSmpChannel0;
+in highp vec2 texUV;
+in highp vec4 iColor;
+layout(location = 0) out highp vec4 fragColor;
+)";
+
+        static constexpr const char *fs_circle_glsl410 = R"(#version 410
+uniform sampler2D iTexChannel0_iSmpChannel0;
+layout(location = 0) in vec2 texUV;
+layout(location = 1) in vec4 iColor;
+layout(location = 0) out vec4 fragColor;
+)";
+
+        // The bound image, white by default, is mapped on the square enclosing the disc
+        static constexpr const char *fs_circle_main = R"(
+void main()
+{
+    float d = length(texUV);
+    vec4 color = texture(iTexChannel0_iSmpChannel0, texUV * 0.5 + 0.5) * iColor;
+#if COVERAGE == 0
+    if (d > 1.0)
+        discard;
+    fragColor = color;
+#else
+    float c = clamp((1.0 - d) / max(fwidth(d), 1e-6) + 0.5, 0.0, 1.0);
+    if (c <= 0.0)
+        discard;
+#if COVERAGE == 1
+    fragColor = vec4(color.rgb, color.a * c);
+#else
+    fragColor = color * c;
+#endif
+#endif
+}
+)";
+
+        /**
+         * @brief Get the circle pipeline for a blend mode, made the first time it is used
+         */
+        sg_pipeline circle_pipeline(sgp_blend_mode blend_mode)
+        {
+            if (blend_mode >= _SGP_BLENDMODE_NUM)
+                blend_mode = SGP_BLENDMODE_NONE;
+
+            const clip_mask &clip = clip_mask::get_default();
+            sg_pipeline &pip = _circle[clip.active][blend_mode];
+            if (!gpu::needs_setup(pip))
+                return pip;
+
+            sg_shader &shader = _shaders[(int)blend_coverage(blend_mode)];
+            if (gpu::needs_setup(shader))
+            {
+                std::string define = "#define COVERAGE " + std::to_string((int)blend_coverage(blend_mode)) + "\n";
+                std::string fs_300es = fs_circle_glsl300es + define + fs_circle_main;
+                std::string fs_410 = fs_circle_glsl410 + define + fs_circle_main;
+                shader = gpu::make_shader(sg_shader_desc{}, fs_300es.c_str(), fs_410.c_str());
+            }
+
+            pip = shader.id != SG_INVALID_ID ? gpu::make_pipeline(shader, blend_mode, clip.test()) : sg_pipeline{SG_INVALID_ID};
+            return pip;
+        }
+
+        /**
+         * @brief Tessellate the circles, used when the circle shader is not available
+         */
+        void draw_tessellated_circles(const circle_instance *circles, size_t count, float tolerance)
+        {
+            _vertices.clear();
+            for (size_t i = 0; i < count; i++)
+            {
+                const circle_instance &c = circles[i];
+                _triangles.clear();
+                path_ellipse::append_ellipse_triangles(sgp_point{c.center.x - c.radius, c.center.y - c.radius},
+                                                       sgp_point{c.center.x + c.radius, c.center.y + c.radius},
+                                                       0.0f, M_PI * 2, _triangles, tolerance);
+                sgp_color_ub4 color = c.color.ub4();
+                for (const sgp_triangle &t : _triangles)
+                {
+                    _vertices.push_back(sgp_vertex{t.a, {0.0f, 0.0f}, color});
+                    _vertices.push_back(sgp_vertex{t.b, {0.0f, 0.0f}, color});
+                    _vertices.push_back(sgp_vertex{t.c, {0.0f, 0.0f}, color});
+                }
+            }
+            submit(nullptr);
+        }
+
+        /**
+         * @brief Queue the vertices with the given pipeline, or the sokol_gp one when null
+         */
+        void submit(const sg_pipeline *pip)
+        {
+            if (_vertices.empty())
+                return;
+
+            if (pip)
+            {
+                sgp_set_pipeline(*pip);
+                sgp_draw(SG_PRIMITIVETYPE_TRIANGLES, _vertices.data(), _vertices.size());
+                sgp_reset_pipeline();
+            }
+            else
+            {
+                clip_mask::scope clip(SG_PRIMITIVETYPE_TRIANGLES);
+                sgp_draw(SG_PRIMITIVETYPE_TRIANGLES, _vertices.data(), _vertices.size());
+            }
+            IO2D_SUBMIT_ADD(commands, 1);
+            IO2D_SUBMIT_ADD(vertices, _vertices.size());
+        }
+
+        /**
+         * @brief Write the 2 triangles of a quad, the texture coordinates go from -uv to uv
+         */
+        static void write_quad(sgp_vertex *v, float x0, float y0, float x1, float y1, float uv, sgp_color_ub4 color)
+        {
+            v[0] = sgp_vertex{{x0, y0}, {-uv, -uv}, color};
+            v[1] = sgp_vertex{{x1, y0}, {uv, -uv}, color};
+            v[2] = sgp_vertex{{x1, y1}, {uv, uv}, color};
+            v[3] = v[0];
+            v[4] = v[2];
+            v[5] = sgp_vertex{{x0, y1}, {-uv, uv}, color};
+        }
+
+    protected:
+        std::array<sg_shader, (size_t)coverage::count> _shaders{};
+        std::array<std::array<sg_pipeline, _SGP_BLENDMODE_NUM>, 2> _circle{}; // By clipped
+        std::vector<sgp_vertex> _vertices;
+        std::vector<sgp_triangle> _triangles;
+    };
+
+    /**
+     * @brief Antialiased ellipses, rounded rectangles and thick lines drawn as one quad each
+     *
+     * The fragment shader evaluates the signed distance to the shape and derives the edge
+     * coverage from its screen space derivative, so edges are smooth without MSAA, and the fill
+     * and the stroke are composited in the same draw. The parameters of the shapes drawn in a
+     * frame are stored in a float texture uploaded when the frame ends, each quad finds its
+     * shape from the index stored in its vertex color. All the quads of a frame share the same
+     * pipeline and image, so sokol_gp merges consecutive shapes into one draw.
+     *
+     * The texture holds a fixed number of shapes per frame. When a frame needs more, draw()
+     * returns false for the extra shapes and the texture is grown at the start of the next frame.
+     */
+    class sdf_shapes
+    {
+    public:
+        enum class kind
+        {
+            ellipse,
+            roundrect
+        };
+
+        static constexpr int texture_width = 1024;   // Texels per row
+        static constexpr int texels_per_shape = 4;   // Size and x radius, stroke width and y radius, fill color, stroke color
+        static constexpr size_t floats_per_shape = texels_per_shape * 4;
+
+        /**
+         * @brief Get the shape pipelines and texture of the calling thread
+         */
+        static sdf_shapes &get_default()
+        {
+            thread_local sdf_shapes s;
+            return s;
+        }
+
+        /**
+         * @brief Check if the shader can be used, the texture and the coverage shaders are made if needed
+         */
+        bool available()
+        {
+            if (gpu::needs_setup(_shaders[0]))
+                setup();
+
+            return _shaders[0].id != SG_INVALID_ID;
+        }
+
+        /**
+         * @brief Queue the quad of a shape and append its parameters to the frame texels
+         *
+         * @param texels The parameters of the shapes of the frame, see upload()
+         * @param center The center of the shape
+         * @param axis Unit vector of the shape x axis, the y axis is perpendicular
+         * @param half_size Half width and height of the shape, the ellipse radii
+         * @param rx Corner radius along x of a roundrect, 0 for ellipses
+         * @param ry Corner radius along y of a roundrect, 0 for ellipses
+         * @param half_stroke Half the stroke width, 0 to only fill the shape
+         * @return false when the texture is full, nothing is drawn
+         */
+        bool draw(std::vector<float> &texels, kind k, const sgp_point &center, const sgp_point &axis, const sgp_point &half_size,
+                  float rx, float ry, float half_stroke, const rgba_color &fill, const rgba_color &stroke)
+        {
+            size_t index = texels.size() / floats_per_shape;
+            if (index == 0)
+                begin_frame();
+            if (index >= _capacity)
+            {
+                _wanted = std::max(_wanted, index + 1);
+                return false;
+            }
+
+            const sgp_state *state = sgp_query_state();
+            const clip_mask &clip = clip_mask::get_default();
+            sg_pipeline &pip = _pipelines[clip.active][state->blend_mode < _SGP_BLENDMODE_NUM ? state->blend_mode : SGP_BLENDMODE_NONE];
+            if (pip.id == SG_INVALID_ID)
+                pip = gpu::make_pipeline(_shaders[(int)shape_batch::blend_coverage(state->blend_mode)], state->blend_mode, clip.test());
+
+            const float params[floats_per_shape] = {
+                (float)k, half_size.x, half_size.y, rx,
+                half_stroke, ry, 0.0f, 0.0f,
+                fill.r, fill.g, fill.b, fill.a,
+                stroke.r, stroke.g, stroke.b, stroke.a};
+            texels.insert(texels.end(), params, params + floats_per_shape);
+
+            // The quad covers the stroke and one more pixel for the antialiased edge
+            float scale = mat2x3_max_scale(state->transform);
+            float pad = half_stroke + (scale > 0.0f ? 1.0f / scale : 1.0f);
+            float ex = half_size.x + pad;
+            float ey = half_size.y + pad;
+            sgp_point u = {axis.x * ex, axis.y * ex};
+            sgp_point v = {-axis.y * ey, axis.x * ey};
+            sgp_color_ub4 id = {(uint8_t)(index & 0xff), (uint8_t)((index >> 8) & 0xff), (uint8_t)((index >> 16) & 0xff), 255};
+
+            sgp_vertex quad[6];
+            quad[0] = sgp_vertex{{center.x - u.x - v.x, center.y - u.y - v.y}, {-ex, -ey}, id};
+            quad[1] = sgp_vertex{{center.x + u.x - v.x, center.y + u.y - v.y}, {ex, -ey}, id};
+            quad[2] = sgp_vertex{{center.x + u.x + v.x, center.y + u.y + v.y}, {ex, ey}, id};
+            quad[3] = quad[0];
+            quad[4] = quad[2];
+            quad[5] = sgp_vertex{{center.x - u.x + v.x, center.y - u.y + v.y}, {-ex, ey}, id};
+
+            sgp_set_pipeline(pip);
+            sgp_set_image(0, _texture);
+            sgp_set_sampler(0, _sampler);
+            sgp_draw(SG_PRIMITIVETYPE_TRIANGLES, quad, 6);
+            sgp_reset_sampler(0);
+            sgp_reset_image(0);
+            sgp_reset_pipeline();
+            IO2D_SUBMIT_ADD(commands, 1);
+            IO2D_SUBMIT_ADD(vertices, 6);
+            return true;
+        }
+
+        /**
+         * @brief Upload the parameters of the shapes of the frame, call it once before the frame is flushed
+         */
+        void upload(std::vector<float> &texels)
+        {
+            if (texels.empty() || _texture.id == SG_INVALID_ID)
+                return;
+
+            // The whole image must be updated
+            texels.resize(_capacity * floats_per_shape, 0.0f);
+            sg_image_data data = {};
+            data.subimage[0][0] = sg_range{texels.data(), texels.size() * sizeof(float)};
+            sg_update_image(_texture, &data);
+        }
+
+    protected:
+        static constexpr const char *fs_shape_glsl300es = R"(#version 300 es
+precision highp float;
+precision highp int;
+uniform highp sampler2D iTexChannel0_iSmpChannel0;
+in highp vec2 texUV;
+in highp vec4 iColor;
+layout(location = 0) out highp vec4 fragColor;
+)";
+
+        static constexpr const char *fs_shape_glsl410 = R"(#version 410
+uniform sampler2D iTexChannel0_iSmpChannel0;
+layout(location = 0) in vec2 texUV;
+layout(location = 1) in vec4 iColor;
+layout(location = 0) out vec4 fragColor;
+)";
+
+        // Approximate ellipse distance from its implicit function and gradient, exact for circles
+        static constexpr const char *fs_shape_main = R"(
+float sd_ellipse(vec2 p, vec2 ab)
+{
+    float k0 = length(p / ab);
+    float k1 = length(p / (ab * ab));
+    return k1 > 0.0 ? k0 * (k0 - 1.0) / k1 : -min(ab.x, ab.y);
+}
+
+// Elliptical corners use the ellipse distance, the straight edges the exact box distance
+float sd_roundrect(vec2 p, vec2 h, vec2 r)
+{
+    vec2 q = abs(p) - h + r;
+    if (q.x > 0.0 && q.y > 0.0 && min(r.x, r.y) > 0.0)
+        return sd_ellipse(q, r);
+    vec2 e = abs(p) - h;
+    return max(e.x, e.y);
+}
+
+void main()
+{
+    ivec3 id = ivec3(iColor.rgb * 255.0 + 0.5);
+    int texel = (id.r + id.g * 256 + id.b * 65536) * 4;
+    ivec2 at = ivec2(texel % 1024, texel / 1024);
+    vec4 shape = texelFetch(iTexChannel0_iSmpChannel0, at, 0);
+    vec4 stroke = texelFetch(iTexChannel0_iSmpChannel0, at + ivec2(1, 0), 0);
+    vec4 fill_color = texelFetch(iTexChannel0_iSmpChannel0, at + ivec2(2, 0), 0);
+    vec4 stroke_color = texelFetch(iTexChannel0_iSmpChannel0, at + ivec2(3, 0), 0);
+
+    float d;
+    if (shape.x < 0.5)
+        d = sd_ellipse(texUV, shape.yz);
+    else
+        d = sd_roundrect(texUV, shape.yz, vec2(shape.w, stroke.y));
+
+    float aa = max(fwidth(d), 1e-6);
+    float fill_a = fill_color.a * clamp(0.5 - d / aa, 0.0, 1.0);
+    float stroke_a = stroke.x > 0.0 ? stroke_color.a * clamp(0.5 - (abs(d) - stroke.x) / aa, 0.0, 1.0) : 0.0;
+
+    // Stroke over fill, premultiplied
+    float a = stroke_a + fill_a * (1.0 - stroke_a);
+    vec3 rgb = stroke_color.rgb * stroke_a + fill_color.rgb * fill_a * (1.0 - stroke_a);
+    if (a <= 0.0)
+        discard;
+#if COVERAGE == 0
+    if (a < 0.5)
+        discard;
+    fragColor = vec4(rgb / a, 1.0);
+#elif COVERAGE == 1
+    fragColor = vec4(rgb / a, a);
+#else
+    fragColor = vec4(rgb, a);
+#endif
+}
+)";
+
+        void setup()
+        {
+            for (auto &p : _pipelines)
+                p.fill(sg_pipeline{SG_INVALID_ID});
+            _shaders.fill(sg_shader{SG_INVALID_ID});
+            _texture.id = SG_INVALID_ID;
+            _capacity = 0;
+
+            if (!sg_query_pixelformat(SG_PIXELFORMAT_RGBA32F).sample)
+                return;
+
+            sg_shader_desc desc = {};
+            desc.images[0].sample_type = SG_IMAGESAMPLETYPE_UNFILTERABLE_FLOAT;
+            desc.samplers[0].sampler_type = SG_SAMPLERTYPE_NONFILTERING;
+            for (size_t c = 0; c < _shaders.size(); c++)
+            {
+                std::string define = "#define COVERAGE " + std::to_string(c) + "\n";
+                std::string fs_300es = fs_shape_glsl300es + define + fs_shape_main;
+                std::string fs_410 = fs_shape_glsl410 + define + fs_shape_main;
+                _shaders[c] = gpu::make_shader(desc, fs_300es.c_str(), fs_410.c_str());
+                if (_shaders[c].id == SG_INVALID_ID || sg_query_shader_state(_shaders[c]) != SG_RESOURCESTATE_VALID)
+                {
+                    _shaders[0].id = SG_INVALID_ID;
+                    return;
+                }
+            }
+
+            sg_sampler_desc smp = {};
+            smp.min_filter = SG_FILTER_NEAREST;
+            smp.mag_filter = SG_FILTER_NEAREST;
+            _sampler = sg_make_sampler(&smp);
+
+            _wanted = std::max(_wanted, initial_capacity);
+            begin_frame();
+        }
+
+        /**
+         * @brief Grow the texture if the last frames needed more shapes, no draw of the frame uses it yet
+         */
+        void begin_frame()
+        {
+            if (_wanted <= _capacity)
+                return;
+
+            size_t rows = 1;
+            while (rows * (texture_width / texels_per_shape) < _wanted)
+                rows *= 2;
+
+            sg_destroy_image(_texture);
+            sg_image_desc desc = {};
+            desc.width = texture_width;
+            desc.height = (int)rows;
+            desc.usage = SG_USAGE_STREAM;
+            desc.pixel_format = SG_PIXELFORMAT_RGBA32F;
+            _texture = sg_make_image(&desc);
+            _capacity = _texture.id != SG_INVALID_ID ? rows * (texture_width / texels_per_shape) : 0;
+        }
+
+    protected:
+        static constexpr size_t initial_capacity = 1024;
+
+        std::array<sg_shader, (size_t)shape_batch::coverage::count> _shaders{};
+        std::array<std::array<sg_pipeline, _SGP_BLENDMODE_NUM>, 2> _pipelines{}; // By clipped
+        sg_image _texture{SG_INVALID_ID};
+        sg_sampler _sampler{SG_INVALID_ID};
+        size_t _capacity = 0; // Shapes the texture can hold
+        size_t _wanted = 0;   // Shapes needed by the largest frame
+    };
+
+    /**
+     * @brief Images packed into a few large textures, so that drawing them does not rebind textures
+     *
+     * Every page is a dynamic RGBA8 image with a copy of its pixels on the CPU. Images are packed
+     * in shelves, rows as high as their tallest image, with their edge pixels repeated around them
+     * so linear filtering does not bleed between neighbours. Images larger than a page get a page
+     * of their own. Nothing is removed from the atlas.
+     *
+     * add() copies pixels at once. load() decodes a file with stb_image on a background thread
+     * and returns at once: until update() packs the decoded pixels the image is drawn as a
+     * placeholder. The pages are uploaded by upload(), which the canvas calls before flushing.
+     */
+    class image_atlas
+    {
+    public:
+        enum class image_state
+        {
+            loading,
+            ready,
+            failed
+        };
+
+        static constexpr int default_page_size = 1024;
+        static constexpr int padding = 1;                      // Edge pixels repeated around every image
+        static constexpr uint32_t placeholder_color = 0x40808080; // Shown while loading, ARGB like rgba_color(uint32_t)
+        static constexpr int placeholder_size = 32;             // Size of the placeholder of an image drawn at its size while loading
+
+        /**
+         * @param page_size The width and height of the pages
+         */
+        explicit image_atlas(int page_size = default_page_size) : _page_size(page_size) {}
+
+        image_atlas(const image_atlas &) = delete;
+        image_atlas &operator=(const image_atlas &) = delete;
+
+        ~image_atlas()
+        {
+            if (_thread.joinable())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _stop = true;
+                }
+                _wake.notify_one();
+                _thread.join();
+            }
+            for (decoded &d : _decoded)
+                stbi_image_free(d.pixels);
+        }
+
+        /**
+         * @brief Get the atlas drawn by the canvases of the calling thread
+         */
+        static image_atlas &get_default()
+        {
+            thread_local image_atlas atlas;
+            return atlas;
+        }
+
+        /**
+         * @brief Add an image from its pixels
+         *
+         * @param rgba The pixels, 4 bytes per pixel, rows from top to bottom without gaps
+         * @return The image identifier, never 0
+         */
+        uint32_t add(const uint8_t *rgba, int w, int h)
+        {
+            uint32_t id = new_entry();
+            pack(id, rgba, w, h);
+            return id;
+        }
+
+        /**
+         * @brief Decode an image file on the background thread
+         *
+         * @return The image identifier, never 0. The image is drawn once update() has packed it,
+         *         or not at all if the file cannot be decoded
+         */
+        uint32_t load(const std::string &filename)
+        {
+            uint32_t id = new_entry();
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _requests.push_back(request{id, filename});
+                _pending++;
+            }
+            if (!_thread.joinable())
+                _thread = std::thread([this] { decode_loop(); });
+            _wake.notify_one();
+            return id;
+        }
+
+        /**
+         * @brief Pack the images decoded since the last call, the canvas calls it when it draws images
+         *
+         * @return true if an image became ready or failed, e.g. to invalidate a redraw_target
+         */
+        bool update()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_decoded.empty())
+                    return false;
+                _ready.swap(_decoded);
+                _pending -= _ready.size();
+            }
+            for (decoded &d : _ready)
+            {
+                if (d.pixels)
+                    pack(d.id, d.pixels, d.w, d.h);
+                else
+                    _entries[d.id].state = image_state::failed;
+                stbi_image_free(d.pixels);
+            }
+            _ready.clear();
+            return true;
+        }
+
+        /**
+         * @brief Check if images passed to load() are still being decoded
+         */
+        bool loading() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _pending > 0;
+        }
+
+        image_state state(uint32_t id) const
+        {
+            return id > 0 && id < _entries.size() ? _entries[id].state : image_state::failed;
+        }
+
+        /**
+         * @brief Get the size of an image, 0 x 0 while it is loading or if it failed
+         */
+        void size(uint32_t id, int &w, int &h) const
+        {
+            bool ready = state(id) == image_state::ready;
+            w = ready ? _entries[id].w : 0;
+            h = ready ? _entries[id].h : 0;
+        }
+
+        /**
+         * @brief Upload the pages changed since the last upload, each page is updated once per frame at most
+         */
+        void upload()
+        {
+            uint32_t frame = sg_query_frame_stats().frame_index + 1;
+            for (page &p : _pages)
+            {
+                if (gpu::needs_setup(p.image))
+                {
+                    p.image = make_page_image(p.size);
+                    p.dirty = true;
+                }
+                if (!p.dirty || sg_query_image_info(p.image).upd_frame_index == frame)
+                    continue;
+
+                sg_image_data data = {};
+                data.subimage[0][0] = sg_range{p.pixels.data(), p.pixels.size()};
+                sg_update_image(p.image, &data);
+                p.dirty = false;
+            }
+        }
+
+        /**
+         * @brief Find where a region of an image is drawn from
+         *
+         * @param id The image
+         * @param src The region in image pixels
+         * @param page_image Set to the texture of the page
+         * @param out Set to the region in page pixels, the whole placeholder while the image is loading
+         * @return false if there is nothing to draw
+         */
+        bool locate(uint32_t id, const sgp_rect &src, sg_image &page_image, sgp_rect &out)
+        {
+            image_state s = state(id);
+            if (s == image_state::failed)
+                return false;
+
+            const entry &e = _entries[s == image_state::ready ? id : 0];
+            if (e.page < 0)
+                return false;
+            page_image = _pages[e.page].image;
+            if (s == image_state::ready)
+                out = sgp_rect{e.x + src.x, e.y + src.y, src.w, src.h};
+            else
+                out = sgp_rect{(float)e.x, (float)e.y, (float)e.w, (float)e.h};
+            return true;
+        }
+
+        /**
+         * @brief Get the sampler of the pages, linear and clamped to their edges
+         */
+        sg_sampler sampler()
+        {
+            if (sg_query_sampler_state(_sampler) != SG_RESOURCESTATE_VALID)
+            {
+                sg_sampler_desc smp = {};
+                smp.min_filter = SG_FILTER_LINEAR;
+                smp.mag_filter = SG_FILTER_LINEAR;
+                smp.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+                smp.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+                _sampler = sg_make_sampler(&smp);
+            }
+            return _sampler;
+        }
+
+        size_t page_count() const
+        {
+            return _pages.size();
+        }
+
+    protected:
+        class entry
+        {
+        public:
+            image_state state = image_state::loading;
+            int page = -1;
+            int x = 0; // Top left pixel in the page, without the padding
+            int y = 0;
+            int w = 0;
+            int h = 0;
+        };
+
+        class shelf
+        {
+        public:
+            int y = 0;
+            int height = 0;
+            int used = 0; // Width taken by the images
+        };
+
+        class page
+        {
+        public:
+            int size = 0;
+            std::vector<uint8_t> pixels;
+            std::vector<shelf> shelves;
+            int used_height = 0;
+            sg_image image{SG_INVALID_ID};
+            bool dirty = true;
+
+            /**
+             * @brief Find room for a box, preferring the shelves not much taller than it
+             */
+            bool allocate(int w, int h, int &x, int &y)
+            {
+                for (int pass = 0; pass < 2; pass++)
+                {
+                    for (shelf &s : shelves)
+                    {
+                        if (h <= s.height && (pass == 1 || h * 2 >= s.height) && s.used + w <= size)
+                        {
+                            x = s.used;
+                            y = s.y;
+                            s.used += w;
+                            return true;
+                        }
+                    }
+                    if (pass == 0 && used_height + h <= size && w <= size)
+                    {
+                        shelves.push_back(shelf{used_height, h, w});
+                        x = 0;
+                        y = used_height;
+                        used_height += h;
+                        return true;
+                    }
+                }
+                return false;
+            }
+        };
+
+        class request
+        {
+        public:
+            uint32_t id;
+            std::string filename;
+        };
+
+        class decoded
+        {
+        public:
+            uint32_t id;
+            uint8_t *pixels; // Owned, null if the decode failed
+            int w;
+            int h;
+        };
+
+        uint32_t new_entry()
+        {
+            if (_entries.empty())
+            {
+                // Entry 0 is the placeholder
+                _entries.emplace_back();
+                uint8_t c[4] = {(uint8_t)(placeholder_color >> 16), (uint8_t)(placeholder_color >> 8),
+                                (uint8_t)placeholder_color, (uint8_t)(placeholder_color >> 24)};
+                uint8_t pixels[4 * 4 * 4];
+                for (size_t i = 0; i < sizeof(pixels); i++)
+                    pixels[i] = c[i % 4];
+                pack(0, pixels, 4, 4);
+            }
+            _entries.emplace_back();
+            return (uint32_t)_entries.size() - 1;
+        }
+
+        static sg_image make_page_image(int size)
+        {
+            sg_image_desc desc = {};
+            desc.width = size;
+            desc.height = size;
+            desc.usage = SG_USAGE_DYNAMIC;
+            desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+            return sg_make_image(&desc);
+        }
+
+        void pack(uint32_t id, const uint8_t *rgba, int w, int h)
+        {
+            entry &e = _entries[id];
+            int pw = w + 2 * padding;
+            int ph = h + 2 * padding;
+            if (w <= 0 || h <= 0)
+            {
+                e.state = image_state::failed;
+                return;
+            }
+
+            int x = 0;
+            int y = 0;
+            size_t index = 0;
+            while (index < _pages.size() && !_pages[index].allocate(pw, ph, x, y))
+                index++;
+            if (index == _pages.size())
+            {
+                _pages.emplace_back();
+                page &p = _pages.back();
+                p.size = std::max(_page_size, std::max(pw, ph));
+                p.pixels.assign((size_t)p.size * p.size * 4, 0);
+                p.image = make_page_image(p.size);
+                p.allocate(pw, ph, x, y);
+            }
+
+            // Copy the rows, repeating the edge pixels into the padding
+            page &p = _pages[index];
+            for (int row = -padding; row < h + padding; row++)
+            {
+                const uint8_t *src = rgba + (size_t)std::clamp(row, 0, h - 1) * w * 4;
+                uint8_t *dst = p.pixels.data() + ((size_t)(y + padding + row) * p.size + x) * 4;
+                for (int i = 0; i < padding; i++)
+                {
+                    std::copy(src, src + 4, dst + i * 4);
+                    std::copy(src + (w - 1) * 4, src + w * 4, dst + (padding + w + i) * 4);
+                }
+                std::copy(src, src + (size_t)w * 4, dst + padding * 4);
+            }
+            p.dirty = true;
+
+            e.state = image_state::ready;
+            e.page = (int)index;
+            e.x = x + padding;
+            e.y = y + padding;
+            e.w = w;
+            e.h = h;
+        }
+
+        void decode_loop()
+        {
+            for (;;)
+            {
+                request r;
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _wake.wait(lock, [this] { return _stop || !_requests.empty(); });
+                    if (_stop)
+                        return;
+                    r = std::move(_requests.front());
+                    _requests.pop_front();
+                }
+
+                int w = 0;
+                int h = 0;
+                int channels = 0;
+                uint8_t *pixels = stbi_load(r.filename.c_str(), &w, &h, &channels, 4);
+                std::lock_guard<std::mutex> lock(_mutex);
+                _decoded.push_back(decoded{r.id, pixels, w, h});
+            }
+        }
+
+    protected:
+        int _page_size;
+        std::vector<entry> _entries;
+        std::vector<page> _pages;
+        sg_sampler _sampler{SG_INVALID_ID};
+
+        // Background decoding, the containers are guarded by _mutex
+        std::thread _thread;
+        mutable std::mutex _mutex;
+        std::condition_variable _wake;
+        std::deque<request> _requests;
+        std::vector<decoded> _decoded;
+        std::vector<decoded> _ready; // Scratch used by update()
+        size_t _pending = 0;         // Requests not packed yet
+        bool _stop = false;
+    };
+
+    /**
+     * @brief Monospaced bitmap font, one bit per pixel
+     *
+     * Every glyph is a cell of width x height pixels whose rows are one byte each, the leftmost
+     * pixel in the most significant bit, so width is at most 8. The glyphs cover the code points
+     * first to first + count - 1, other code points are drawn as '?'.
+     */
+    class bitmap_font
+    {
+    public:
+        int width;       // Cell width in pixels, without the spacing between glyphs
+        int height;      // Cell height in pixels, the font size
+        int ascent;      // Rows above the baseline, the others are below it
+        uint32_t first;  // First code point
+        uint32_t count;  // Number of glyphs
+        const uint8_t *rows; // height bytes per glyph
+
+        /**
+         * @brief Get the embedded 5 x 8 font of the printable ASCII characters
+         */
+        static const bitmap_font &get_default()
+        {
+            static constexpr uint8_t glyphs[95 * 8] = {
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x20, 0x00, //   !
+            0x50, 0x50, 0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x50, 0x50, 0xf8, 0x50, 0xf8, 0x50, 0x50, 0x00, // " #
+            0x20, 0x78, 0xa0, 0x70, 0x28, 0xf0, 0x20, 0x00, 0xc0, 0xc8, 0x10, 0x20, 0x40, 0x98, 0x18, 0x00, // $ %
+            0x60, 0x90, 0xa0, 0x40, 0xa8, 0x90, 0x68, 0x00, 0x20, 0x20, 0x20, 0x00, 0x00, 0x00, 0x00, 0x00, // & '
+            0x10, 0x20, 0x40, 0x40, 0x40, 0x20, 0x10, 0x00, 0x40, 0x20, 0x10, 0x10, 0x10, 0x20, 0x40, 0x00, // ( )
+            0x00, 0x20, 0xa8, 0x70, 0xa8, 0x20, 0x00, 0x00, 0x00, 0x20, 0x20, 0xf8, 0x20, 0x20, 0x00, 0x00, // * +
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x20, 0x20, 0x40, 0x00, 0x00, 0x00, 0xf8, 0x00, 0x00, 0x00, 0x00, // , -
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x60, 0x60, 0x00, 0x00, 0x08, 0x10, 0x20, 0x40, 0x80, 0x00, 0x00, // . /
+            0x70, 0x88, 0x98, 0xa8, 0xc8, 0x88, 0x70, 0x00, 0x20, 0x60, 0x20, 0x20, 0x20, 0x20, 0x70, 0x00, // 0 1
+            0x70, 0x88, 0x08, 0x10, 0x20, 0x40, 0xf8, 0x00, 0xf8, 0x10, 0x20, 0x10, 0x08, 0x88, 0x70, 0x00, // 2 3
+            0x10, 0x30, 0x50, 0x90, 0xf8, 0x10, 0x10, 0x00, 0xf8, 0x80, 0xf0, 0x08, 0x08, 0x88, 0x70, 0x00, // 4 5
+            0x30, 0x40, 0x80, 0xf0, 0x88, 0x88, 0x70, 0x00, 0xf8, 0x08, 0x10, 0x20, 0x40, 0x40, 0x40, 0x00, // 6 7
+            0x70, 0x88, 0x88, 0x70, 0x88, 0x88, 0x70, 0x00, 0x70, 0x88, 0x88, 0x78, 0x08, 0x10, 0x60, 0x00, // 8 9
+            0x00, 0x60, 0x60, 0x00, 0x60, 0x60, 0x00, 0x00, 0x00, 0x60, 0x60, 0x00, 0x60, 0x20, 0x40, 0x00, // : ;
+            0x10, 0x20, 0x40, 0x80, 0x40, 0x20, 0x10, 0x00, 0x00, 0x00, 0xf8, 0x00, 0xf8, 0x00, 0x00, 0x00, // < =
+            0x40, 0x20, 0x10, 0x08, 0x10, 0x20, 0x40, 0x00, 0x70, 0x88, 0x08, 0x10, 0x20, 0x00, 0x20, 0x00, // > ?
+            0x70, 0x88, 0x08, 0x68, 0xa8, 0xa8, 0x70, 0x00, 0x70, 0x88, 0x88, 0x88, 0xf8, 0x88, 0x88, 0x00, // @ A
+            0xf0, 0x88, 0x88, 0xf0, 0x88, 0x88, 0xf0, 0x00, 0x70, 0x88, 0x80, 0x80, 0x80, 0x88, 0x70, 0x00, // B C
+            0xe0, 0x90, 0x88, 0x88, 0x88, 0x90, 0xe0, 0x00, 0xf8, 0x80, 0x80, 0xf0, 0x80, 0x80, 0xf8, 0x00, // D E
+            0xf8, 0x80, 0x80, 0xf0, 0x80, 0x80, 0x80, 0x00, 0x70, 0x88, 0x80, 0xb8, 0x88, 0x88, 0x78, 0x00, // F G
+            0x88, 0x88, 0x88, 0xf8, 0x88, 0x88, 0x88, 0x00, 0x70, 0x20, 0x20, 0x20, 0x20, 0x20, 0x70, 0x00, // H I
+            0x38, 0x10, 0x10, 0x10, 0x10, 0x90, 0x60, 0x00, 0x88, 0x90, 0xa0, 0xc0, 0xa0, 0x90, 0x88, 0x00, // J K
+            0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0xf8, 0x00, 0x88, 0xd8, 0xa8, 0xa8, 0x88, 0x88, 0x88, 0x00, // L M
+            0x88, 0x88, 0xc8, 0xa8, 0x98, 0x88, 0x88, 0x00, 0x70, 0x88, 0x88, 0x88, 0x88, 0x88, 0x70, 0x00, // N O
+            0xf0, 0x88, 0x88, 0xf0, 0x80, 0x80, 0x80, 0x00, 0x70, 0x88, 0x88, 0x88, 0xa8, 0x90, 0x68, 0x00, // P Q
+            0xf0, 0x88, 0x88, 0xf0, 0xa0, 0x90, 0x88, 0x00, 0x78, 0x80, 0x80, 0x70, 0x08, 0x08, 0xf0, 0x00, // R S
+            0xf8, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x88, 0x88, 0x88, 0x88, 0x88, 0x88, 0x70, 0x00, // T U
+            0x88, 0x88, 0x88, 0x88, 0x88, 0x50, 0x20, 0x00, 0x88, 0x88, 0x88, 0xa8, 0xa8, 0xa8, 0x50, 0x00, // V W
+            0x88, 0x88, 0x50, 0x20, 0x50, 0x88, 0x88, 0x00, 0x88, 0x88, 0x88, 0x50, 0x20, 0x20, 0x20, 0x00, // X Y
+            0xf8, 0x08, 0x10, 0x20, 0x40, 0x80, 0xf8, 0x00, 0x70, 0x40, 0x40, 0x40, 0x40, 0x40, 0x70, 0x00, // Z [
+            0x00, 0x80, 0x40, 0x20, 0x10, 0x08, 0x00, 0x00, 0x70, 0x10, 0x10, 0x10, 0x10, 0x10, 0x70, 0x00, // \ ]
+            0x20, 0x50, 0x88, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xf8, // ^ _
+            0x40, 0x20, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x70, 0x08, 0x78, 0x88, 0x78, 0x00, // ` a
+            0x80, 0x80, 0xb0, 0xc8, 0x88, 0x88, 0xf0, 0x00, 0x00, 0x00, 0x70, 0x80, 0x80, 0x88, 0x70, 0x00, // b c
+            0x08, 0x08, 0x68, 0x98, 0x88, 0x88, 0x78, 0x00, 0x00, 0x00, 0x70, 0x88, 0xf8, 0x80, 0x70, 0x00, // d e
+            0x30, 0x48, 0x40, 0xe0, 0x40, 0x40, 0x40, 0x00, 0x00, 0x78, 0x88, 0x88, 0x78, 0x08, 0x88, 0x70, // f g
+            0x80, 0x80, 0xb0, 0xc8, 0x88, 0x88, 0x88, 0x00, 0x20, 0x00, 0x60, 0x20, 0x20, 0x20, 0x70, 0x00, // h i
+            0x10, 0x00, 0x30, 0x10, 0x10, 0x10, 0x90, 0x60, 0x80, 0x80, 0x90, 0xa0, 0xc0, 0xa0, 0x90, 0x00, // j k
+            0x60, 0x20, 0x20, 0x20, 0x20, 0x20, 0x70, 0x00, 0x00, 0x00, 0xd0, 0xa8, 0xa8, 0x88, 0x88, 0x00, // l m
+            0x00, 0x00, 0xb0, 0xc8, 0x88, 0x88, 0x88, 0x00, 0x00, 0x00, 0x70, 0x88, 0x88, 0x88, 0x70, 0x00, // n o
+            0x00, 0x00, 0xf0, 0x88, 0x88, 0xf0, 0x80, 0x80, 0x00, 0x00, 0x78, 0x88, 0x88, 0x78, 0x08, 0x08, // p q
+            0x00, 0x00, 0xb0, 0xc8, 0x80, 0x80, 0x80, 0x00, 0x00, 0x00, 0x78, 0x80, 0x70, 0x08, 0xf0, 0x00, // r s
+            0x40, 0x40, 0xe0, 0x40, 0x40, 0x48, 0x30, 0x00, 0x00, 0x00, 0x88, 0x88, 0x88, 0x98, 0x68, 0x00, // t u
+            0x00, 0x00, 0x88, 0x88, 0x88, 0x50, 0x20, 0x00, 0x00, 0x00, 0x88, 0x88, 0xa8, 0xa8, 0x50, 0x00, // v w
+            0x00, 0x00, 0x88, 0x50, 0x20, 0x50, 0x88, 0x00, 0x00, 0x00, 0x88, 0x88, 0x88, 0x78, 0x08, 0x70, // x y
+            0x00, 0x00, 0xf8, 0x10, 0x20, 0x40, 0xf8, 0x00, 0x10, 0x20, 0x20, 0x40, 0x20, 0x20, 0x10, 0x00, // z {
+            0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x20, 0x00, 0x40, 0x20, 0x20, 0x10, 0x20, 0x20, 0x40, 0x00, // | }
+            0x00, 0x00, 0x40, 0xa8, 0x10, 0x00, 0x00, 0x00, // ~
+            };
+            static const bitmap_font font{5, 8, 7, 32, 95, glyphs};
+            return font;
+        }
+
+        /**
+         * @brief Get the index of the glyph drawn for a code point
+         */
+        uint32_t index(uint32_t codepoint) const
+        {
+            if (codepoint >= first && codepoint - first < count)
+                return codepoint - first;
+            return '?' >= first && '?' - first < count ? '?' - first : 0;
+        }
+
+        bool pixel(uint32_t glyph, int x, int y) const
+        {
+            return (rows[glyph * height + y] >> (7 - x)) & 1;
+        }
+    };
+
+    enum class text_align
+    {
+        left,   // The point is at the start of the text
+        center, // The point is at the middle of the text
+        right   // The point is at the end of the text
+    };
+
+    enum class text_baseline
+    {
+        alphabetic, // The point is on the baseline
+        top,        // The point is at the top of the em square
+        middle,     // The point is at the middle of the em square
+        bottom      // The point is at the bottom of the em square
+    };
+
+    class text_style_s
+    {
+    public:
+        const bitmap_font *font = nullptr; // bitmap_font::get_default() when null
+        float size = 16.0f;                // Height of the em square, in path units
+        text_align align = text_align::left;
+        text_baseline baseline = text_baseline::alphabetic;
+    };
+
+    /**
+     * @brief Size of a text, like TextMetrics of the HTML5 canvas, in path units
+     */
+    class text_metrics
+    {
+    public:
+        float width = 0.0f;   // Advance of the whole text
+        float ascent = 0.0f;  // From the baseline to the top of the em square
+        float descent = 0.0f; // From the baseline to the bottom of the em square
+    };
+
+    /**
+     * @brief Glyphs rasterized into image_atlas::get_default(), and the layout of the texts drawn with them
+     *
+     * A face is a font rasterized at a size in whole pixels: its glyphs are rasterized the first
+     * time they are used, with 4 x 4 samples per pixel and a transparent border so they can be
+     * filtered, and packed into the atlas as white pixels whose alpha is the coverage. The
+     * layout of each text, the glyphs and their position, is cached per face, so labels
+     * drawn on every frame are decoded and measured once. A face keeps at most max_layouts
+     * texts, more clear its cache. Nothing is removed from the atlas.
+     */
+    class glyph_cache
+    {
+    public:
+        /**
+         * @brief A glyph placed in a text layout, in face pixels
+         */
+        class placed_glyph
+        {
+        public:
+            uint32_t image; // Atlas image, its border included
+            float x;        // Left of the image, from the start of the text
+            float w;
+            float h;
+        };
+
+        class text_layout
+        {
+        public:
+            float width = 0.0f; // Sum of the advances, in face pixels
+            std::vector<placed_glyph> glyphs; // Without the blank glyphs
+        };
+
+        static constexpr int max_size = 256;        // Larger faces are rasterized at this size and scaled
+        static constexpr size_t max_layouts = 16384; // Layouts kept per face
+
+        /**
+         * @brief Get the glyph cache of the calling thread
+         */
+        static glyph_cache &get_default()
+        {
+            thread_local glyph_cache cache;
+            return cache;
+        }
+
+        /**
+         * @brief Get the layout of a text, decoded from UTF-8
+         *
+         * @param size The face size in pixels, clamped to [1, max_size]
+         * @return The layout, valid until the next call
+         */
+        const text_layout &layout(const bitmap_font &font, int size, std::string_view text)
+        {
+            face &f = get_face(font, size);
+            _key.assign(text.data(), text.size());
+            auto it = f.layouts.find(_key);
+            if (it != f.layouts.end())
+                return it->second;
+
+            if (f.layouts.size() >= max_layouts)
+                f.layouts.clear();
+            text_layout &l = f.layouts[_key];
+            float scale = (float)f.size / font.height;
+            float advance = (font.width + 1) * scale;
+            for (size_t i = 0; i < text.size();)
+            {
+                const glyph &g = get_glyph(f, font.index(next_codepoint(text, i)));
+                if (g.image != 0)
+                    l.glyphs.push_back(placed_glyph{g.image, std::round(l.width) - 1.0f, (float)g.w, (float)g.h});
+                l.width += advance;
+            }
+            return l;
+        }
+
+        /**
+         * @brief Decode the UTF-8 code point at i and move i after it, invalid bytes decode as U+FFFD
+         */
+        static uint32_t next_codepoint(std::string_view s, size_t &i)
+        {
+            uint8_t c = s[i++];
+            if (c < 0x80)
+                return c;
+            int extra = c >= 0xf0 ? 3 : c >= 0xe0 ? 2 : c >= 0xc0 ? 1 : -1;
+            if (extra < 0 || c >= 0xf8)
+                return 0xfffd;
+            uint32_t codepoint = c & (0x3f >> extra);
+            for (int k = 0; k < extra; k++)
+            {
+                if (i >= s.size() || (s[i] & 0xc0) != 0x80)
+                    return 0xfffd;
+                codepoint = (codepoint << 6) | (s[i++] & 0x3f);
+            }
+            return codepoint;
+        }
+
+    protected:
+        class glyph
+        {
+        public:
+            bool rasterized = false;
+            uint32_t image = 0; // 0 for a blank glyph
+            int w = 0;
+            int h = 0;
+        };
+
+        class face
+        {
+        public:
+            const bitmap_font *font;
+            int size;
+            std::vector<glyph> glyphs; // By glyph index
+            std::unordered_map<std::string, text_layout> layouts;
+        };
+
+        face &get_face(const bitmap_font &font, int size)
+        {
+            size = std::clamp(size, 1, max_size);
+            for (face &f : _faces)
+                if (f.font == &font && f.size == size)
+                    return f;
+            _faces.push_back(face{&font, size, std::vector<glyph>(font.count), {}});
+            return _faces.back();
+        }
+
+        const glyph &get_glyph(face &f, uint32_t index)
+        {
+            glyph &g = f.glyphs[index];
+            if (g.rasterized)
+                return g;
+            g.rasterized = true;
+
+            // Coverage of 4 x 4 samples per pixel, inside a border of 1 transparent pixel
+            const bitmap_font &font = *f.font;
+            float scale = (float)f.size / font.height;
+            int w = (int)std::ceil(font.width * scale) + 2;
+            int h = f.size + 2;
+            _pixels.assign((size_t)w * h * 4, 255);
+            bool blank = true;
+            for (int y = 0; y < h; y++)
+            {
+                for (int x = 0; x < w; x++)
+                {
+                    int covered = 0;
+                    for (int s = 0; s < 16; s++)
+                    {
+                        int fx = (int)std::floor((x - 1 + ((s & 3) + 0.5f) * 0.25f) / scale);
+                        int fy = (int)std::floor((y - 1 + ((s >> 2) + 0.5f) * 0.25f) / scale);
+                        covered += fx >= 0 && fx < font.width && fy >= 0 && fy < font.height && font.pixel(index, fx, fy);
+                    }
+                    _pixels[((size_t)y * w + x) * 4 + 3] = (uint8_t)((covered * 255 + 8) / 16);
+                    blank = blank && covered == 0;
+                }
+            }
+            if (!blank)
+            {
+                g.image = image_atlas::get_default().add(_pixels.data(), w, h);
+                g.w = w;
+                g.h = h;
+            }
+            return g;
+        }
+
+    protected:
+        std::deque<face> _faces; // Stable addresses, there are a few of them
+        std::string _key;        // Scratch key of layout()
+        std::vector<uint8_t> _pixels;
+    };
+
+    /**
+     * @brief Fixed set of threads running parallel loops, with work stealing
+     *
+     * run() splits the indices into one contiguous range per worker. Each worker takes indices
+     * from the front of its own range and, once it is empty, steals the back half of the range of
+     * another worker, so uneven tasks still keep every core busy. A range is packed with its
+     * begin and end into one 64 bit atomic, popping and stealing are a single compare exchange.
+     */
+    class job_pool
+    {
+    public:
+        /**
+         * @param size The number of workers, the thread calling run() included
+         */
+        explicit job_pool(unsigned size = default_size()) : _size(std::max(size, 1u)),
+                                                             _ranges(new std::atomic<uint64_t>[_size])
+        {
+            for (unsigned w = 1; w < _size; w++)
+                _threads.emplace_back([this, w]()
+                                      { worker_loop(w); });
+        }
+
+        ~job_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _stop = true;
+            }
+            _wake.notify_all();
+            for (std::thread &t : _threads)
+                t.join();
+        }
+
+        job_pool(const job_pool &) = delete;
+        job_pool &operator=(const job_pool &) = delete;
+
+        /**
+         * @brief Get the pool shared by the whole process, created on first use with one worker per core
+         */
+        static job_pool &get_default()
+        {
+            static job_pool pool;
+            return pool;
+        }
+
+        static unsigned default_size()
+        {
+            return std::max(std::thread::hardware_concurrency(), 1u);
+        }
+
+        unsigned size() const
+        {
+            return _size;
+        }
+
+        /**
+         * @brief Call f(index, worker) for every index in [0, count) and wait for all the calls
+         *
+         * The calling thread is worker 0, the other workers are numbered from 1 to size() - 1, so
+         * f can keep per worker scratch data. Calls from different threads are serialized.
+         */
+        template <typename F>
+        void run(size_t count, F &&f)
+        {
+            using function_t = std::remove_reference_t<F>;
+            if (_size == 1 || count <= 1)
+            {
+                for (size_t i = 0; i < count; i++)
+                    f(i, 0u);
+                return;
+            }
+
+            std::lock_guard<std::mutex> run_lock(_run_mutex);
+            for (unsigned w = 0; w < _size; w++)
+                _ranges[w].store(pack(count * w / _size, count * (w + 1) / _size), std::memory_order_relaxed);
+            _active.store(_size - 1, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _task = [](void *context, size_t index, unsigned worker)
+                { (*static_cast<function_t *>(context))(index, worker); };
+                _context = const_cast<void *>(static_cast<const void *>(&f));
+                _generation++;
+            }
+            _wake.notify_all();
+
+            work(0);
+
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done.wait(lock, [this]()
+                       { return _active.load(std::memory_order_acquire) == 0; });
+        }
+
+    protected:
+        static uint64_t pack(uint64_t begin, uint64_t end)
+        {
+            return (begin << 32) | end;
+        }
+
+        void worker_loop(unsigned worker)
+        {
+            uint64_t seen = 0;
+            for (;;)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(_mutex);
+                    _wake.wait(lock, [&]()
+                               { return _stop || _generation != seen; });
+                    if (_stop)
+                        return;
+                    seen = _generation;
+                }
+
+                work(worker);
+
+                if (_active.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    _done.notify_one();
+                }
+            }
+        }
+
+        void work(unsigned worker)
+        {
+            size_t index;
+            while (pop(worker, index) || steal(worker, index))
+                _task(_context, index, worker);
+        }
+
+        bool pop(unsigned worker, size_t &index)
+        {
+            std::atomic<uint64_t> &range = _ranges[worker];
+            uint64_t r = range.load(std::memory_order_acquire);
+            for (;;)
+            {
+                uint64_t begin = r >> 32;
+                uint64_t end = r & 0xffffffffu;
+                if (begin >= end)
+                    return false;
+                if (range.compare_exchange_weak(r, pack(begin + 1, end), std::memory_order_acq_rel, std::memory_order_acquire))
+                {
+                    index = begin;
+                    return true;
+                }
+            }
+        }
+
+        // Take the back half of another worker range, the first index is run now and the rest
+        // becomes the range of the thief. Only called when the thief range is empty.
+        bool steal(unsigned worker, size_t &index)
+        {
+            for (unsigned k = 1; k < _size; k++)
+            {
+                std::atomic<uint64_t> &range = _ranges[(worker + k) % _size];
+                uint64_t r = range.load(std::memory_order_acquire);
+                for (;;)
+                {
+                    uint64_t begin = r >> 32;
+                    uint64_t end = r & 0xffffffffu;
+                    if (begin >= end)
+                        break;
+                    uint64_t middle = begin + (end - begin) / 2;
+                    if (range.compare_exchange_weak(r, pack(begin, middle), std::memory_order_acq_rel, std::memory_order_acquire))
+                    {
+                        _ranges[worker].store(pack(middle + 1, end), std::memory_order_release);
+                        index = middle;
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+    protected:
+        unsigned _size;
+        std::unique_ptr<std::atomic<uint64_t>[]> _ranges; // Remaining indices of each worker
+        std::vector<std::thread> _threads;
+        std::mutex _run_mutex;
+        std::mutex _mutex;
+        std::condition_variable _wake;
+        std::condition_variable _done;
+        std::atomic<unsigned> _active{0};
+        void (*_task)(void *, size_t, unsigned) = nullptr;
+        void *_context = nullptr;
+        uint64_t _generation = 0;
+        bool _stop = false;
+    };
+
+    /**
+     * @brief A stroke or fill recorded by the canvas, tessellated when the canvas submits its draws
+     *
+     * The sokol_gp state used by the draw is captured when it is recorded.
+     */
+    class draw_job
+    {
+    public:
+        enum class kind
+        {
+            stroke,
+            fill
+        };
+
+        kind type = kind::fill;
+        size_t path_index = 0;   // Recorded path in frame_arena::job_paths
+        size_t first_chunk = 0;  // First chunk in frame_arena::chunks
+        size_t chunk_count = 0;
+        stroke_style_s stroke_style; // Only the color and the gradient are used by fills
+        float tolerance = default_tessellation_tolerance;
+        sgp_mat2x3 transform;
+        sgp_blend_mode blend_mode = SGP_BLENDMODE_NONE;
+        aabb cull;           // Elements outside of it, in path units, are not tessellated
+        bool culling = false; // False when the transform cannot be inverted
+    };
+
+    /**
+     * @brief A range of a recorded path tessellated by one task, results are kept between frames
+     */
+    class tessellation_chunk
+    {
+    public:
+        size_t job = 0;
+        path_range range;
+        geometry output;
+        size_t culled = 0; // Elements of the range not visible
+        aabb bounds;       // Bounds of the output, in path units
+    };
+
+    /**
+     * @brief The triangles or the lines of a tessellated draw_job, reordered by canvas::submit()
+     */
+    class draw_item
+    {
+    public:
+        size_t job = 0;
+        bool lines = false;
+        aabb box;                // Device pixels the item may touch
+        size_t batch = 0;        // Index of its draw_batch
+        size_t next = npos;      // Next item of the same draw_batch
+        static constexpr size_t npos = std::numeric_limits<size_t>::max();
+    };
+
+    /**
+     * @brief Consecutive draw items sharing the same sokol_gp pipeline, merged into one draw command
+     */
+    class draw_batch
+    {
+    public:
+        unsigned key = 0; // Primitive, blend mode and gradient shader, see canvas::batch_key()
+        size_t first = draw_item::npos;
+        size_t last = draw_item::npos;
+    };
+
+    /**
+     * @brief Scratch data of one job_pool worker
+     */
+    class tessellation_worker
+    {
+    public:
+        tessellator scratch;
+        sub_path sub;
+    };
+
+    /**
+     * @brief Canvas state saved by canvas::save()
+     */
+    class canvas_state
+    {
+    public:
+        sgp_mat2x3 transform;
+        fill_style_s fill_style;
+        stroke_style_s stroke_style;
+        text_style_s text_style;
+        sgp_irect scissor; // Pixels the draws were clipped to
+        aabb cull;         // Pixels drawn, in device units
+        size_t clip_paths; // Number of paths clipping the draws through the stencil
+    };
+
+    /**
+     * @brief A path clipping the draws through clip_mask, kept to rebuild the mask on canvas::restore()
+     */
+    class clip_path
+    {
+    public:
+        size_t first;         // First fan in frame_arena::clip_fans
+        size_t count;         // Number of fans
+        sgp_mat2x3 transform; // Transform of the fans
+        fill_rule rule;
+    };
+
+    /**
+     * @brief Draws recorded without any sokol call, replayed later by canvas::draw()
+     *
+     * Paths are tessellated when they are filled or stroked, into vertices carrying their
+     * colors, so a list can be recorded on any thread while the render thread draws another
+     * one: replaying it only copies the vertices into sokol_gp. The recording state mirrors the
+     * canvas one, with its own transform and blend mode. Like static_geometry, gradients are
+     * evaluated at the vertices. reset() keeps the memory, a list reused for every frame stops
+     * allocating once it has held the heaviest one.
+     */
+    class display_list
+    {
+    public:
+        /**
+         * @brief A run of vertices, or a clear, drawn with the same transform and blend mode
+         */
+        class command
+        {
+        public:
+            enum class kind : uint8_t
+            {
+                clear,
+                triangles,
+                lines
+            };
+
+            kind type;
+            sgp_blend_mode blend_mode;
+            sgp_mat2x3 transform;
+            uint32_t first;   // First vertex
+            uint32_t count;   // Number of vertices, 0 for a clear
+            rgba_color color; // Color of a clear
+            aabb bounds;      // Bounding box of the vertices, in path units
+        };
+
+        /**
+         * @brief Remove the recorded draws, the memory is kept
+         */
+        void reset()
+        {
+            _vertices.clear();
+            _commands.clear();
+            fill_style = fill_style_s();
+            stroke_style = stroke_style_s();
+            transform = mat2x3_identity();
+            blend_mode = SGP_BLENDMODE_NONE;
+        }
+
+        /**
+         * @brief Record a clear of the whole target with the fill color
+         */
+        void clear()
+        {
+            _commands.push_back(command{command::kind::clear, blend_mode, transform, (uint32_t)_vertices.size(), 0, fill_style.color, aabb()});
+        }
+
+        void fill(const path &p)
+        {
+            _scratch.clear();
+            p.tessellate_fill(_scratch, scratch());
+            add(_scratch, fill_style.color, fill_style.gradient);
+        }
+
+        /**
+         * @brief Stroke a path with the stroke style, dashes are cut on the CPU
+         */
+        void stroke(const path &p)
+        {
+            _scratch.clear();
+            p.tessellate_stroke(stroke_style, _scratch, scratch());
+            add(_scratch, stroke_style.color, stroke_style.gradient);
+        }
+
+        /**
+         * @brief Record filled rectangles, each with its own color, as 2 triangles each
+         */
+        void draw_rects(const rect_instance *rects, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                const sgp_rect &r = rects[i].rect;
+                sgp_point a = {r.x, r.y}, b = {r.x + r.w, r.y}, c = {r.x + r.w, r.y + r.h}, d = {r.x, r.y + r.h};
+                const sgp_point quad[6] = {a, b, c, a, c, d};
+                append(command::kind::triangles, quad, 6, rects[i].color, nullptr);
+            }
+        }
+
+        void draw_rects(const std::vector<rect_instance> &rects)
+        {
+            draw_rects(rects.data(), rects.size());
+        }
+
+        /**
+         * @brief Record the triangles then the lines of a geometry
+         */
+        void add(const geometry &g, const rgba_color &color, const gradient *paint = nullptr)
+        {
+            if (!g.triangles.empty())
+                append(command::kind::triangles, &g.triangles[0].a, g.triangles.size() * 3, color, paint);
+            if (!g.lines.empty())
+                append(command::kind::lines, &g.lines[0].a, g.lines.size() * 2, color, paint);
+        }
+
+        bool empty() const
+        {
+            return _commands.empty();
+        }
+
+        size_t vertex_count() const
+        {
+            return _vertices.size();
+        }
+
+        const std::vector<command> &commands() const
+        {
+            return _commands;
+        }
+
+        const std::vector<sgp_vertex> &vertices() const
+        {
+            return _vertices;
+        }
+
+    public:
+        fill_style_s fill_style;
+        stroke_style_s stroke_style;
+        sgp_mat2x3 transform = mat2x3_identity();      // Applied to the draws recorded next
+        sgp_blend_mode blend_mode = SGP_BLENDMODE_NONE; // Blend mode of the draws recorded next
+
+        // Maximum distance in device pixels between a curve and its segments, the list is
+        // assumed to be drawn without scaling
+        float tessellation_tolerance = default_tessellation_tolerance;
+
+    protected:
+        /**
+         * @brief Get the tessellator of the list with the tolerance converted to path units
+         */
+        tessellator &scratch()
+        {
+            float scale = mat2x3_max_scale(transform);
+            _tessellator.tolerance = scale > 0.0f ? tessellation_tolerance / scale : tessellation_tolerance;
+            return _tessellator;
+        }
+
+        void append(command::kind type, const sgp_point *points, size_t count, const rgba_color &color, const gradient *paint)
+        {
+            if (count == 0)
+                return;
+
+            // Consecutive draws with the same primitive and state are replayed at once
+            if (_commands.empty() || _commands.back().type != type || _commands.back().blend_mode != blend_mode ||
+                std::memcmp(&_commands.back().transform, &transform, sizeof(sgp_mat2x3)) != 0)
+                _commands.push_back(command{type, blend_mode, transform, (uint32_t)_vertices.size(), 0, color, aabb()});
+            command &cmd = _commands.back();
+            cmd.count += (uint32_t)count;
+
+            sgp_color_ub4 c = color.ub4();
+            for (size_t i = 0; i < count; i++)
+            {
+                if (paint)
+                    c = paint->color_at(points[i]).ub4();
+                _vertices.push_back(sgp_vertex{points[i], {0.0f, 0.0f}, c});
+                cmd.bounds.add(points[i]);
+            }
+        }
+
+    protected:
+        std::vector<sgp_vertex> _vertices;
+        std::vector<command> _commands;
+        tessellator _tessellator;
+        geometry _scratch;
+    };
+
+    /**
+     * @brief Two display lists, one recorded by an application thread while the render thread replays the other
+     *
+     * The recording thread records the next frame into the list returned by begin_recording()
+     * and publishes it with end_recording(). The render thread draws the last published list
+     * with canvas::draw(display_list_pipeline &), the same list again when no new one has been
+     * published since. Only the render thread calls sokol, and the two threads wait on each
+     * other only while a list is being swapped with the one being replayed.
+     */
+    class display_list_pipeline
+    {
+    public:
+        /**
+         * @brief Get the list to record the next frame into, reset, on the recording thread
+         */
+        display_list &begin_recording()
+        {
+            // Only the recording thread changes _front
+            display_list &l = _lists[1 - _front];
+            l.reset();
+            return l;
+        }
+
+        /**
+         * @brief Publish the list recorded since begin_recording(), waiting for the replay of the last one to end
+         */
+        void end_recording()
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _replayed.wait(lock, [this]
+                           { return !_replaying; });
+            _front = 1 - _front;
+            _version++;
+        }
+
+        /**
+         * @brief Get the last published list, on the render thread, until end_replay()
+         *
+         * @return The list, or nullptr when no list has been published yet
+         */
+        const display_list *begin_replay()
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_version == 0)
+                return nullptr;
+            _replaying = true;
+            return &_lists[_front];
+        }
+
+        void end_replay()
+        {
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _replaying = false;
+            }
+            _replayed.notify_one();
+        }
+
+        /**
+         * @brief Get the number of lists published so far, it changes when there is a new frame to draw
+         */
+        uint64_t version() const
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            return _version;
+        }
+
+    protected:
+        std::array<display_list, 2> _lists;
+        int _front = 0; // List replayed by the render thread
+        uint64_t _version = 0;
+        bool _replaying = false;
+        mutable std::mutex _mutex;
+        std::condition_variable _replayed;
+    };
+
+    /**
+     * @brief Memory reused by the canvas from one frame to the next
+     *
+     * The canvas is usually created at the start of every frame, so the containers it records
+     * into live here instead. They are cleared but never shrunk: once the arena has grown to the
+     * size needed by the heaviest frame, building paths does not allocate.
+     */
+    class frame_arena
+    {
+    public:
+        void reset()
+        {
+            current_path.begin();
+            jobs.clear();
+            job_path_count = 0;
+            recorded_version = 0;
+            shape_texels.clear();
+            saved_states.clear();
+            image_rects.clear();
+            clip_paths.clear();
+            clip_fans.clear();
+        }
+
+        /**
+         * @brief Get the arena used by canvases created on the calling thread
+         */
+        static frame_arena &get_default()
+        {
+            thread_local frame_arena arena;
+            return arena;
+        }
+
+#ifdef IO2D_STATS
+        /**
+         * @brief Store the statistics of a completed frame
+         */
+        void record(const frame_stats &s)
+        {
+            last_stats = s;
+            history[history_next] = s;
+            history_next = (history_next + 1) % history.size();
+        }
+#endif
+
+    public:
+        path current_path;
+        tessellator scratch;
+
+        // Deferred tessellation, the containers holding geometry are never shrunk so their
+        // capacity is reused from frame to frame
+        job_pool *pool = nullptr;                  // Pool tessellating the recorded draws, job_pool::get_default() when null
+        std::vector<draw_job> jobs;                // Draws recorded since the last submit
+        std::vector<path> job_paths;               // Copies of the paths of the recorded draws
+        size_t job_path_count = 0;                 // Used entries of job_paths
+        uint64_t recorded_version = 0;             // current_path version copied in the last job path
+        std::vector<path_range> ranges;            // Scratch used to split the job paths
+        std::vector<tessellation_chunk> chunks;    // Tessellation tasks, in submission order
+        std::vector<tessellation_worker> workers;  // Scratch of every pool worker
+        std::vector<draw_item> items;              // Tessellated draws, reordered when canvas::sort_draws is set
+        std::vector<draw_batch> batches;           // Order in which the items are submitted
+        spatial_grid item_grid;                    // Boxes of the items, the identifiers are the item indices
+
+        std::vector<float> shape_texels;         // Parameters of the sdf_shapes drawn in the frame
+        std::vector<canvas_state> saved_states; // States pushed by canvas::save()
+        std::vector<sgp_textured_rect> image_rects; // Images of one atlas page waiting for canvas::submit()
+        std::vector<clip_path> clip_paths;          // Paths clipping the draws, see canvas::clip()
+        std::vector<sgp_triangle> clip_fans;        // Fans of the clip paths
+
+#ifdef IO2D_STATS
+        frame_stats last_stats;                 // Statistics of the last completed frame
+        std::array<frame_stats, 120> history{}; // Ring buffer of the last frames, drawn by canvas::draw_stats_overlay()
+        size_t history_next = 0;                // Next history slot to be written, also the oldest frame
+        std::vector<sgp_rect> overlay_rects;    // Scratch used to draw the overlay
+#endif
+    };
+
+    /**
+     * @brief Color and depth-stencil images a canvas can render into instead of the swapchain
+     *
+     * The images use the pixel formats and the sample count sokol_gp was set up with, so the
+     * sokol_gp pipelines can draw into them. With MSAA the color image is resolved into a single
+     * sampled image, returned by color_image().
+     */
+    class offscreen_target
+    {
+    public:
+        offscreen_target(int width, int height) : _width(width),
+                                                  _height(height)
+        {
+            sgp_desc sd = sgp_query_desc();
+
+            sg_image_desc desc = {};
+            desc.render_target = true;
+            desc.width = width;
+            desc.height = height;
+            desc.pixel_format = sd.color_format;
+            desc.sample_count = sd.sample_count;
+            _color = sg_make_image(&desc);
+
+            desc.pixel_format = sd.depth_format;
+            _depth = sg_make_image(&desc);
+
+            sg_attachments_desc atts = {};
+            atts.colors[0].image = _color;
+            atts.depth_stencil.image = _depth;
+            if (sd.sample_count > 1)
+            {
+                desc.pixel_format = sd.color_format;
+                desc.sample_count = 1;
+                _resolve = sg_make_image(&desc);
+                atts.resolves[0].image = _resolve;
+            }
+            _attachments = sg_make_attachments(&atts);
+        }
+
+        ~offscreen_target()
+        {
+            sg_destroy_attachments(_attachments);
+            sg_destroy_image(_resolve);
+            sg_destroy_image(_depth);
+            sg_destroy_image(_color);
+        }
+
+        offscreen_target(const offscreen_target &) = delete;
+        offscreen_target &operator=(const offscreen_target &) = delete;
+
+        bool valid() const
+        {
+            return sg_query_attachments_state(_attachments) == SG_RESOURCESTATE_VALID;
+        }
+
+        int width() const
+        {
+            return _width;
+        }
+
+        int height() const
+        {
+            return _height;
+        }
+
+        /**
+         * @brief Get the image holding the rendered frame, it can be sampled like any texture
+         */
+        sg_image color_image() const
+        {
+            return _resolve.id != SG_INVALID_ID ? _resolve : _color;
+        }
+
+        sg_attachments attachments() const
+        {
+            return _attachments;
+        }
+
+    protected:
+        int _width;
+        int _height;
+        sg_image _color{SG_INVALID_ID};
+        sg_image _depth{SG_INVALID_ID};
+        sg_image _resolve{SG_INVALID_ID};
+        sg_attachments _attachments{SG_INVALID_ID};
+    };
+
+    /**
+     * @brief Keeps the last frame in an offscreen target so that a canvas redraws only what changed
+     *
+     * Changes are declared with invalidate() before the frame begins. A canvas drawing on the
+     * target scissors the frame to the union of the invalidated rectangles, the previous frame is
+     * loaded around it, and the result is presented with a single textured quad. When nothing was
+     * invalidated the frame is not redrawn at all, see canvas::redraw_needed(). The whole frame is
+     * invalid at first and after the frame size changes. Invalidations made while drawing apply
+     * to the next frame.
+     */
+    class redraw_target
+    {
+    public:
+        redraw_target() {}
+
+        redraw_target(const redraw_target &) = delete;
+        redraw_target &operator=(const redraw_target &) = delete;
+
+        /**
+         * @brief Redraw the whole frame
+         */
+        void invalidate()
+        {
+            _all = true;
+        }
+
+        /**
+         * @brief Redraw a rectangle, in device pixels
+         */
+        void invalidate(const sgp_rect &r)
+        {
+            _dirty = _has_dirty ? rect_union(_dirty, r) : r;
+            _has_dirty = true;
+        }
+
+        /**
+         * @brief Redraw where a cached path was drawn in the last frame and where it will be drawn
+         *
+         * Call it once the path is edited, moved, restyled or hidden.
+         *
+         * @param p The cached path
+         * @param transform The device transform the path will be drawn with: the sokol_gp transform
+         *                  multiplied by the transform given to the canvas
+         */
+        void invalidate(const cached_path &p, const sgp_mat2x3 &transform = mat2x3_identity())
+        {
+            sgp_rect r;
+            if (p.drawn_bounds(r))
+                invalidate(r);
+            if (p.bounds(r))
+                invalidate(mat2x3_transform_rect(transform, r));
+        }
+
+        /**
+         * @brief Start a frame: resize the target if needed and take the invalidated pixels
+         *
+         * @param out The invalidated pixels, grown by one pixel for the antialiasing and clipped to the frame
+         * @return false if there is no pixel to redraw
+         */
+        bool begin_frame(int width, int height, sgp_irect &out)
+        {
+            _frame = next_frame_id();
+            if (!_target || _target->width() != width || _target->height() != height)
+            {
+                _target.reset();
+                _target = std::make_unique<offscreen_target>(width, height);
+                _all = true;
+            }
+
+            bool dirty = _all || _has_dirty;
+            if (_all)
+            {
+                out = sgp_irect{0, 0, width, height};
+            }
+            else if (_has_dirty)
+            {
+                int x0 = std::max(0, (int)std::floor(_dirty.x) - 1);
+                int y0 = std::max(0, (int)std::floor(_dirty.y) - 1);
+                int x1 = std::min(width, (int)std::ceil(_dirty.x + _dirty.w) + 1);
+                int y1 = std::min(height, (int)std::ceil(_dirty.y + _dirty.h) + 1);
+                out = sgp_irect{x0, y0, x1 - x0, y1 - y0};
+                dirty = x1 > x0 && y1 > y0;
+            }
+            _all = false;
+            _has_dirty = false;
+
+            return dirty;
+        }
+
+        /**
+         * @brief Get the target holding the last frame, valid after the first begin_frame()
+         */
+        const offscreen_target &frame() const
+        {
+            return *_target;
+        }
+
+        /**
+         * @brief Get the identifier of the current frame, unique among all the redraw targets
+         */
+        uint64_t frame_id() const
+        {
+            return _frame;
+        }
+
+    protected:
+        static uint64_t next_frame_id()
+        {
+            static std::atomic<uint64_t> counter{0};
+            return ++counter;
+        }
+
+    protected:
+        std::unique_ptr<offscreen_target> _target;
+        sgp_rect _dirty{};
+        bool _has_dirty = false;
+        bool _all = true;
+        uint64_t _frame = 0;
+    };
+
+    class canvas
+    {
+    public:
+        /**
+         * @brief Begin drawing a frame
+         *
+         * @param w The frame width
+         * @param h The frame height
+         * @param arena The arena the canvas records into, it must not be shared with another live canvas
+         */
+        canvas(int w, int h, frame_arena &arena = frame_arena::get_default()) : _arena(arena),
+                                                                               _path(arena.current_path)
+        {
+#ifdef IO2D_STATS
+            _frame_start = stats_timer::now();
+            frame_stats::current() = frame_stats{};
+            sg_enable_frame_stats();
+#endif
+            _arena.reset();
+            begin_usage();
+            sgp_begin(w, h);
+            sgp_viewport(0, 0, w, h);
+            _cull = aabb(0.0f, 0.0f, (float)w, (float)h);
+            _scissor = sgp_irect{0, 0, w, h};
+            clip_mask::get_default().active = false;
+        }
+
+        /**
+         * @brief Begin drawing a frame into an offscreen target instead of the swapchain
+         *
+         * Nothing is presented, the frame can be read from target.color_image() once the canvas
+         * is destroyed. This allows rendering without a window, e.g. for tests and benchmarks.
+         *
+         * @param target The target, it must outlive the canvas
+         * @param arena The arena the canvas records into, it must not be shared with another live canvas
+         */
+        canvas(const offscreen_target &target, frame_arena &arena = frame_arena::get_default()) : canvas(target.width(), target.height(), arena)
+        {
+            _attachments = target.attachments();
+        }
+
+        /**
+         * @brief Begin drawing a frame kept in a redraw target, only its invalidated pixels are redrawn
+         *
+         * The draws are clipped to the invalidated pixels, so the whole frame can be drawn as
+         * usual, or skipped when redraw_needed() is false. The frame is presented to the swapchain
+         * when the canvas is destroyed.
+         *
+         * @param target The target, it must outlive the canvas
+         * @param w The frame width
+         * @param h The frame height
+         * @param arena The arena the canvas records into, it must not be shared with another live canvas
+         */
+        canvas(redraw_target &target, int w, int h, frame_arena &arena = frame_arena::get_default()) : canvas(w, h, arena)
+        {
+            begin_redraw(target);
+        }
+
+        /**
+         * @brief Begin drawing a frame kept in a redraw target and presented to an offscreen target
+         *
+         * @param target The target, it must outlive the canvas
+         * @param output The offscreen target the frame is presented to, it must outlive the canvas
+         * @param arena The arena the canvas records into, it must not be shared with another live canvas
+         */
+        canvas(redraw_target &target, const offscreen_target &output, frame_arena &arena = frame_arena::get_default()) : canvas(output.width(), output.height(), arena)
+        {
+            _present_attachments = output.attachments();
+            begin_redraw(target);
+        }
+
+        ~canvas()
+        {
+            submit();
+            clip_mask::get_default().active = false;
+#ifdef IO2D_STATS
+            uint64_t flush_start = stats_timer::now();
+#endif
+            upload_textures();
+
+            if (redraw_needed())
+            {
+                begin_pass();
+                // Dispatch all draw commands to Sokol GFX.
+                sgp_flush();
+                sg_end_pass();
+            }
+            if (_target)
+                present();
+            end_usage();
+            // Finish a draw command queue, clearing it.
+            sgp_end();
+            // Commit Sokol render.
+            sg_commit();
+
+#ifdef IO2D_STATS
+            frame_stats &s = frame_stats::current();
+            s.flush_ms += stm_ms(stm_since(flush_start));
+            s.frame_ms = stm_ms(stm_since(_frame_start));
+            s.gpu_draws = sg_query_frame_stats().num_draw;
+            s.merged_commands = s.commands > s.gpu_draws ? s.commands - s.gpu_draws : 0;
+            _arena.record(s);
+#endif
+        }
+
+        /**
+         * @brief Dispatch the draws recorded so far to sokol_gfx, in the render pass of the frame
+         *
+         * The pass begins at the first flush and ends when the canvas is destroyed. The textures
+         * read by the draws so far are uploaded, and they can be updated once per frame: once
+         * the shapes of draw_ellipse(), draw_roundrect() and draw_line() have been uploaded the
+         * next ones are tessellated, once the gradients have been the new ones are evaluated at
+         * the vertices. A flush before any of them costs nothing.
+         *
+         * The canvas also flushes by itself when the sokol_gp command buffer is full, see sgp_usage.
+         */
+        void flush()
+        {
+            submit();
+            if (redraw_needed())
+                flush_commands();
+        }
+
+        /**
+         * @brief Check if the frame has any pixel to redraw, always true without a redraw target
+         *
+         * When it is false the frame shows the last one again, draws are discarded.
+         */
+        bool redraw_needed() const
+        {
+            return !_target || _redraw;
+        }
+
+        void begin_path()
+        {
+            _path.begin();
+        }
+
+        void clear()
+        {
+            submit();
+            sgp_set_color(fill_style.color.r, fill_style.color.g, fill_style.color.b, fill_style.color.a);
+            clip_mask::scope clip(SG_PRIMITIVETYPE_TRIANGLES);
+            sgp_clear();
+            IO2D_SUBMIT_ADD(commands, 1);
+        }
+
+        void line(const sgp_point &pt1, const sgp_point &pt2)
+        {
+            _path.line(pt1, pt2);
+        }
+
+        void rectangle(const sgp_point &pt1, const sgp_point &pt2)
+        {
+            _path.rectangle(pt1, pt2);
+        }
+
+        void roundrect(const sgp_point &pt1, const sgp_point &pt2, float rx, float ry)
+        {
+            _path.roundrect(pt1, pt2, rx, ry);
+        }
+
+        void ellipse(const sgp_point &pt1, const sgp_point &pt2, float alpha_start = 0.0f, float alpha_end = M_PI * 2)
+        {
+            _path.ellipse(pt1, pt2, alpha_start, alpha_end);
+        }
+
+        void move_to(const sgp_point &pt)
+        {
+            _path.move_to(pt);
+        }
+
+        void line_to(const sgp_point &pt)
+        {
+            ensure_sub_path(pt);
+            _path.line_to(pt);
+        }
+
+        void arc_to(const sgp_point &pt1, const sgp_point &pt2, float radius)
+        {
+            ensure_sub_path(pt1);
+            _path.arc_to(pt1, pt2, radius);
+        }
+
+        void quadratic_curve_to(const sgp_point &cp, const sgp_point &pt)
+        {
+            ensure_sub_path(cp);
+            _path.quadratic_curve_to(cp, pt);
+        }
+
+        void bezier_curve_to(const sgp_point &cp1, const sgp_point &cp2, const sgp_point &pt)
+        {
+            ensure_sub_path(cp1);
+            _path.bezier_curve_to(cp1, cp2, pt);
+        }
+
+        void close_path()
+        {
+            ensure_sub_path(sgp_point{0, 0});
+            _path.close_path();
+        }
+
+        /**
+         * @brief Push the transform, the styles and the clip, like save() of the HTML5 canvas
+         *
+         * The states are kept by the canvas instead of the sokol_gp transform stack, so the
+         * depth is not limited.
+         */
+        void save()
+        {
+            _arena.saved_states.emplace_back(canvas_state{sgp_query_state()->transform, fill_style, stroke_style, text_style,
+                                                           _scissor, _cull, _arena.clip_paths.size()});
+        }
+
+        /**
+         * @brief Pop the state pushed by the last save(), does nothing if there is none
+         */
+        void restore()
+        {
+            if (_arena.saved_states.empty())
+                return;
+
+            const canvas_state &s = _arena.saved_states.back();
+            set_transform(s.transform);
+            fill_style = s.fill_style;
+            stroke_style = s.stroke_style;
+            text_style = s.text_style;
+            if (s.clip_paths != _arena.clip_paths.size() || s.scissor.x != _scissor.x || s.scissor.y != _scissor.y ||
+                s.scissor.w != _scissor.w || s.scissor.h != _scissor.h)
+            {
+                submit();
+                set_scissor(s.scissor);
+                if (s.clip_paths != _arena.clip_paths.size())
+                {
+                    _arena.clip_paths.resize(s.clip_paths, clip_path{});
+                    _arena.clip_fans.resize(s.clip_paths > 0 ? _arena.clip_paths.back().first + _arena.clip_paths.back().count : 0);
+                    apply_clip_paths();
+                }
+            }
+            _cull = s.cull;
+            _arena.saved_states.pop_back();
+        }
+
+        /**
+         * @brief Move the origin of the coordinates
+         *
+         * Like the other transform methods it changes the sokol_gp transform. Unlike the HTML5
+         * canvas, the transform applies to the whole path when it is stroked or filled, not to
+         * each point when it is added. Paths are tessellated in their own units, so cached
+         * paths drawn with another transform are not tessellated again unless the scale changes
+         * enough to require another tessellation tolerance.
+         */
+        void translate(float x, float y)
+        {
+            sgp_translate(x, y);
+        }
+
+        /**
+         * @brief Rotate the coordinates around the origin, clockwise in device space
+         *
+         * @param angle The angle in radians
+         */
+        void rotate(float angle)
+        {
+            sgp_rotate(angle);
+        }
+
+        void scale(float sx, float sy)
+        {
+            sgp_scale(sx, sy);
+        }
+
+        /**
+         * @brief Multiply the current transform by a matrix, like transform() of the HTML5 canvas
+         */
+        void transform(const sgp_mat2x3 &m)
+        {
+            sgp_state *state = sgp_query_state();
+            set_transform(mat2x3_multiply(state->transform, m));
+        }
+
+        /**
+         * @brief Replace the current transform
+         */
+        void set_transform(const sgp_mat2x3 &m)
+        {
+            sgp_state *state = sgp_query_state();
+            state->transform = m;
+            state->mvp = mat2x3_multiply(state->proj, m);
+        }
+
+        void reset_transform()
+        {
+            sgp_reset_transform();
+        }
+
+        sgp_mat2x3 get_transform() const
+        {
+            return sgp_query_state()->transform;
+        }
+
+        /**
+         * @brief Stroke the current path, it is tessellated with the other recorded draws by submit()
+         */
+        void stroke()
+        {
+            record(draw_job::kind::stroke);
+        }
+
+        /**
+         * @brief Fill the current path, it is tessellated with the other recorded draws by submit()
+         */
+        void fill()
+        {
+            record(draw_job::kind::fill);
+        }
+
+        /**
+         * @brief Tessellate the recorded strokes and fills and send them to sokol_gp
+         *
+         * Large frames are split into chunks of whole elements tessellated on the arena job pool.
+         * The chunks do not depend on the number of workers, so the output is the same on any
+         * machine. The draws are sent in recording order, or grouped by pipeline when sort_draws
+         * is set (see order_draws()). The canvas calls it before drawing anything directly and
+         * when the frame ends, call it before drawing with sokol_gp directly.
+         */
+        void submit()
+        {
+            flush_images();
+            std::vector<draw_job> &jobs = _arena.jobs;
+            if (jobs.empty())
+                return;
+
+            size_t total_verbs = 0;
+            for (const draw_job &j : jobs)
+                total_verbs += _arena.job_paths[j.path_index].element_count();
+
+            // Small frames are not worth waking the workers, nor splitting the paths
+            job_pool *pool = nullptr;
+            size_t chunk_verbs = std::numeric_limits<size_t>::max();
+            if (total_verbs >= parallel_min_verbs)
+            {
+                pool = _arena.pool ? _arena.pool : &job_pool::get_default();
+                chunk_verbs = parallel_chunk_verbs;
+            }
+
+            std::vector<path_range> &ranges = _arena.ranges;
+            ranges.clear();
+            for (draw_job &j : jobs)
+            {
+                j.first_chunk = ranges.size();
+                _arena.job_paths[j.path_index].split(chunk_verbs, ranges);
+                j.chunk_count = ranges.size() - j.first_chunk;
+            }
+
+            std::vector<tessellation_chunk> &chunks = _arena.chunks;
+            if (chunks.size() < ranges.size())
+                chunks.resize(ranges.size());
+            for (size_t i = 0; i < jobs.size(); i++)
+            {
+                for (size_t c = jobs[i].first_chunk; c < jobs[i].first_chunk + jobs[i].chunk_count; c++)
+                {
+                    chunks[c].job = i;
+                    chunks[c].range = ranges[c];
+                }
+            }
+
+            unsigned workers = pool ? pool->size() : 1;
+            if (_arena.workers.size() < workers)
+                _arena.workers.resize(workers);
+
+            {
+                IO2D_STATS_TIME(tessellate_ms);
+                auto task = [this](size_t index, unsigned worker)
+                { tessellate_chunk(_arena.chunks[index], _arena.workers[worker]); };
+                if (pool)
+                    pool->run(ranges.size(), task);
+                else
+                    for (size_t i = 0; i < ranges.size(); i++)
+                        task(i, 0);
+            }
+
+#ifdef IO2D_STATS
+            for (size_t c = 0; c < ranges.size(); c++)
+                IO2D_STATS_ADD(culled, chunks[c].culled);
+#endif
+            order_draws();
+
+            const std::vector<draw_item> &items = _arena.items;
+            sgp_state *state = sgp_query_state();
+            sgp_mat2x3 transform = state->transform;
+            sgp_blend_mode blend_mode = state->blend_mode;
+            for (const draw_batch &b : _arena.batches)
+            {
+                for (size_t i = b.first; i != draw_item::npos; i = items[i].next)
+                {
+                    const draw_job &j = jobs[items[i].job];
+                    state->transform = j.transform;
+                    state->mvp = mat2x3_multiply(state->proj, j.transform);
+                    sgp_set_blend_mode(j.blend_mode);
+                    for (size_t c = j.first_chunk; c < j.first_chunk + j.chunk_count; c++)
+                    {
+                        const geometry &g = chunks[c].output;
+                        if (!reserve(1, items[i].lines ? g.lines.size() * 2 : g.triangles.size() * 3))
+                            continue;
+                        if (items[i].lines)
+                            g.draw_lines(j.stroke_style.color, j.stroke_style.gradient);
+                        else
+                            g.draw_triangles(j.stroke_style.color, j.stroke_style.gradient);
+                    }
+                }
+            }
+            state->transform = transform;
+            state->mvp = mat2x3_multiply(state->proj, transform);
+            sgp_set_blend_mode(blend_mode);
+
+            jobs.clear();
+            _arena.job_path_count = 0;
+            _arena.recorded_version = 0;
+        }
+
+        /**
+         * @brief Fill the current path with the given fill rule using the stencil buffer
+         *
+         * Self-intersecting sub paths and overlapping elements are filled like the HTML5 canvas
+         * fill(fillRule) does. When the stencil fill is not available the path is triangulated
+         * on the CPU like fill().
+         */
+        void fill(fill_rule rule)
+        {
+            submit();
+            stencil_fill &s = stencil_fill::get_default();
+            if (!s.available())
+            {
+                fill();
+                return;
+            }
+
+            IO2D_STATS_ADD(primitives, _path.element_count());
+            if (!visible(_path.bounds(), 0.0f))
+            {
+                IO2D_STATS_ADD(culled, _path.element_count());
+                return;
+            }
+            tessellator &t = scratch();
+            sgp_rect bounds;
+            t.output.clear();
+            if (!_path.tessellate_stencil(t.output.triangles, bounds, t))
+                return;
+
+            if (!reserve(2, t.output.triangles.size() * 3 + 6))
+                return;
+            const rgba_color &c = fill_style.color;
+            sgp_set_color(c.r, c.g, c.b, c.a);
+            s.draw(t.output.triangles, bounds, rule, fill_style.gradient);
+        }
+
+        /**
+         * @brief Intersect the clip with the current path, like the HTML5 canvas clip(fillRule)
+         *
+         * The clip applies to the following draws until restore() pops a state saved before it.
+         * A rectangle drawn with a transform that only scales, translates or rotates by quarter
+         * turns is clipped by the scissor, other paths by clip_mask, also scissored to their
+         * bounding box. Without a depth-stencil attachment the draws are clipped to the bounding
+         * box of the path instead. Draws outside of the clip bounds are culled on the CPU.
+         * Applying a path through the stencil costs a draw of its fans and of a rectangle covering
+         * the clips of the frame, restore() draws the remaining ones again.
+         */
+        void clip(fill_rule rule = fill_rule::nonzero)
+        {
+            submit();
+            const sgp_mat2x3 &m = sgp_query_state()->transform;
+            bool axis_aligned = (m.v[0][1] == 0.0f && m.v[1][0] == 0.0f) || (m.v[0][0] == 0.0f && m.v[1][1] == 0.0f);
+            aabb rect;
+            bool scissored = axis_aligned && _path.is_rectangle(rect);
+            aabb bounds = (scissored ? rect : _path.bounds()).transformed(m);
+
+            // The rectangle keeps the pixels whose center is inside, like when it is filled, the
+            // bounding box of other paths every pixel it touches
+            aabb box = bounds.intersected(aabb((float)_scissor.x - 1.0f, (float)_scissor.y - 1.0f,
+                                               (float)(_scissor.x + _scissor.w) + 1.0f, (float)(_scissor.y + _scissor.h) + 1.0f));
+            sgp_irect r = {0, 0, 0, 0};
+            if (!box.empty() && scissored)
+            {
+                r.x = (int)std::ceil(box.x0 - 0.5f);
+                r.y = (int)std::ceil(box.y0 - 0.5f);
+                r.w = (int)std::ceil(box.x1 - 0.5f) - r.x;
+                r.h = (int)std::ceil(box.y1 - 0.5f) - r.y;
+            }
+            else if (!box.empty())
+            {
+                r.x = (int)std::floor(box.x0);
+                r.y = (int)std::floor(box.y0);
+                r.w = (int)std::floor(box.x1) + 1 - r.x;
+                r.h = (int)std::floor(box.y1) + 1 - r.y;
+            }
+
+            clip_mask &mask = clip_mask::get_default();
+            if (!scissored && mask.available())
+            {
+                tessellator &t = scratch();
+                sgp_rect fan_bounds;
+                size_t first = _arena.clip_fans.size();
+                if (!_path.tessellate_stencil(_arena.clip_fans, fan_bounds, t))
+                {
+                    r = sgp_irect{0, 0, 0, 0};
+                    bounds = aabb();
+                }
+                else
+                {
+                    _arena.clip_paths.emplace_back(clip_path{first, _arena.clip_fans.size() - first, m, rule});
+                    _stencil_bounds.add(box.grown(1.0f));
+                    if (reserve(2, _arena.clip_paths.back().count * 3 + 6))
+                        mask.apply(&_arena.clip_fans[first], _arena.clip_paths.back().count, rule, _stencil_bounds.rect());
+                    mask.active = true;
+                }
+            }
+
+            set_scissor(intersect(r, _scissor));
+            _cull = _cull.intersected(bounds);
+        }
+
+        /**
+         * @brief Draw an image of image_atlas::get_default() at its size, like drawImage(image, dx, dy)
+         *
+         * The size of an image still loading is unknown, its placeholder is drawn image_atlas::placeholder_size pixels wide.
+         */
+        void draw_image(uint32_t image, const sgp_point &pt)
+        {
+            int w, h;
+            image_atlas &atlas = image_atlas::get_default();
+            atlas.update();
+            atlas.size(image, w, h);
+            if (atlas.state(image) == image_atlas::image_state::loading)
+                w = h = image_atlas::placeholder_size;
+            else if (w == 0)
+                return;
+            draw_image(image, sgp_rect{0.0f, 0.0f, (float)w, (float)h}, sgp_rect{pt.x, pt.y, (float)w, (float)h});
+        }
+
+        /**
+         * @brief Draw a whole image scaled into a rectangle, like drawImage(image, dx, dy, dw, dh)
+         */
+        void draw_image(uint32_t image, const sgp_rect &dst)
+        {
+            int w, h;
+            image_atlas &atlas = image_atlas::get_default();
+            atlas.update();
+            atlas.size(image, w, h);
+            draw_image(image, sgp_rect{0.0f, 0.0f, (float)w, (float)h}, dst);
+        }
+
+        /**
+         * @brief Draw a region of an image scaled into a rectangle, like drawImage() with 9 arguments
+         *
+         * Images still loading are drawn as a placeholder covering dst. The images are drawn with
+         * the current transform and blend mode, set SGP_BLENDMODE_BLEND for transparent images.
+         * Consecutive images of the same atlas page are queued and drawn by a single
+         * sgp_draw_textured_rects() when another kind of draw, the transform or the blend mode
+         * changes.
+         *
+         * @param image An image of image_atlas::get_default()
+         * @param src The region in image pixels
+         * @param dst The rectangle it is drawn into
+         */
+        void draw_image(uint32_t image, const sgp_rect &src, const sgp_rect &dst)
+        {
+            IO2D_STATS_ADD(primitives, 1);
+            if (!visible(aabb(dst.x, dst.y, dst.x + dst.w, dst.y + dst.h), 0.0f))
+            {
+                IO2D_STATS_ADD(culled, 1);
+                return;
+            }
+
+            image_atlas &atlas = image_atlas::get_default();
+            atlas.update();
+            sg_image page_image;
+            sgp_rect page_src;
+            if (!atlas.locate(image, src, page_image, page_src))
+                return;
+
+            // Draws recorded before the image go first, they flush the queued images too
+            if (!_arena.jobs.empty())
+                submit();
+            queue_image(page_image, sgp_query_state()->blend_mode, sgp_color_ub4{255, 255, 255, 255}, sgp_textured_rect{dst, page_src});
+        }
+
+        /**
+         * @brief Draw a text with the fill color, like fillText() of the HTML5 canvas
+         *
+         * The glyphs come from glyph_cache::get_default(), rasterized for the size of the text in
+         * device pixels under the current transform. The text goes into the same queue as
+         * draw_image(), so a text is drawn by a single sgp_draw_textured_rects() and consecutive
+         * texts of the same color and transform share it. The text is blended with
+         * SGP_BLENDMODE_BLEND when the blend mode is SGP_BLENDMODE_NONE, the gradients are not
+         * used. Like images, glyphs rasterized after a flush are drawn from the next frame.
+         *
+         * @param text The text, in UTF-8
+         * @param pt Where the text is placed, see text_style
+         */
+        void fill_text(std::string_view text, const sgp_point &pt)
+        {
+            IO2D_STATS_ADD(primitives, 1);
+            const bitmap_font &font = text_style.font ? *text_style.font : bitmap_font::get_default();
+            float pixels = text_style.size * mat2x3_max_scale(sgp_query_state()->transform);
+            int size = std::clamp((int)std::lround(pixels), 1, glyph_cache::max_size);
+            const glyph_cache::text_layout &l = glyph_cache::get_default().layout(font, size, text);
+            if (l.glyphs.empty())
+                return;
+
+            // Face pixels to path units, the text is placed on whole face pixels
+            float unit = text_style.size / size;
+            sgp_point origin = text_origin(font, l.width * unit, pt);
+            origin = sgp_point{std::round(origin.x / unit) * unit, std::round(origin.y / unit) * unit};
+            float top = origin.y - std::round(font.ascent * (float)size / font.height) * unit - unit;
+            if (!visible(aabb(origin.x - unit, top, origin.x + (l.width + 1.0f) * unit, top + (size + 2.0f) * unit), 0.0f))
+            {
+                IO2D_STATS_ADD(culled, 1);
+                return;
+            }
+
+            image_atlas &atlas = image_atlas::get_default();
+            if (!_arena.jobs.empty())
+                submit();
+            sgp_blend_mode blend_mode = sgp_query_state()->blend_mode;
+            blend_mode = blend_mode == SGP_BLENDMODE_NONE ? SGP_BLENDMODE_BLEND : blend_mode;
+            sgp_color_ub4 color = fill_style.color.ub4();
+            for (const glyph_cache::placed_glyph &g : l.glyphs)
+            {
+                sg_image page_image;
+                sgp_rect src;
+                if (atlas.locate(g.image, sgp_rect{0.0f, 0.0f, g.w, g.h}, page_image, src))
+                    queue_image(page_image, blend_mode, color, sgp_textured_rect{sgp_rect{origin.x + g.x * unit, top, g.w * unit, g.h * unit}, src});
+            }
+        }
+
+        /**
+         * @brief Measure a text drawn with text_style, like measureText() of the HTML5 canvas
+         */
+        text_metrics measure_text(std::string_view text) const
+        {
+            const bitmap_font &font = text_style.font ? *text_style.font : bitmap_font::get_default();
+            float pixels = text_style.size * mat2x3_max_scale(sgp_query_state()->transform);
+            int size = std::clamp((int)std::lround(pixels), 1, glyph_cache::max_size);
+            float unit = text_style.size / size;
+
+            text_metrics m;
+            m.width = glyph_cache::get_default().layout(font, size, text).width * unit;
+            m.ascent = text_style.size * font.ascent / font.height;
+            m.descent = text_style.size - m.ascent;
+            return m;
+        }
+
+        /**
+         * @brief Draw filled rectangles, each with its own color, with the current sokol_gp state
+         *
+         * Every rectangle becomes a single quad, far cheaper than adding them to a path when there
+         * are thousands of them. The current path is not used.
+         */
+        void draw_rects(const rect_instance *rects, size_t count)
+        {
+            submit();
+            if (reserve(count / shape_batch::max_batch + 1, count * 6))
+                shape_batch::get_default().draw_rects(rects, count);
+        }
+
+        void draw_rects(const std::vector<rect_instance> &rects)
+        {
+            draw_rects(rects.data(), rects.size());
+        }
+
+        /**
+         * @brief Draw filled circles, each with its own color, with the current sokol_gp state
+         *
+         * Circles are not tessellated, each one is a quad cut by a fragment shader, see
+         * shape_batch. The current path is not used.
+         */
+        void draw_circles(const circle_instance *circles, size_t count)
+        {
+            submit();
+            if (reserve(count / shape_batch::max_batch + 1, count * 6))
+                shape_batch::get_default().draw_circles(circles, count);
+        }
 
-            // Compute angle between vectors
-            float angle = std::acos(dx1 * dx2 + dy1 * dy2);
-            float tanHalfAngle = std::tan(angle / 2.0);
+        void draw_circles(const std::vector<circle_instance> &circles)
+        {
+            draw_circles(circles.data(), circles.size());
+        }
+
+        /**
+         * @brief Fill then stroke an ellipse with the current styles, antialiased in a single draw
+         *
+         * Unlike adding the ellipse to a path the ellipse is not tessellated, see sdf_shapes. A
+         * transparent fill or stroke color skips that part. The current path is not used.
+         */
+        void draw_ellipse(const sgp_point &pt1, const sgp_point &pt2)
+        {
+            sgp_point center = {(pt1.x + pt2.x) * 0.5f, (pt1.y + pt2.y) * 0.5f};
+            sgp_point radii = {std::abs(pt2.x - pt1.x) * 0.5f, std::abs(pt2.y - pt1.y) * 0.5f};
+            if (!draw_shape(sdf_shapes::kind::ellipse, center, sgp_point{1.0f, 0.0f}, radii, 0.0f, 0.0f, true))
+            {
+                path_ellipse e(pt1, pt2);
+                draw_tessellated(e, true);
+            }
+        }
+
+        /**
+         * @brief Fill then stroke a rounded rectangle with the current styles, antialiased in a single draw
+         *
+         * See draw_ellipse().
+         */
+        void draw_roundrect(const sgp_point &pt1, const sgp_point &pt2, float rx, float ry)
+        {
+            sgp_point center = {(pt1.x + pt2.x) * 0.5f, (pt1.y + pt2.y) * 0.5f};
+            sgp_point half = {std::abs(pt2.x - pt1.x) * 0.5f, std::abs(pt2.y - pt1.y) * 0.5f};
+            rx = std::clamp(rx, 0.0f, half.x);
+            ry = std::clamp(ry, 0.0f, half.y);
+            if (rx == 0.0f || ry == 0.0f)
+                rx = ry = 0.0f;
+            if (!draw_shape(sdf_shapes::kind::roundrect, center, sgp_point{1.0f, 0.0f}, half, rx, ry, true))
+            {
+                path_roundrect e(pt1, pt2, rx, ry);
+                draw_tessellated(e, true);
+            }
+        }
+
+        /**
+         * @brief Stroke a line with the current stroke width, color and cap, antialiased in a single draw
+         *
+         * See draw_ellipse().
+         */
+        void draw_line(const sgp_point &pt1, const sgp_point &pt2)
+        {
+            sgp_point d = {pt2.x - pt1.x, pt2.y - pt1.y};
+            float length = std::sqrt(d.x * d.x + d.y * d.y);
+            float hw = stroke_style.width * 0.5f;
+            float cap = stroke_style.cap == line_cap::butt ? 0.0f : hw;
+            sgp_point axis = length > 0.0f ? sgp_point{d.x / length, d.y / length} : sgp_point{1.0f, 0.0f};
+            sgp_point center = {(pt1.x + pt2.x) * 0.5f, (pt1.y + pt2.y) * 0.5f};
+            sgp_point half = {length * 0.5f + cap, hw};
+            float r = stroke_style.cap == line_cap::round ? hw : 0.0f;
+            if (!draw_shape(sdf_shapes::kind::roundrect, center, axis, half, r, r, false))
+            {
+                path_line e(pt1, pt2);
+                draw_tessellated(e, false);
+            }
+        }
+
+        /**
+         * @brief Get the box, in the units of the current sokol_gp transform, outside of which nothing is drawn
+         *
+         * It holds the frame, or the pixels being redrawn with a redraw target, grown by one pixel.
+         * It is empty when nothing is drawn, and infinite when the transform cannot be inverted.
+         */
+        aabb visible_bounds() const
+        {
+            aabb cull;
+            if (!cull_box(sgp_query_state()->transform, 0.0f, cull))
+                return aabb(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(),
+                            std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+            return cull;
+        }
+
+        /**
+         * @brief Move the current path into a cached path, the canvas is left with an empty path
+         */
+        cached_path make_cached_path()
+        {
+            cached_path cp(_path);
+            _path.begin();
+
+            return cp;
+        }
+
+        /**
+         * @brief Fill a cached path with the current fill style
+         *
+         * @param p The cached path
+         * @param transform Transformation applied to the cached vertices
+         */
+        void fill(const cached_path &p, const sgp_mat2x3 &transform = mat2x3_identity())
+        {
+            submit();
+            push_transform(transform);
+            if (visible(p, 0.0f))
+            {
+                p.fill(fill_style, scratch());
+                track(p);
+            }
+            sgp_pop_transform();
+        }
+
+        /**
+         * @brief Stroke a cached path with the current stroke style
+         *
+         * @param p The cached path
+         * @param transform Transformation applied to the cached vertices
+         */
+        void stroke(const cached_path &p, const sgp_mat2x3 &transform = mat2x3_identity())
+        {
+            submit();
+            push_transform(transform);
+            if (visible(p, stroke_style.extent()))
+            {
+                p.stroke(stroke_style, scratch());
+                track(p);
+            }
+            sgp_pop_transform();
+        }
+
+        /**
+         * @brief Fill then stroke a cached path with the current styles
+         */
+        void draw(const cached_path &p, const sgp_mat2x3 &transform = mat2x3_identity())
+        {
+            submit();
+            push_transform(transform);
+            if (visible(p, stroke_style.extent()))
+            {
+                tessellator &t = scratch();
+                if (reserve(2, p.fill_geometry(t).vertex_count()))
+                    p.fill(fill_style, t);
+                if (reserve(2, p.stroke_geometry(stroke_style, t, dash_shader::get_default().supports(stroke_style)).vertex_count()))
+                    p.stroke(stroke_style, t);
+                track(p);
+            }
+            sgp_pop_transform();
+        }
+
+        /**
+         * @brief Draw a static geometry with its own colors and the current blend mode
+         *
+         * An uploaded geometry is drawn from its vertex buffer after a flush() of the draws
+         * before it, so no vertex is copied.
+         *
+         * @param g The geometry, it must not be destroyed until the frame is submitted
+         * @param transform Transformation applied to the vertices
+         */
+        void draw(const static_geometry &g, const sgp_mat2x3 &transform = mat2x3_identity())
+        {
+            submit();
+            push_transform(transform);
+            IO2D_STATS_ADD(primitives, 1);
+            if (!visible(g.bounds(), 0.0f))
+            {
+                IO2D_STATS_ADD(culled, 1);
+            }
+            else if (g.uploaded())
+            {
+                flush();
+                if (_pass_open)
+                {
+                    const sgp_state *state = sgp_query_state();
+                    static_geometry_shader::get_default().draw(g, state->mvp, state->blend_mode);
+                }
+            }
+            else if (reserve(g.runs().size(), g.vertex_count()))
+            {
+                g.draw_streamed();
+            }
+            sgp_pop_transform();
+        }
+
+        /**
+         * @brief Replay a display list, its transforms are applied after the given one
+         *
+         * The vertices are copied into sokol_gp at once, the list can change as soon as the
+         * call returns. The canvas styles and blend mode are not used.
+         */
+        void draw(const display_list &l, const sgp_mat2x3 &transform = mat2x3_identity())
+        {
+            submit();
+            sgp_state *state = sgp_query_state();
+            sgp_mat2x3 previous = state->transform;
+            sgp_blend_mode blend_mode = state->blend_mode;
+            sgp_color_ub4 color = state->color;
+            sgp_mat2x3 base = mat2x3_multiply(previous, transform);
+            const std::vector<sgp_vertex> &vertices = l.vertices();
+            for (const display_list::command &cmd : l.commands())
+            {
+                if (cmd.type == display_list::command::kind::clear)
+                {
+                    if (!reserve(1, 0))
+                        continue;
+                    sgp_set_color(cmd.color.r, cmd.color.g, cmd.color.b, cmd.color.a);
+                    clip_mask::scope clip(SG_PRIMITIVETYPE_TRIANGLES);
+                    sgp_clear();
+                    IO2D_SUBMIT_ADD(commands, 1);
+                    continue;
+                }
+
+                state->transform = mat2x3_multiply(base, cmd.transform);
+                state->mvp = mat2x3_multiply(state->proj, state->transform);
+                IO2D_STATS_ADD(primitives, 1);
+                if (!visible(cmd.bounds, 0.0f))
+                {
+                    IO2D_STATS_ADD(culled, 1);
+                    continue;
+                }
+                if (!reserve(1, cmd.count))
+                    continue;
+                sgp_set_blend_mode(cmd.blend_mode);
+                sg_primitive_type primitive = cmd.type == display_list::command::kind::lines ? SG_PRIMITIVETYPE_LINES : SG_PRIMITIVETYPE_TRIANGLES;
+                clip_mask::scope clip(primitive);
+                sgp_draw(primitive, &vertices[cmd.first], cmd.count);
+                IO2D_SUBMIT_ADD(commands, 1);
+                IO2D_SUBMIT_ADD(vertices, cmd.count);
+            }
+            state->transform = previous;
+            state->mvp = mat2x3_multiply(state->proj, previous);
+            sgp_set_blend_mode(blend_mode);
+            state->color = color;
+        }
+
+        /**
+         * @brief Replay the last list published to a pipeline, nothing before the first one
+         */
+        void draw(display_list_pipeline &p, const sgp_mat2x3 &transform = mat2x3_identity())
+        {
+            if (const display_list *l = p.begin_replay())
+                draw(*l, transform);
+            p.end_replay();
+        }
 
-            // Distance from intersection point to tangent points
-            float dist = radius / tanHalfAngle;
+#ifdef IO2D_STATS
+        /**
+         * @brief Get the statistics of the last completed frame drawn with the same arena
+         *
+         * gpu_draws comes from sg_query_frame_stats() and counts every sg_draw of the frame,
+         * including the ones not issued through the canvas.
+         */
+        const frame_stats &stats() const
+        {
+            return _arena.last_stats;
+        }
+
+        /**
+         * @brief Draw a graph of the CPU time of the last frames, call it after all the other drawing
+         *
+         * Each bar is a frame, from the oldest to the newest: tessellation time at the bottom, then
+         * flush time, then the rest of the frame. The horizontal line is the 60 Hz frame budget.
+         *
+         * The overlay is clipped like the other draws.
+         *
+         * @param origin Top left corner of the overlay
+         * @param ms_height Height in pixels of one millisecond
+         */
+        void draw_stats_overlay(const sgp_point &origin, float ms_height = 3.0f)
+        {
+            submit();
+            constexpr float bar_width = 2.0f;
+            constexpr float budget_ms = 1000.0f / 60.0f;
+            const auto &history = _arena.history;
+            float width = bar_width * history.size();
+            float height = budget_ms * 2.0f * ms_height;
+            float bottom = origin.y + height;
+            std::vector<sgp_rect> &rects = _arena.overlay_rects;
+            clip_mask::scope clip(SG_PRIMITIVETYPE_TRIANGLES);
+
+            if (reserve(1, 6))
+            {
+                sgp_set_color(0.0f, 0.0f, 0.0f, 0.6f);
+                sgp_draw_filled_rect(origin.x, origin.y, width, height);
+                IO2D_SUBMIT_ADD(commands, 1);
+                IO2D_SUBMIT_ADD(vertices, 6);
+            }
+
+            // Stacked bars clipped to the overlay height, one batch per layer
+            const rgba_color colors[3] = {rgba_color(0xffe69933), rgba_color(0xff4d99e6), rgba_color(0xff80cc66)};
+            for (int layer = 0; layer < 3; layer++)
+            {
+                rects.clear();
+                for (size_t i = 0; i < history.size(); i++)
+                {
+                    const frame_stats &f = history[(_arena.history_next + i) % history.size()];
+                    float levels[4] = {0.0f,
+                                       (float)f.tessellate_ms,
+                                       (float)(f.tessellate_ms + f.flush_ms),
+                                       (float)std::max(f.frame_ms, f.tessellate_ms + f.flush_ms)};
+                    float y0 = std::min(levels[layer] * ms_height, height);
+                    float y1 = std::min(levels[layer + 1] * ms_height, height);
+                    if (y1 > y0)
+                        rects.emplace_back(sgp_rect{origin.x + i * bar_width, bottom - y1, bar_width, y1 - y0});
+                }
+                if (rects.empty() || !reserve(1, rects.size() * 6))
+                    continue;
+
+                sgp_set_color(colors[layer].r, colors[layer].g, colors[layer].b, colors[layer].a);
+                sgp_draw_filled_rects(rects.data(), rects.size());
+                IO2D_SUBMIT_ADD(commands, 1);
+                IO2D_SUBMIT_ADD(vertices, rects.size() * 6);
+            }
+
+            if (reserve(1, 6))
+            {
+                sgp_set_color(1.0f, 0.2f, 0.2f, 1.0f);
+                sgp_draw_filled_rect(origin.x, bottom - budget_ms * ms_height, width, 1.0f);
+                IO2D_SUBMIT_ADD(commands, 1);
+                IO2D_SUBMIT_ADD(vertices, 6);
+            }
+        }
+#endif
 
-            // Compute tangent points
-            sgp_point tangent1 = {p1.x + dx1 * dist, p1.y + dy1 * dist};
-            sgp_point tangent2 = {p1.x + dx2 * dist, p1.y + dy2 * dist};
+    public:
+        stroke_style_s stroke_style;
+        fill_style_s fill_style;
+        text_style_s text_style;
+
+        // Maximum distance in device pixels between curves and the segments approximating them
+        float tessellation_tolerance = default_tessellation_tolerance;
 
-            // Compute arc center
-            float bisectX = dx1 + dx2;
-            float bisectY = dy1 + dy2;
-            float bisectLen = std::hypot(bisectX, bisectY);
-            bisectX /= bisectLen;
-            bisectY /= bisectLen;
+        // Let submit() move recorded draws before the draws they do not overlap, so draws
+        // with the same pipeline are merged by sokol_gp. The pixels do not change.
+        bool sort_draws = true;
 
-            sgp_point center = {
-                p1.x + bisectX * radius / std::sin(angle / 2.0f),
-                p1.y + bisectY * radius / std::sin(angle / 2.0f)};
+        static constexpr size_t sort_lookback = 64; // Batches a draw can be moved before
 
-            // Compute start and end angles
-            float startAngle = std::atan2(tangent1.y - center.y, tangent1.x - center.x);
-            float endAngle = std::atan2(tangent2.y - center.y, tangent2.x - center.x);
+        static constexpr size_t parallel_min_verbs = 512;   // Recorded path verbs needed to tessellate on the job pool
+        static constexpr size_t parallel_chunk_verbs = 128; // Path verbs tessellated by one task
 
-            // Determine arc direction
-            bool clockwise = (dx1 * dy2 - dy1 * dx2) < 0;
+    protected:
+        frame_arena &_arena;
+        path &_path;
+        sg_attachments _attachments{SG_INVALID_ID};         // Offscreen target, the swapchain when invalid
+        sg_attachments _present_attachments{SG_INVALID_ID}; // Where a redraw target frame is presented, the swapchain when invalid
+        redraw_target *_target = nullptr;
+        sgp_irect _dirty{};  // Pixels redrawn into the redraw target
+        bool _redraw = true; // False when the redraw target frame is presented again as is
+        bool _load = false;  // The redraw target keeps the pixels outside of _dirty
+        bool _pass_open = false;       // The render pass of the frame has begun, see flush()
+        bool _shapes_uploaded = false; // The sdf_shapes texture has been updated in the frame
+        aabb _cull;          // Pixels drawn, draws outside of them are skipped
+        sgp_irect _scissor{};  // Pixels the draws are clipped to, the invalidated ones intersected with the clips
+        aabb _stencil_bounds;  // Pixels where clip_mask may have set the clip bit since the pass began
+        sg_image _image_page{SG_INVALID_ID}; // Atlas page of the queued images
+        sgp_mat2x3 _image_transform{};       // Transform of the queued images
+        sgp_blend_mode _image_blend_mode = SGP_BLENDMODE_NONE;
+        sgp_color_ub4 _image_color{};        // Color multiplying the queued images, white but for texts
+#ifdef IO2D_STATS
+        uint64_t _frame_start = 0;
+#endif
 
-            // Compute angle difference
-            float deltaAngle = endAngle - startAngle;
-            if (clockwise && deltaAngle < 0)
-                deltaAngle += 2 * M_PI;
-            if (!clockwise && deltaAngle > 0)
-                deltaAngle -= 2 * M_PI;
+    protected:
+        /**
+         * @brief Queue a textured rectangle, the queue is drawn first if its state differs
+         */
+        void queue_image(sg_image page_image, sgp_blend_mode blend_mode, sgp_color_ub4 color, const sgp_textured_rect &rect)
+        {
+            const sgp_state *state = sgp_query_state();
+            std::vector<sgp_textured_rect> &rects = _arena.image_rects;
+            if (!rects.empty() && (page_image.id != _image_page.id || blend_mode != _image_blend_mode ||
+                                   std::memcmp(&color, &_image_color, sizeof(sgp_color_ub4)) != 0 ||
+                                   std::memcmp(&state->transform, &_image_transform, sizeof(sgp_mat2x3)) != 0))
+                flush_images();
+            if (rects.empty())
+            {
+                _image_page = page_image;
+                _image_transform = state->transform;
+                _image_blend_mode = blend_mode;
+                _image_color = color;
+            }
+            rects.push_back(rect);
+        }
 
-            // Estimate arc length
-            float arcLength = std::abs(deltaAngle) * radius;
+        /**
+         * @brief Get the baseline origin of a text of this width at pt, in path units
+         */
+        sgp_point text_origin(const bitmap_font &font, float width, const sgp_point &pt) const
+        {
+            float ascent = text_style.size * font.ascent / font.height;
+            float descent = text_style.size - ascent;
+            sgp_point origin = pt;
+            if (text_style.align == text_align::center)
+                origin.x -= width * 0.5f;
+            else if (text_style.align == text_align::right)
+                origin.x -= width;
+            if (text_style.baseline == text_baseline::top)
+                origin.y += ascent;
+            else if (text_style.baseline == text_baseline::middle)
+                origin.y += (ascent - descent) * 0.5f;
+            else if (text_style.baseline == text_baseline::bottom)
+                origin.y -= descent;
+            return origin;
+        }
 
-            // Automatically determine number of segments (1 point every ~2 pixels)
-            int segments = std::max(4, static_cast<int>(arcLength / 2.0));
+        /**
+         * @brief Draw the images queued by draw_image() and fill_text() with a single sgp_draw_textured_rects()
+         */
+        void flush_images()
+        {
+            std::vector<sgp_textured_rect> &rects = _arena.image_rects;
+            if (rects.empty() || !reserve(1, rects.size() * 6))
+            {
+                rects.clear();
+                return;
+            }
 
-            // Generate arc points
-            for (int i = 0; i <= segments; ++i)
+            image_atlas &atlas = image_atlas::get_default();
+            sgp_state *state = sgp_query_state();
+            sgp_mat2x3 transform = state->transform;
+            sgp_blend_mode blend_mode = state->blend_mode;
+            sgp_color_ub4 color = state->color;
+            state->transform = _image_transform;
+            state->mvp = mat2x3_multiply(state->proj, _image_transform);
+            sgp_set_blend_mode(_image_blend_mode);
+            state->color = _image_color;
+            sgp_set_image(0, _image_page);
+            sgp_set_sampler(0, atlas.sampler());
             {
-                float theta = startAngle + deltaAngle * i / segments;
-                arcPoints.push_back(sgp_point{center.x + radius * std::cos(theta), center.y + radius * std::sin(theta)});
+                clip_mask::scope clip(SG_PRIMITIVETYPE_TRIANGLES);
+                sgp_draw_textured_rects(0, rects.data(), (uint32_t)rects.size());
             }
+            sgp_reset_sampler(0);
+            sgp_reset_image(0);
+            IO2D_SUBMIT_ADD(commands, 1);
+            IO2D_SUBMIT_ADD(vertices, rects.size() * 6);
+
+            state->transform = transform;
+            state->mvp = mat2x3_multiply(state->proj, transform);
+            sgp_set_blend_mode(blend_mode);
+            state->color = color;
+            rects.clear();
+        }
 
-            return arcPoints;
+        /**
+         * @brief Get the pipeline of sokol_gp used by a draw, draws with the same key can be merged
+         */
+        static unsigned batch_key(bool lines, sgp_blend_mode blend_mode, bool gradient)
+        {
+            return static_cast<unsigned>(blend_mode) * 4 + (gradient ? 2 : 0) + (lines ? 1 : 0);
         }
 
-        static float cross(const sgp_point &a, const sgp_point &b, const sgp_point &c)
+        /**
+         * @brief Split the tessellated jobs into items and group them into batches
+         *
+         * The colors are already per vertex in sokol_gp, so draws are merged into one command
+         * as long as they share the pipeline, i.e. the primitive, the blend mode and whether a
+         * gradient is painted: the gradients of a frame share one texture. When
+         * sort_draws is set an item joins the last batch with its pipeline, unless an item of a
+         * later batch overlaps it: drawing the item earlier then would change its pixels. The
+         * overlapping items are found with a spatial_grid and only the last sort_lookback
+         * batches are searched, so ordering stays about linear.
+         */
+        void order_draws()
         {
-            return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+            const std::vector<draw_job> &jobs = _arena.jobs;
+            std::vector<draw_item> &items = _arena.items;
+            std::vector<draw_batch> &batches = _arena.batches;
+            items.clear();
+            batches.clear();
+            if (sort_draws)
+                _arena.item_grid.clear();
+
+            for (size_t i = 0; i < jobs.size(); i++)
+            {
+                const draw_job &j = jobs[i];
+                bool triangles = false;
+                bool lines = false;
+                aabb box;
+                for (size_t c = j.first_chunk; c < j.first_chunk + j.chunk_count; c++)
+                {
+                    const tessellation_chunk &chunk = _arena.chunks[c];
+                    triangles |= !chunk.output.triangles.empty();
+                    lines |= !chunk.output.lines.empty();
+                    box.add(chunk.bounds);
+                }
+                // One more pixel for the pixels rasterized at the edges of the lines
+                box = box.transformed(j.transform).grown(1.0f);
+                if (triangles)
+                    add_draw_item(i, false, box);
+                if (lines)
+                    add_draw_item(i, true, box);
+            }
         }
 
-        static bool is_convex(const sgp_point &prev, const sgp_point &curr, const sgp_point &next)
+        void add_draw_item(size_t job, bool lines, const aabb &box)
         {
-            return cross(prev, curr, next) < 0;
+            std::vector<draw_item> &items = _arena.items;
+            std::vector<draw_batch> &batches = _arena.batches;
+            size_t index = items.size();
+            items.emplace_back();
+            items.back().job = job;
+            items.back().lines = lines;
+            items.back().box = box;
+
+            const draw_job &j = _arena.jobs[job];
+            unsigned key = batch_key(lines, j.blend_mode, j.stroke_style.gradient != nullptr);
+            size_t target = batches.size();
+            if (sort_draws)
+            {
+                // The item cannot move before the last batch holding an item it overlaps
+                size_t stop = batches.size() > sort_lookback ? batches.size() - sort_lookback : 0;
+                _arena.item_grid.query(box, [&](uint32_t other)
+                                       { stop = std::max(stop, items[other].batch); });
+                for (size_t b = batches.size(); b-- > stop;)
+                {
+                    if (batches[b].key == key)
+                    {
+                        target = b;
+                        break;
+                    }
+                }
+                _arena.item_grid.insert(box);
+            }
+            else if (!batches.empty() && batches.back().key == key)
+                target = batches.size() - 1;
+
+            items[index].batch = target;
+            if (target == batches.size())
+            {
+                batches.emplace_back();
+                batches.back().key = key;
+                batches.back().first = index;
+                batches.back().last = index;
+                return;
+            }
+            draw_batch &b = batches[target];
+            items[b.last].next = index;
+            b.last = index;
         }
 
-        static bool point_in_triangle(const sgp_point &p, const sgp_triangle &t)
+        /**
+         * @brief Get the arena tessellator with the tolerance converted to path units
+         *
+         * The device tolerance is divided by the scale of the current sokol_gp transform, so
+         * zoomed in paths get more segments and zoomed out paths fewer.
+         */
+        tessellator &scratch()
         {
-            double d1 = cross(t.a, t.b, p);
-            double d2 = cross(t.b, t.c, p);
-            double d3 = cross(t.c, t.a, p);
-            bool has_neg = (d1 < 0) || (d2 < 0) || (d3 < 0);
-            bool has_pos = (d1 > 0) || (d2 > 0) || (d3 > 0);
-            return !(has_neg && has_pos);
+            tessellator &t = _arena.scratch;
+            t.tolerance = path_tolerance();
+            return t;
         }
 
-        static std::vector<sgp_triangle> triangulate_polygon(std::vector<sgp_point> polygon)
+        /**
+         * @brief Get the tessellation tolerance in path units for the current sokol_gp transform
+         */
+        float path_tolerance() const
         {
-            std::vector<sgp_triangle> triangles;
-            int n = polygon.size();
-            if (n < 3)
-                return triangles;
+            float scale = mat2x3_max_scale(sgp_query_state()->transform);
+            return scale > 0.0f ? tessellation_tolerance / scale : tessellation_tolerance;
+        }
 
-            std::vector<int> indices(n);
-            for (int i = 0; i < n; ++i)
-                indices[i] = i;
+        /**
+         * @brief Record a stroke or fill of the current path with the current styles and sokol_gp state
+         *
+         * The path is copied once even when it is both filled and stroked.
+         */
+        void record(draw_job::kind type)
+        {
+            if (_path.empty())
+                return;
 
-            while (indices.size() > 3)
+            IO2D_STATS_ADD(primitives, _path.element_count());
+            const sgp_state *state = sgp_query_state();
+            aabb cull;
+            bool culling = cull_box(state->transform, type == draw_job::kind::stroke ? stroke_style.extent() : 0.0f, cull);
+            if (culling && !_path.bounds().intersects(cull))
             {
-                bool ear_found = false;
-                for (size_t i = 0; i < indices.size(); ++i)
-                {
-                    int prev = indices[(i + indices.size() - 1) % indices.size()];
-                    int curr = indices[i];
-                    int next = indices[(i + 1) % indices.size()];
-
-                    sgp_point a = polygon[prev];
-                    sgp_point b = polygon[curr];
-                    sgp_point c = polygon[next];
+                IO2D_STATS_ADD(culled, _path.element_count());
+                return;
+            }
 
-                    if (!is_convex(a, b, c))
-                        continue;
+            if (_arena.job_path_count == 0 || _arena.recorded_version != _path.version())
+            {
+                if (_arena.job_paths.size() == _arena.job_path_count)
+                    _arena.job_paths.emplace_back();
+                _arena.job_paths[_arena.job_path_count++] = _path;
+                _arena.recorded_version = _path.version();
+            }
 
-                    sgp_triangle ear = {a, b, c};
-                    bool contains_point = false;
-                    for (int j : indices)
-                    {
-                        if (j == prev || j == curr || j == next)
-                            continue;
-                        if (point_in_triangle(polygon[j], ear))
-                        {
-                            contains_point = true;
-                            break;
-                        }
-                    }
+            draw_job j;
+            j.type = type;
+            j.path_index = _arena.job_path_count - 1;
+            j.stroke_style = stroke_style;
+            if (type == draw_job::kind::fill)
+            {
+                j.stroke_style.color = fill_style.color;
+                j.stroke_style.gradient = fill_style.gradient;
+            }
+            j.tolerance = path_tolerance();
+            j.transform = state->transform;
+            j.blend_mode = state->blend_mode;
+            j.cull = cull;
+            j.culling = culling;
+            _arena.jobs.emplace_back(j);
+        }
 
-                    if (!contains_point)
-                    {
-                        triangles.push_back(ear);
-                        indices.erase(indices.begin() + i);
-                        ear_found = true;
-                        break;
-                    }
-                }
+        /**
+         * @brief Tessellate one chunk of a recorded draw, runs on any job pool worker
+         */
+        void tessellate_chunk(tessellation_chunk &c, tessellation_worker &w) const
+        {
+            const draw_job &j = _arena.jobs[c.job];
+            const path &p = _arena.job_paths[j.path_index];
+            tessellator &t = w.scratch;
+            t.tolerance = j.tolerance;
+            c.output.clear();
+
+            const aabb *cull = j.culling ? &j.cull : nullptr;
+            if (j.type == draw_job::kind::stroke)
+                c.culled = p.visit(c.range, t.tolerance, w.sub, cull, [&](auto &e)
+                                   { e.tessellate_stroke(j.stroke_style, c.output, t); });
+            else
+                c.culled = p.visit(c.range, t.tolerance, w.sub, cull, [&](auto &e)
+                                   { e.tessellate_fill(c.output, t); });
 
-                if (!ear_found)
-                {
-                    return std::vector<sgp_triangle>{}; // Fallback in case of failure
-                }
-            }
+            sgp_rect r;
+            c.bounds = c.output.bounds(r) ? aabb(r.x, r.y, r.x + r.w, r.y + r.h) : aabb();
+        }
 
-            // Triangolo finale
-            if (indices.size() == 3)
+        /**
+         * @brief Draw a shape with sdf_shapes, filled with the fill color or, for lines, with the stroke color
+         *
+         * @return false if the shape could not be drawn, it must be tessellated. Shapes not
+         *         visible are skipped and return true
+         */
+        bool draw_shape(sdf_shapes::kind k, const sgp_point &center, const sgp_point &axis, const sgp_point &half_size,
+                        float rx, float ry, bool stroked)
+        {
+            float ex = std::abs(axis.x) * half_size.x + std::abs(axis.y) * half_size.y;
+            float ey = std::abs(axis.y) * half_size.x + std::abs(axis.x) * half_size.y;
+            float pad = stroked ? stroke_style.width * 0.5f : 0.0f;
+            if (!visible(aabb(center.x - ex, center.y - ey, center.x + ex, center.y + ey), pad))
             {
-                triangles.push_back({polygon[indices[0]], polygon[indices[1]], polygon[indices[2]]});
+                IO2D_STATS_ADD(primitives, 1);
+                IO2D_STATS_ADD(culled, 1);
+                return true;
             }
 
-            return triangles;
+            // Gradients and dashes are drawn on the tessellated geometry
+            sdf_shapes &s = sdf_shapes::get_default();
+            if (!s.available() || fill_style.gradient || stroke_style.gradient || stroke_style.dashed())
+                return false;
+            submit();
+            if (!reserve(1, 6))
+                return true;
+            // The shape parameters texture has been uploaded by flush()
+            if (_shapes_uploaded)
+                return false;
+
+            IO2D_STATS_ADD(primitives, 1);
+            float half_stroke = stroked ? stroke_style.width * 0.5f : 0.0f;
+            const rgba_color &fill = stroked ? fill_style.color : stroke_style.color;
+            return s.draw(_arena.shape_texels, k, center, axis, half_size, rx, ry, half_stroke, fill, stroke_style.color);
         }
 
-    protected:
-        std::vector<sgp_point> _points;
-    };
+        /**
+         * @brief Fallback of the draw_ellipse(), draw_roundrect() and draw_line() shader path
+         */
+        void draw_tessellated(const abstract_sub_path &e, bool filled)
+        {
+            submit();
+            tessellator &t = scratch();
+            if (filled)
+            {
+                t.output.clear();
+                e.tessellate_fill(t.output, t);
+                if (reserve(2, t.output.vertex_count()))
+                    t.output.draw(fill_style.color, fill_style.gradient);
+            }
+            if (stroke_style.width <= 0.0f)
+                return;
+            t.output.clear();
+            e.tessellate_stroke(stroke_style, t.output, t);
+            if (reserve(2, t.output.vertex_count()))
+                t.output.draw(stroke_style.color, stroke_style.gradient);
+        }
 
-    class path
-    {
-    public:
-        void begin()
+        /**
+         * @brief Get the box, in the units of a transform, outside of which nothing is drawn
+         *
+         * The box holds the drawn pixels, assuming the sokol_gp projection set by the canvas,
+         * grown by one pixel for the antialiasing and by pad.
+         *
+         * @param pad Distance the geometry can extend past the bounding box of the path, in path units
+         * @return false if the transform cannot be inverted, nothing must be culled
+         */
+        bool cull_box(const sgp_mat2x3 &transform, float pad, aabb &out) const
         {
-            _elements.clear();
+            sgp_mat2x3 inverse;
+            if (!mat2x3_invert(transform, inverse))
+                return false;
+
+            out = _cull.grown(1.0f).transformed(inverse).grown(pad);
+            return true;
         }
 
-        void add(std::unique_ptr<abstract_sub_path> &&e)
+        static sgp_irect intersect(const sgp_irect &a, const sgp_irect &b)
         {
-            _elements.emplace_back(std::move(e));
+            int x0 = std::max(a.x, b.x);
+            int y0 = std::max(a.y, b.y);
+            int x1 = std::min(a.x + a.w, b.x + b.w);
+            int y1 = std::min(a.y + a.h, b.y + b.h);
+            return sgp_irect{x0, y0, std::max(x1 - x0, 0), std::max(y1 - y0, 0)};
         }
 
-        void stroke(const stroke_style_s &style)
+        /**
+         * @brief Clip the following draws to a rectangle in pixels
+         */
+        void set_scissor(const sgp_irect &r)
         {
-            for (auto &e : _elements)
-                e->stroke(style);
+            if (r.x == _scissor.x && r.y == _scissor.y && r.w == _scissor.w && r.h == _scissor.h)
+                return;
+            _scissor = r;
+            if (reserve(1, 0))
+                sgp_scissor(r.x, r.y, r.w, r.h);
         }
 
-        void fill(const fill_style_s &style)
+        /**
+         * @brief Build the clip mask again from the clip paths left in the arena
+         */
+        void apply_clip_paths()
         {
-            for (auto &e : _elements)
-                e->fill(style);
+            clip_mask &mask = clip_mask::get_default();
+            mask.active = false;
+            if (_arena.clip_paths.empty())
+                return;
+
+            sgp_state *state = sgp_query_state();
+            sgp_mat2x3 transform = state->transform;
+            for (const clip_path &c : _arena.clip_paths)
+            {
+                if (!reserve(2, c.count * 3 + 6))
+                    break;
+                state->transform = c.transform;
+                state->mvp = mat2x3_multiply(state->proj, c.transform);
+                mask.apply(&_arena.clip_fans[c.first], c.count, c.rule, _stencil_bounds.rect());
+            }
+            state->transform = transform;
+            state->mvp = mat2x3_multiply(state->proj, transform);
+            mask.active = true;
         }
 
-        bool empty() const
+        /**
+         * @brief Check if a box in the units of the current sokol_gp transform, grown by pad, may be drawn
+         */
+        bool visible(const aabb &box, float pad) const
         {
-            return _elements.empty();
+            aabb cull;
+            return !cull_box(sgp_query_state()->transform, pad, cull) || box.intersects(cull);
         }
 
-        sub_path *current_sub_path()
+        bool visible(const cached_path &p, float pad) const
         {
-            if (_elements.empty())
-                return nullptr;
+            if (visible(p.get_path().bounds(), pad))
+                return true;
 
-            return dynamic_cast<sub_path *>(_elements.back().get());
+            IO2D_STATS_ADD(primitives, p.get_path().element_count());
+            IO2D_STATS_ADD(culled, p.get_path().element_count());
+            return false;
         }
 
-    protected:
-        std::vector<std::unique_ptr<abstract_sub_path>> _elements;
-    };
-
-    class canvas
-    {
-    public:
-        canvas(int w, int h)
+        /**
+         * @brief Take the invalidated pixels of a redraw target and clip the frame to them
+         *
+         * When there is nothing to redraw the frame is clipped to no pixel: the draws are still
+         * queued, but they are flushed behind the presented frame and never rasterized.
+         */
+        void begin_redraw(redraw_target &target)
         {
-            sgp_begin(w, h);
-            sgp_viewport(0, 0, w, h);
+            const sgp_isize &size = sgp_query_state()->frame_size;
+            _target = &target;
+            _redraw = target.begin_frame(size.w, size.h, _dirty);
+            _attachments = target.frame().attachments();
+            _load = _dirty.w < size.w || _dirty.h < size.h;
+            if (_redraw)
+            {
+                _scissor = _dirty;
+                _cull = aabb((float)_dirty.x, (float)_dirty.y, (float)(_dirty.x + _dirty.w), (float)(_dirty.y + _dirty.h));
+            }
+            else
+            {
+                _scissor = sgp_irect{0, 0, 0, 0};
+                _cull = aabb();
+            }
+            sgp_scissor(_scissor.x, _scissor.y, _scissor.w, _scissor.h);
         }
 
-        ~canvas()
+        /**
+         * @brief Present the redraw target frame to the swapchain or to the output target
+         */
+        void present()
         {
-            // Begin a render pass.
+            const sgp_isize size = sgp_query_state()->frame_size;
+            float w = (float)size.w;
+            float h = (float)size.h;
+            // GL textures start at the bottom row
+            sgp_rect src = sg_query_features().origin_top_left ? sgp_rect{0.0f, 0.0f, w, h} : sgp_rect{0.0f, h, w, -h};
+
+            // Not sgp_reset_state(), it asserts when no custom pipeline is set
+            sgp_reset_viewport();
+            sgp_reset_scissor();
+            sgp_reset_project();
+            sgp_reset_transform();
+            sgp_reset_pipeline();
+            sgp_reset_blend_mode();
+            sgp_reset_color();
+            sgp_set_image(0, _target->frame().color_image());
+            sgp_draw_textured_rect(0, sgp_rect{0.0f, 0.0f, w, h}, src);
+            sgp_reset_image(0);
+            IO2D_SUBMIT_ADD(commands, 1);
+
             sg_pass pass = {};
-            pass.swapchain = sglue_swapchain();
+            if (_present_attachments.id != SG_INVALID_ID)
+                pass.attachments = _present_attachments;
+            else
+                pass.swapchain = sglue_swapchain();
+            pass.action.colors[0].load_action = SG_LOADACTION_DONTCARE;
             sg_begin_pass(&pass);
-            // Dispatch all draw commands to Sokol GFX.
             sgp_flush();
-            // Finish a draw command queue, clearing it.
-            sgp_end();
-            // End render pass.
             sg_end_pass();
-            // Commit Sokol render.
-            sg_commit();
         }
 
-        void begin_path()
+        /**
+         * @brief Record where a cached path was drawn for redraw_target::invalidate()
+         *
+         * The draws of a frame that is not redrawn are not shown, they are not recorded.
+         */
+        void track(const cached_path &p)
         {
-            _path.begin();
+            sgp_rect r;
+            if (_target && _redraw && p.bounds(r, scratch()))
+                p.mark_drawn(_target->frame_id(), mat2x3_transform_rect(sgp_query_state()->transform, r));
         }
 
-        void clear()
+        /**
+         * @brief Upload the textures read by the draws recorded so far, each one is updated once per frame
+         */
+        void upload_textures()
         {
-            sgp_set_color(fill_style.color.r, fill_style.color.g, fill_style.color.b, fill_style.color.a);
-            sgp_clear();
+            if (!_shapes_uploaded && !_arena.shape_texels.empty())
+            {
+                sdf_shapes::get_default().upload(_arena.shape_texels);
+                _shapes_uploaded = true;
+            }
+            image_atlas::get_default().upload();
+            gradient_shader::get_default().upload();
         }
 
-        void line(const sgp_point &pt1, const sgp_point &pt2)
+        /**
+         * @brief Dispatch the sokol_gp commands queued so far, the recorded draws are not submitted
+         *
+         * @param early The command buffer is full, see sgp_usage::flushed()
+         */
+        void flush_commands(bool early = false)
         {
-            auto e = std::make_unique<path_line>(pt1, pt2);
-            _path.add(std::move(e));
+            IO2D_STATS_TIME(flush_ms);
+            upload_textures();
+            begin_pass();
+            sgp_flush();
+            sgp_usage::current().flushed(early);
         }
 
-        void rectangle(const sgp_point &pt1, const sgp_point &pt2)
+        /**
+         * @brief Make room in the sokol_gp buffers for a draw, its commands are flushed when they do not fit
+         *
+         * @return false if the draw must be skipped: its vertices do not fit in the frame, or the
+         *         frame is not redrawn
+         */
+        bool reserve(size_t commands, size_t vertices)
         {
-            auto e = std::make_unique<path_rect>(pt1, pt2);
-            _path.add(std::move(e));
+            if (!redraw_needed())
+                return false;
+            sgp_usage &u = sgp_usage::current();
+            if (!u.fits(vertices))
+                return false;
+            if (u.flush_needed((uint32_t)commands))
+                flush_commands(true);
+            return true;
         }
 
-        void roundrect(const sgp_point &pt1, const sgp_point &pt2, float rx, float ry)
+        /**
+         * @brief Grow the sokol_gp buffers to the high-water marks of the last frames, before the first canvas of a frame
+         */
+        static void begin_usage()
+        {
+            sgp_usage &u = sgp_usage::current();
+            if (u.canvases++ > 0)
+                return;
+
+            sgp_desc desc = sgp_query_desc();
+            if (u.grow)
+            {
+                sgp_desc grown = desc;
+                grown.max_vertices = grown_size(desc.max_vertices, u.peak_vertices + sgp_usage::reserved_vertices, u.max_vertices);
+                grown.max_commands = grown_size(desc.max_commands, u.peak_commands + sgp_usage::reserved_commands, u.max_commands);
+                if (grown.max_vertices != desc.max_vertices || grown.max_commands != desc.max_commands)
+                {
+                    // The io2d pipelines are made with sokol_gfx, only the sokol_gp resources are recreated
+                    sgp_shutdown();
+                    sgp_setup(&grown);
+                    if (sgp_is_valid())
+                    {
+                        desc = grown;
+                        u.resizes++;
+                    }
+                    else
+                    {
+                        // Out of memory, keep the last sizes from now on
+                        sgp_shutdown();
+                        sgp_setup(&desc);
+                        u.max_vertices = desc.max_vertices;
+                        u.max_commands = desc.max_commands;
+                    }
+                }
+            }
+
+            u.vertices = 0;
+            u.commands = 0;
+            u.forced_commands = 0;
+            u.dropped_vertices = 0;
+            u.vertex_capacity = desc.max_vertices;
+            u.command_capacity = desc.max_commands;
+        }
+
+        /**
+         * @brief Record the high-water marks of the frame, sokol_gp errors included
+         */
+        static void end_usage()
         {
-            auto e = std::make_unique<path_roundrect>(pt1, pt2, rx, ry);
-            _path.add(std::move(e));
+            sgp_usage &u = sgp_usage::current();
+            u.flushed();
+            if (--u.canvases > 0)
+                return;
+
+            // A draw not checked by reserve() may still overflow, the buffers are then doubled
+            uint32_t vertices = u.vertices + u.dropped_vertices;
+            sgp_error error = sgp_get_last_error();
+            if (error == SGP_ERROR_VERTICES_FULL || error == SGP_ERROR_VERTICES_OVERFLOW)
+                vertices = std::max(vertices, u.vertex_capacity + 1);
+            if (error == SGP_ERROR_COMMANDS_FULL || error == SGP_ERROR_UNIFORMS_FULL)
+                u.peak_commands = std::max(u.peak_commands, u.command_capacity + 1);
+            u.peak_vertices = std::max(u.peak_vertices, vertices);
+            if (u.dropped_vertices > 0 || error != SGP_NO_ERROR)
+                u.overflowed_frames++;
         }
 
-        void ellipse(const sgp_point &pt1, const sgp_point &pt2, float alpha_start = 0.0f, float alpha_end = M_PI * 2)
+        /**
+         * @brief Get the size of a buffer holding needed elements, doubled at least when it grows
+         *
+         * @param limit Largest size, 0 for none
+         */
+        static uint32_t grown_size(uint32_t size, uint32_t needed, uint32_t limit)
         {
-            auto e = std::make_unique<path_ellipse>(pt1, pt2, alpha_start, alpha_end);
-            _path.add(std::move(e));
+            if (needed <= size || (limit > 0 && size >= limit))
+                return size;
+            uint64_t grown = std::max<uint64_t>(uint64_t(size) * 2, needed);
+            if (limit > 0)
+                grown = std::min<uint64_t>(grown, limit);
+            return (uint32_t)std::min<uint64_t>(grown, std::numeric_limits<uint32_t>::max());
         }
 
-        void move_to(const sgp_point &pt)
+        /**
+         * @brief Begin the render pass of the frame if it is not active yet
+         */
+        void begin_pass()
         {
-            auto e = std::make_unique<sub_path>();
-            e->move_to(pt);
+            if (_pass_open)
+                return;
 
-            _path.add(std::move(e));
+            sg_pass pass = {};
+            if (_attachments.id != SG_INVALID_ID)
+                pass.attachments = _attachments;
+            else
+                pass.swapchain = sglue_swapchain();
+            // Keep the pixels of the last frame outside of the invalidated ones.
+            if (_target && _load)
+                pass.action.colors[0].load_action = SG_LOADACTION_LOAD;
+            // The stencil fill expects the stencil buffer to start at zero.
+            pass.action.stencil.load_action = SG_LOADACTION_CLEAR;
+            pass.action.stencil.clear_value = 0;
+            sg_begin_pass(&pass);
+            _pass_open = true;
         }
 
-        void line_to(const sgp_point &pt)
+        /**
+         * @brief Start a new sub path at default_point if the path does not end with one
+         */
+        void ensure_sub_path(const sgp_point &default_point)
         {
-            get_current_sub_path(pt)->line_to(pt);
+            if (!_path.has_open_sub_path())
+                _path.move_to(default_point);
         }
 
-        void arc_to(const sgp_point &pt1, const sgp_point &pt2, float radius)
+        /**
+         * @brief Save the sokol_gp transform and multiply it by the given matrix
+         */
+        static void push_transform(const sgp_mat2x3 &transform)
         {
-            get_current_sub_path(pt1)->arc_to(pt1, pt2, radius);
+            sgp_push_transform();
+
+            sgp_state *state = sgp_query_state();
+            state->transform = mat2x3_multiply(state->transform, transform);
+            state->mvp = mat2x3_multiply(state->proj, state->transform);
         }
+    };
 
-        void close_path()
+    /**
+     * @brief A cached path of a retained_scene with its transform and styles
+     */
+    class scene_item
+    {
+    public:
+        const cached_path *path = nullptr; // It must outlive the scene, or be removed first
+        sgp_mat2x3 transform = mat2x3_identity();
+        fill_style_s fill_style;
+        stroke_style_s stroke_style;
+        bool filled = true;
+        bool stroked = true;
+    };
+
+    /**
+     * @brief A retained scene of cached paths indexed by a spatial_grid
+     *
+     * Drawing the scene and finding the item under a point only look at the items of the grid
+     * cells involved, so their cost depends on what is visible or under the point, not on the
+     * size of the scene. Items are drawn in the order they were added.
+     */
+    class retained_scene
+    {
+    public:
+        /**
+         * @param cell_size The size of the grid cells in scene units, about the size of a typical item
+         */
+        explicit retained_scene(float cell_size = 64.0f) : _grid(cell_size) {}
+
+        /**
+         * @brief Add an item on top of the others
+         *
+         * @return The item identifier, the identifiers of removed items are reused
+         */
+        uint32_t add(const scene_item &item)
         {
-            get_current_sub_path(sgp_point{0, 0})->close_path();
+            uint32_t id = _grid.insert(item_bounds(item));
+            if (_items.size() <= id)
+            {
+                _items.resize(id + 1);
+                _order.resize(id + 1);
+            }
+            _items[id] = item;
+            _order[id] = _next_order++;
+            return id;
         }
 
-        void stroke()
+        /**
+         * @brief Replace an item, it keeps its place in the drawing order
+         *
+         * Call it too once the cached path of the item was edited, to update its bounds.
+         */
+        void update(uint32_t id, const scene_item &item)
         {
-            _path.stroke(stroke_style);
+            _items[id] = item;
+            _grid.update(id, item_bounds(item));
         }
 
-        void fill()
+        void remove(uint32_t id)
         {
-            _path.fill(fill_style);
+            _grid.remove(id);
+            _items[id] = scene_item();
         }
 
-    public:
-        stroke_style_s stroke_style;
-        fill_style_s fill_style;
+        const scene_item &get(uint32_t id) const
+        {
+            return _items[id];
+        }
 
-    protected:
-        path _path;
+        size_t size() const
+        {
+            return _grid.size();
+        }
 
-    protected:
-        sub_path *get_current_sub_path(const sgp_point &default_point)
+        /**
+         * @brief Get the bounding box, in scene units, of an item with its stroke
+         */
+        const aabb &bounds(uint32_t id) const
+        {
+            return _grid.bounds(id);
+        }
+
+        /**
+         * @brief Call f(id) for every item whose bounding box overlaps a box, in drawing order
+         */
+        template <typename F>
+        void query(const aabb &box, F &&f) const
+        {
+            _found.clear();
+            _grid.query(box, [this](uint32_t id)
+                        { _found.push_back(id); });
+            std::sort(_found.begin(), _found.end(), [this](uint32_t a, uint32_t b)
+                      { return _order[a] < _order[b]; });
+            for (uint32_t id : _found)
+                f(id);
+        }
+
+        /**
+         * @brief Draw the visible items with the canvas, the scene units are the current sokol_gp transform units
+         */
+        void draw(canvas &c) const
+        {
+            fill_style_s fill_style = c.fill_style;
+            stroke_style_s stroke_style = c.stroke_style;
+            size_t drawn = 0;
+            query(c.visible_bounds(), [&](uint32_t id)
+                  {
+                      const scene_item &it = _items[id];
+                      c.fill_style = it.fill_style;
+                      c.stroke_style = it.stroke_style;
+                      if (it.filled && it.stroked)
+                          c.draw(*it.path, it.transform);
+                      else if (it.filled)
+                          c.fill(*it.path, it.transform);
+                      else if (it.stroked)
+                          c.stroke(*it.path, it.transform);
+                      drawn++; });
+            c.fill_style = fill_style;
+            c.stroke_style = stroke_style;
+            // The items outside of the view are culled without reaching the canvas
+            IO2D_STATS_ADD(primitives, size() - drawn);
+            IO2D_STATS_ADD(culled, size() - drawn);
+        }
+
+        /**
+         * @brief Find the topmost item whose fill or stroke contains a point
+         *
+         * @param p The point in scene units
+         * @param id The item found
+         * @return false if no item is under the point
+         */
+        bool hit_test(const sgp_point &p, uint32_t &id) const
         {
-            auto sp = _path.current_sub_path();
+            _found.clear();
+            _grid.query(p, [this](uint32_t i)
+                        { _found.push_back(i); });
+            std::sort(_found.begin(), _found.end(), [this](uint32_t a, uint32_t b)
+                      { return _order[a] > _order[b]; });
 
-            if (!sp)
+            for (uint32_t i : _found)
             {
-                _path.add(std::move(std::make_unique<sub_path>()));
-                sp = _path.current_sub_path();
-                sp->move_to(default_point);
+                const scene_item &it = _items[i];
+                sgp_mat2x3 inverse;
+                if (!mat2x3_invert(it.transform, inverse))
+                    continue;
+
+                sgp_point q = {inverse.v[0][0] * p.x + inverse.v[0][1] * p.y + inverse.v[0][2],
+                               inverse.v[1][0] * p.x + inverse.v[1][1] * p.y + inverse.v[1][2]};
+                if ((it.filled && it.path->contains(q)) || (it.stroked && it.path->stroke_contains(q, it.stroke_style)))
+                {
+                    id = i;
+                    return true;
+                }
             }
+            return false;
+        }
 
-            return sp;
+    protected:
+        static aabb item_bounds(const scene_item &item)
+        {
+            aabb box = item.path->get_path().bounds();
+            if (item.stroked)
+                box = box.grown(item.stroke_style.extent());
+            return box.transformed(item.transform);
         }
+
+    protected:
+        spatial_grid _grid;
+        std::vector<scene_item> _items; // Indexed by the grid identifiers
+        std::vector<uint64_t> _order;   // Drawing order of the items
+        uint64_t _next_order = 0;
+        mutable std::vector<uint32_t> _found;
     };
 }
@@ -0,0 +1,3229 @@
+#pragma once
+
+// Geometry and tessellation part of io2d, it does not depend on sokol_gfx so the tessellation
+// can be built, profiled and benchmarked without a GPU. io2d.h includes it after sokol_gp.h and
+// adds the drawing on top of it.
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <utility>
+#include <cmath>
+#include <numbers>
+#include <limits>
+#include <algorithm>
+#include <unordered_map>
+
+#if !defined(IO2D_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define IO2D_SIMD_SSE2
+#include <emmintrin.h>
+#elif !defined(IO2D_NO_SIMD) && (defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define IO2D_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#ifdef IO2D_STATS
+#include "sokol_time.h"
+#endif
+
+#ifndef SOKOL_GP_INCLUDED
+// Same layout as the sokol_gp types. When both are used sokol_gp.h must be included first.
+typedef struct sgp_rect {
+    float x, y, w, h;
+} sgp_rect;
+
+typedef struct sgp_vec2 {
+    float x, y;
+} sgp_vec2;
+
+typedef sgp_vec2 sgp_point;
+
+typedef struct sgp_line {
+    sgp_point a, b;
+} sgp_line;
+
+typedef struct sgp_triangle {
+    sgp_point a, b, c;
+} sgp_triangle;
+
+typedef struct sgp_mat2x3 {
+    float v[2][3];
+} sgp_mat2x3;
+
+typedef struct sgp_color_ub4 {
+    uint8_t r, g, b, a;
+} sgp_color_ub4;
+#endif
+
+namespace io2d
+{
+
+    class rgba_color
+    {
+    public:
+        using channel_t = float;
+
+        rgba_color() {}
+        rgba_color(channel_t r, channel_t g, channel_t b, channel_t a = 1.0f) : r(r), g(g), b(b), a(a) {}
+        rgba_color(uint32_t argb)
+        {
+            a = ((argb >> 24) & 0xff) / 255.0f;
+            r = ((argb >> 16) & 0xff) / 255.0f;
+            g = ((argb >> 8) & 0xff) / 255.0f;
+            b = (argb & 0xff) / 255.0f;
+        }
+
+        /**
+         * @brief Get the color packed like the constructor argument, 0xAARRGGBB
+         */
+        uint32_t argb() const
+        {
+            auto channel = [](float v)
+            { return (uint32_t)std::clamp(v * 255.0f + 0.5f, 0.0f, 255.0f); };
+            return channel(a) << 24 | channel(r) << 16 | channel(g) << 8 | channel(b);
+        }
+
+        /**
+         * @brief Get the 32-bit color of a sokol_gp vertex, converted like sgp_set_color() does
+         */
+        sgp_color_ub4 ub4() const
+        {
+            auto channel = [](float v)
+            { return (uint8_t)std::clamp(v * 255.0f, 0.0f, 255.0f); };
+            return sgp_color_ub4{channel(r), channel(g), channel(b), channel(a)};
+        }
+
+    public:
+        channel_t r = 0.0f;
+        channel_t g = 0.0f;
+        channel_t b = 0.0f;
+        channel_t a = 1.0f;
+    };
+
+    /**
+     * @brief A color of a gradient at an offset between 0 and 1 (HTML5 addColorStop)
+     */
+    class color_stop
+    {
+    public:
+        float offset = 0.0f;
+        rgba_color color;
+    };
+
+    /**
+     * @brief Linear, radial or conic gradient with color stops, like the HTML5 CanvasGradient
+     *
+     * The geometry is in the units of the drawn path, the gradient follows the transform of the
+     * draw. A style only points to the gradient, it must live until the frame is submitted.
+     */
+    class gradient
+    {
+    public:
+        enum class kind
+        {
+            linear, // Along the line from p0 to p1
+            radial, // Between the circles p0, r0 and p1, r1
+            conic   // Around p0, starting at angle
+        };
+
+        /**
+         * @brief Make a linear gradient (HTML5 createLinearGradient)
+         */
+        static gradient linear(const sgp_point &p0, const sgp_point &p1)
+        {
+            gradient g;
+            g.type = kind::linear;
+            g.p0 = p0;
+            g.p1 = p1;
+            return g;
+        }
+
+        /**
+         * @brief Make a radial gradient (HTML5 createRadialGradient)
+         */
+        static gradient radial(const sgp_point &c0, float r0, const sgp_point &c1, float r1)
+        {
+            gradient g;
+            g.type = kind::radial;
+            g.p0 = c0;
+            g.r0 = r0;
+            g.p1 = c1;
+            g.r1 = r1;
+            return g;
+        }
+
+        /**
+         * @brief Make a conic gradient (HTML5 createConicGradient)
+         *
+         * @param start_angle Angle of offset 0 in radians, the offsets grow clockwise on screen
+         */
+        static gradient conic(float start_angle, const sgp_point &center)
+        {
+            gradient g;
+            g.type = kind::conic;
+            g.angle = start_angle;
+            g.p0 = center;
+            return g;
+        }
+
+        /**
+         * @brief Add a color stop, stops at the same offset are kept in insertion order
+         *
+         * @param offset Offset of the color, clamped between 0 and 1
+         */
+        void add_color_stop(float offset, const rgba_color &color)
+        {
+            offset = std::clamp(offset, 0.0f, 1.0f);
+            auto it = std::upper_bound(stops.begin(), stops.end(), offset,
+                                       [](float o, const color_stop &s)
+                                       { return o < s.offset; });
+            stops.insert(it, color_stop{offset, color});
+        }
+
+        /**
+         * @brief Get the offset of the gradient at a point, before clamping
+         *
+         * @return false if the point is not painted, outside of every circle of a radial gradient
+         */
+        bool offset_at(const sgp_point &p, float &t) const
+        {
+            float dx = p.x - p0.x;
+            float dy = p.y - p0.y;
+            if (type == kind::linear)
+            {
+                float ax = p1.x - p0.x;
+                float ay = p1.y - p0.y;
+                float len2 = ax * ax + ay * ay;
+                if (len2 == 0.0f)
+                    return false;
+                t = (dx * ax + dy * ay) / len2;
+                return true;
+            }
+            if (type == kind::conic)
+            {
+                float a = (std::atan2(dy, dx) - angle) / (2.0f * (float)M_PI);
+                t = a - std::floor(a);
+                return true;
+            }
+
+            // Largest t with |p - c(t)| = r(t) and r(t) >= 0, c and r interpolated between the circles
+            float cx = p1.x - p0.x;
+            float cy = p1.y - p0.y;
+            float dr = r1 - r0;
+            float a = cx * cx + cy * cy - dr * dr;
+            float b = dx * cx + dy * cy + r0 * dr;
+            float c = dx * dx + dy * dy - r0 * r0;
+            if (std::abs(a) < 1e-6f)
+            {
+                if (std::abs(b) < 1e-6f)
+                    return false;
+                t = c / (2.0f * b);
+                return r0 + t * dr >= 0.0f;
+            }
+            float disc = b * b - a * c;
+            if (disc < 0.0f)
+                return false;
+            float s = std::sqrt(disc);
+            float t0 = std::max((b + s) / a, (b - s) / a);
+            float t1 = std::min((b + s) / a, (b - s) / a);
+            t = r0 + t0 * dr >= 0.0f ? t0 : t1;
+            return r0 + t * dr >= 0.0f;
+        }
+
+        /**
+         * @brief Get the color at an offset, the first and last stops extend past the ends
+         */
+        rgba_color color_at(float t) const
+        {
+            if (stops.empty())
+                return rgba_color(0.0f, 0.0f, 0.0f, 0.0f);
+            if (t <= stops.front().offset)
+                return stops.front().color;
+            if (t >= stops.back().offset)
+                return stops.back().color;
+
+            auto it = std::upper_bound(stops.begin(), stops.end(), t,
+                                       [](float o, const color_stop &s)
+                                       { return o < s.offset; });
+            const color_stop &s0 = *(it - 1);
+            const color_stop &s1 = *it;
+            float f = (t - s0.offset) / (s1.offset - s0.offset);
+            return rgba_color(s0.color.r + (s1.color.r - s0.color.r) * f,
+                              s0.color.g + (s1.color.g - s0.color.g) * f,
+                              s0.color.b + (s1.color.b - s0.color.b) * f,
+                              s0.color.a + (s1.color.a - s0.color.a) * f);
+        }
+
+        /**
+         * @brief Get the color at a point, transparent where the gradient paints nothing
+         */
+        rgba_color color_at(const sgp_point &p) const
+        {
+            float t = 0.0f;
+            if (!offset_at(p, t))
+                return rgba_color(0.0f, 0.0f, 0.0f, 0.0f);
+            return color_at(t);
+        }
+
+    public:
+        kind type = kind::linear;
+        sgp_point p0{0.0f, 0.0f}; // Start point, first center or conic center
+        sgp_point p1{0.0f, 0.0f}; // End point or second center
+        float r0 = 0.0f;          // Radius of the first circle
+        float r1 = 0.0f;          // Radius of the second circle
+        float angle = 0.0f;       // Start angle of a conic gradient
+        std::vector<color_stop> stops; // Sorted by offset
+    };
+
+    /**
+     * @brief Shape used where two stroke segments meet (HTML5 lineJoin)
+     */
+    enum class line_join
+    {
+        miter,
+        round,
+        bevel
+    };
+
+    /**
+     * @brief Shape used at the ends of open strokes (HTML5 lineCap)
+     */
+    enum class line_cap
+    {
+        butt,
+        round,
+        square
+    };
+
+    /**
+     * @brief Stroke style for path drawing
+     */
+    class stroke_style_s
+    {
+    public:
+        stroke_style_s() {}
+        stroke_style_s(const rgba_color &color) : color(color) {}
+
+        /**
+         * @brief Set the dash pattern and offset, like setLineDash() and lineDashOffset of the HTML5 canvas
+         *
+         * The pattern alternates dash and gap lengths, an odd pattern is repeated to make it even.
+         * An empty pattern, or one of zeros, draws solid strokes.
+         *
+         * @return false if a length is negative or not finite, or the pattern has more than
+         *         max_dashes lengths once even, the dashes are not changed
+         */
+        bool set_line_dash(const std::vector<float> &pattern, float offset = 0.0f)
+        {
+            size_t count = pattern.size() % 2 ? pattern.size() * 2 : pattern.size();
+            if (count > max_dashes)
+                return false;
+            for (float d : pattern)
+            {
+                if (!std::isfinite(d) || d < 0.0f)
+                    return false;
+            }
+
+            for (size_t i = 0; i < count; i++)
+                dashes[i] = pattern[i % pattern.size()];
+            dash_count = (uint8_t)count;
+            dash_offset = offset;
+            return true;
+        }
+
+        /**
+         * @brief Get the length of one repetition of the dash pattern, 0 for solid strokes
+         */
+        float dash_period() const
+        {
+            float period = 0.0f;
+            for (size_t i = 0; i < dash_count; i++)
+                period += dashes[i];
+            return period;
+        }
+
+        bool dashed() const
+        {
+            return dash_period() > 0.0f;
+        }
+
+        /**
+         * @brief Check if the point at an arc length from the start of a sub path is in a dash
+         */
+        bool dash_on(float s) const
+        {
+            float period = dash_period();
+            if (period <= 0.0f)
+                return true;
+            float phase = std::fmod(s + dash_offset, period);
+            if (phase < 0.0f)
+                phase += period;
+            for (size_t i = 0; i < dash_count; i++)
+            {
+                if (phase < dashes[i])
+                    return i % 2 == 0;
+                phase -= dashes[i];
+            }
+            return false;
+        }
+
+        /**
+         * @brief Check if two styles have the same width, joins and caps, the stroke of an undashed path
+         */
+        bool same_outline(const stroke_style_s &other) const
+        {
+            return width == other.width &&
+                   join == other.join &&
+                   cap == other.cap &&
+                   miter_limit == other.miter_limit;
+        }
+
+        bool same_dashes(const stroke_style_s &other) const
+        {
+            return dash_count == other.dash_count &&
+                   dash_offset == other.dash_offset &&
+                   std::equal(dashes.begin(), dashes.begin() + dash_count, other.dashes.begin());
+        }
+
+        /**
+         * @brief Check if two styles produce the same stroke geometry, that is everything but the paint
+         */
+        bool same_geometry(const stroke_style_s &other) const
+        {
+            return same_outline(other) && same_dashes(other);
+        }
+
+        /**
+         * @brief Get how far the stroke can extend past the outline, joins and caps included
+         */
+        float extent() const
+        {
+            float e = join == line_join::miter ? std::max(miter_limit, (float)M_SQRT2) : (float)M_SQRT2;
+            return std::max(width, 1.0f) * 0.5f * e;
+        }
+
+    public:
+        rgba_color color;
+        float width = 1.0f;
+        line_join join = line_join::miter;
+        line_cap cap = line_cap::butt;
+        float miter_limit = 10.0f;
+        const io2d::gradient *gradient = nullptr; // Paints the stroke instead of color when set
+
+        static constexpr size_t max_dashes = 16;
+        std::array<float, max_dashes> dashes{}; // Dash and gap lengths, see set_line_dash()
+        uint8_t dash_count = 0;                 // Used entries of dashes, always even
+        float dash_offset = 0.0f;               // Distance into the pattern at the start of every sub path
+    };
+
+    /**
+     * @brief Fill style for path drawing
+     */
+    class fill_style_s
+    {
+    public:
+        rgba_color color;
+        const io2d::gradient *gradient = nullptr; // Paints the fill instead of color when set
+    };
+
+    /**
+     * @brief Rule deciding which points are inside a self-intersecting or multi contour path
+     */
+    enum class fill_rule
+    {
+        nonzero, // Inside when the contours wind around the point a non zero number of times
+        evenodd  // Inside when a ray from the point crosses the contours an odd number of times
+    };
+
+    /**
+     * @brief Get the identity 2x3 transformation matrix
+     */
+    inline sgp_mat2x3 mat2x3_identity()
+    {
+        return sgp_mat2x3{{{1.0f, 0.0f, 0.0f},
+                           {0.0f, 1.0f, 0.0f}}};
+    }
+
+    /**
+     * @brief Default maximum distance, in device pixels, between a curve and the segments approximating it
+     */
+    constexpr float default_tessellation_tolerance = 0.25f;
+
+    /**
+     * @brief Get the number of segments approximating an arc within a tolerance
+     *
+     * Each segment spans the angle whose chord is at most tolerance away from the arc:
+     * radius * (1 - cos(step / 2)) <= tolerance.
+     *
+     * @param radius The arc radius
+     * @param sweep The arc angle in radians
+     * @param tolerance The maximum chord error, in the same units as the radius
+     */
+    inline int arc_segment_count(float radius, float sweep, float tolerance)
+    {
+        radius = std::abs(radius);
+        sweep = std::abs(sweep);
+        if (radius <= tolerance || sweep == 0.0f)
+            return 1;
+
+        // Bound the segment count when the tolerance is zero or negligible compared to the radius
+        tolerance = std::max(tolerance, radius * 1e-5f);
+        float step = 2.0f * std::acos(1.0f - tolerance / radius);
+        return std::max(1, (int)std::ceil(sweep / step));
+    }
+
+    /**
+     * @brief Call f(cos, sin) for the segments + 1 angles evenly spaced from alpha_start to alpha_end
+     *
+     * Each point is the previous one rotated by the step angle, so only the step and the two end
+     * points call std::cos and std::sin. The rotation is accumulated in double precision to keep
+     * the drift negligible, and the last point is exact so closed arcs end on their first point.
+     */
+    template <typename F>
+    inline void for_each_arc_angle(float alpha_start, float alpha_end, int segments, F &&f)
+    {
+        double step = ((double)alpha_end - alpha_start) / segments;
+        double step_cos = std::cos(step);
+        double step_sin = std::sin(step);
+        double c = std::cos((double)alpha_start);
+        double s = std::sin((double)alpha_start);
+
+        for (int i = 0; i < segments; i++)
+        {
+            f((float)c, (float)s);
+
+            double next_c = c * step_cos - s * step_sin;
+            s = s * step_cos + c * step_sin;
+            c = next_c;
+        }
+
+        f(std::cos(alpha_end), std::sin(alpha_end));
+    }
+
+    /**
+     * @brief Largest number of segments a Bezier curve is flattened into
+     */
+    constexpr int max_bezier_segments = 1024;
+
+    /**
+     * @brief Get the number of segments approximating a Bezier curve within a tolerance
+     *
+     * Uses Wang's formula: with evenly spaced parameters, the chord error of a curve of degree d
+     * is at most d * (d - 1) / 8 * max|p[i] - 2 p[i+1] + p[i+2]| / segments^2. The count is known
+     * before the first point is computed, so the points can be forward differenced.
+     *
+     * @param points The degree + 1 control points
+     * @param degree 2 for a quadratic curve, 3 for a cubic curve
+     * @param tolerance The maximum chord error, in path units
+     */
+    inline int bezier_segment_count(const sgp_point *points, int degree, float tolerance)
+    {
+        float dd = 0.0f;
+        for (int i = 0; i + 2 <= degree; i++)
+        {
+            float x = points[i].x - 2.0f * points[i + 1].x + points[i + 2].x;
+            float y = points[i].y - 2.0f * points[i + 1].y + points[i + 2].y;
+            dd = std::max(dd, x * x + y * y);
+        }
+
+        float error = degree * (degree - 1) / 8.0f * std::sqrt(dd);
+        if (!(error > tolerance))
+            return 1;
+        if (!(tolerance > 0.0f) || !std::isfinite(error))
+            return max_bezier_segments;
+        return std::min(max_bezier_segments, (int)std::ceil(std::sqrt(error / tolerance)));
+    }
+
+    /**
+     * @brief Call f(point) for the segments points of a quadratic Bezier curve following p0
+     *
+     * The points are forward differenced, 2 additions per point, in double precision to keep the
+     * drift negligible. The last point is exactly p2.
+     */
+    template <typename F>
+    inline void for_each_quadratic_point(const sgp_point &p0, const sgp_point &p1, const sgp_point &p2, int segments, F &&f)
+    {
+        double h = 1.0 / segments;
+        double ax = (double)p0.x - 2.0 * p1.x + p2.x, ay = (double)p0.y - 2.0 * p1.y + p2.y;
+        double bx = 2.0 * ((double)p1.x - p0.x), by = 2.0 * ((double)p1.y - p0.y);
+        double x = p0.x, y = p0.y;
+        double dx = ax * h * h + bx * h, dy = ay * h * h + by * h;
+        double ddx = 2.0 * ax * h * h, ddy = 2.0 * ay * h * h;
+
+        for (int i = 1; i < segments; i++)
+        {
+            x += dx;
+            y += dy;
+            dx += ddx;
+            dy += ddy;
+            f(sgp_point{(float)x, (float)y});
+        }
+
+        f(p2);
+    }
+
+    /**
+     * @brief Call f(point) for the segments points of a cubic Bezier curve following p0
+     *
+     * The points are forward differenced, 3 additions per point, in double precision to keep the
+     * drift negligible. The last point is exactly p3.
+     */
+    template <typename F>
+    inline void for_each_cubic_point(const sgp_point &p0, const sgp_point &p1, const sgp_point &p2, const sgp_point &p3, int segments, F &&f)
+    {
+        double h = 1.0 / segments;
+        double h2 = h * h;
+        double h3 = h2 * h;
+        double ax = -(double)p0.x + 3.0 * p1.x - 3.0 * p2.x + p3.x, ay = -(double)p0.y + 3.0 * p1.y - 3.0 * p2.y + p3.y;
+        double bx = 3.0 * ((double)p0.x - 2.0 * p1.x + p2.x), by = 3.0 * ((double)p0.y - 2.0 * p1.y + p2.y);
+        double cx = 3.0 * ((double)p1.x - p0.x), cy = 3.0 * ((double)p1.y - p0.y);
+        double x = p0.x, y = p0.y;
+        double dx = ax * h3 + bx * h2 + cx * h, dy = ay * h3 + by * h2 + cy * h;
+        double ddx = 6.0 * ax * h3 + 2.0 * bx * h2, ddy = 6.0 * ay * h3 + 2.0 * by * h2;
+        double dddx = 6.0 * ax * h3, dddy = 6.0 * ay * h3;
+
+        for (int i = 1; i < segments; i++)
+        {
+            x += dx;
+            y += dy;
+            dx += ddx;
+            dy += ddy;
+            ddx += dddx;
+            ddy += dddy;
+            f(sgp_point{(float)x, (float)y});
+        }
+
+        f(p3);
+    }
+
+    /**
+     * @brief Multiply two 2x3 matrices as if they were 3x3 affine matrices (a * b)
+     */
+    inline sgp_mat2x3 mat2x3_multiply(const sgp_mat2x3 &a, const sgp_mat2x3 &b)
+    {
+        return sgp_mat2x3{{{a.v[0][0] * b.v[0][0] + a.v[0][1] * b.v[1][0],
+                            a.v[0][0] * b.v[0][1] + a.v[0][1] * b.v[1][1],
+                            a.v[0][0] * b.v[0][2] + a.v[0][1] * b.v[1][2] + a.v[0][2]},
+                           {a.v[1][0] * b.v[0][0] + a.v[1][1] * b.v[1][0],
+                            a.v[1][0] * b.v[0][1] + a.v[1][1] * b.v[1][1],
+                            a.v[1][0] * b.v[0][2] + a.v[1][1] * b.v[1][2] + a.v[1][2]}}};
+    }
+
+    /**
+     * @brief Get the largest scale factor a 2x3 matrix applies to its axes
+     */
+    inline float mat2x3_max_scale(const sgp_mat2x3 &m)
+    {
+        float sx = std::hypot(m.v[0][0], m.v[1][0]);
+        float sy = std::hypot(m.v[0][1], m.v[1][1]);
+        return std::max(sx, sy);
+    }
+
+    /**
+     * @brief Get the smallest rectangle containing both rectangles
+     */
+    inline sgp_rect rect_union(const sgp_rect &a, const sgp_rect &b)
+    {
+        float x0 = std::min(a.x, b.x);
+        float y0 = std::min(a.y, b.y);
+        float x1 = std::max(a.x + a.w, b.x + b.w);
+        float y1 = std::max(a.y + a.h, b.y + b.h);
+        return sgp_rect{x0, y0, x1 - x0, y1 - y0};
+    }
+
+    /**
+     * @brief Get the bounding box of a rectangle transformed by a 2x3 matrix
+     */
+    inline sgp_rect mat2x3_transform_rect(const sgp_mat2x3 &m, const sgp_rect &r)
+    {
+        float x0 = std::numeric_limits<float>::max();
+        float y0 = std::numeric_limits<float>::max();
+        float x1 = std::numeric_limits<float>::lowest();
+        float y1 = std::numeric_limits<float>::lowest();
+        const sgp_point corners[4] = {{r.x, r.y}, {r.x + r.w, r.y}, {r.x + r.w, r.y + r.h}, {r.x, r.y + r.h}};
+        for (const sgp_point &c : corners)
+        {
+            float x = m.v[0][0] * c.x + m.v[0][1] * c.y + m.v[0][2];
+            float y = m.v[1][0] * c.x + m.v[1][1] * c.y + m.v[1][2];
+            x0 = std::min(x0, x);
+            y0 = std::min(y0, y);
+            x1 = std::max(x1, x);
+            y1 = std::max(y1, y);
+        }
+        return sgp_rect{x0, y0, x1 - x0, y1 - y0};
+    }
+
+    /**
+     * @brief Invert a 2x3 matrix as if it was a 3x3 affine matrix
+     *
+     * @return false if the matrix is singular, out is unchanged
+     */
+    inline bool mat2x3_invert(const sgp_mat2x3 &m, sgp_mat2x3 &out)
+    {
+        float det = m.v[0][0] * m.v[1][1] - m.v[0][1] * m.v[1][0];
+        if (det == 0.0f || !std::isfinite(det))
+            return false;
+
+        float inv = 1.0f / det;
+        float a = m.v[1][1] * inv;
+        float b = -m.v[0][1] * inv;
+        float c = -m.v[1][0] * inv;
+        float d = m.v[0][0] * inv;
+        out = sgp_mat2x3{{{a, b, -(a * m.v[0][2] + b * m.v[1][2])},
+                          {c, d, -(c * m.v[0][2] + d * m.v[1][2])}}};
+        return true;
+    }
+
+    /**
+     * @brief Axis aligned bounding box stored as its min and max corners, empty until a point is added
+     */
+    class aabb
+    {
+    public:
+        aabb() {}
+        aabb(float x0, float y0, float x1, float y1) : x0(x0), y0(y0), x1(x1), y1(y1) {}
+
+        void add(const sgp_point &p)
+        {
+            x0 = std::min(x0, p.x);
+            y0 = std::min(y0, p.y);
+            x1 = std::max(x1, p.x);
+            y1 = std::max(y1, p.y);
+        }
+
+        void add(const aabb &b)
+        {
+            x0 = std::min(x0, b.x0);
+            y0 = std::min(y0, b.y0);
+            x1 = std::max(x1, b.x1);
+            y1 = std::max(y1, b.y1);
+        }
+
+        /**
+         * @brief Check if no point was added, a single point is not empty
+         */
+        bool empty() const
+        {
+            return x0 > x1 || y0 > y1;
+        }
+
+        /**
+         * @brief Check if the boxes overlap, touching edges included
+         */
+        bool intersects(const aabb &b) const
+        {
+            return x0 <= b.x1 && b.x0 <= x1 && y0 <= b.y1 && b.y0 <= y1;
+        }
+
+        bool contains(const sgp_point &p) const
+        {
+            return p.x >= x0 && p.x <= x1 && p.y >= y0 && p.y <= y1;
+        }
+
+        aabb grown(float d) const
+        {
+            return empty() ? *this : aabb(x0 - d, y0 - d, x1 + d, y1 + d);
+        }
+
+        /**
+         * @brief Get the overlap of the boxes, empty if they do not overlap
+         */
+        aabb intersected(const aabb &b) const
+        {
+            aabb r(std::max(x0, b.x0), std::max(y0, b.y0), std::min(x1, b.x1), std::min(y1, b.y1));
+            return r.empty() ? aabb() : r;
+        }
+
+        /**
+         * @brief Get the bounding box of the box transformed by a 2x3 matrix
+         */
+        aabb transformed(const sgp_mat2x3 &m) const
+        {
+            if (empty())
+                return *this;
+
+            aabb r;
+            const sgp_point corners[4] = {{x0, y0}, {x1, y0}, {x1, y1}, {x0, y1}};
+            for (const sgp_point &c : corners)
+                r.add(sgp_point{m.v[0][0] * c.x + m.v[0][1] * c.y + m.v[0][2],
+                                m.v[1][0] * c.x + m.v[1][1] * c.y + m.v[1][2]});
+            return r;
+        }
+
+        sgp_rect rect() const
+        {
+            return sgp_rect{x0, y0, x1 - x0, y1 - y0};
+        }
+
+    public:
+        float x0 = std::numeric_limits<float>::max();
+        float y0 = std::numeric_limits<float>::max();
+        float x1 = std::numeric_limits<float>::lowest();
+        float y1 = std::numeric_limits<float>::lowest();
+    };
+
+    /**
+     * @brief Sparse uniform grid of bounding boxes, finds the boxes overlapping a box or a point
+     *
+     * Each box is listed in the cells it overlaps. Cells are created on demand in a hash map, so
+     * the grid has no fixed extent, and a query visits only the cells it overlaps: its cost
+     * depends on the boxes found, not on the number of boxes in the grid. Boxes overlapping
+     * more than max_item_cells cells are kept in a list tested by every query. Boxes are added,
+     * moved and removed in time proportional to the cells they overlap. Queries are not thread
+     * safe, they mark the boxes already found.
+     */
+    class spatial_grid
+    {
+    public:
+        /**
+         * @param cell_size The width and height of the cells, about the size of a typical box
+         */
+        explicit spatial_grid(float cell_size = 64.0f) : _inv_cell_size(1.0f / cell_size) {}
+
+        /**
+         * @brief Add a box
+         *
+         * @return The box identifier, the identifiers of removed boxes are reused
+         */
+        uint32_t insert(const aabb &box)
+        {
+            uint32_t id;
+            if (!_free.empty())
+            {
+                id = _free.back();
+                _free.pop_back();
+            }
+            else
+            {
+                id = (uint32_t)_items.size();
+                _items.emplace_back();
+            }
+
+            _items[id] = item{box};
+            link(id);
+            _count++;
+            return id;
+        }
+
+        void update(uint32_t id, const aabb &box)
+        {
+            unlink(id);
+            _items[id].box = box;
+            link(id);
+        }
+
+        void remove(uint32_t id)
+        {
+            unlink(id);
+            _items[id].box = aabb();
+            _free.push_back(id);
+            _count--;
+        }
+
+        void clear()
+        {
+            _cells.clear();
+            _items.clear();
+            _free.clear();
+            _large.clear();
+            _count = 0;
+        }
+
+        const aabb &bounds(uint32_t id) const
+        {
+            return _items[id].box;
+        }
+
+        size_t size() const
+        {
+            return _count;
+        }
+
+        /**
+         * @brief Call f(id) once for every box overlapping the given box, in no particular order
+         */
+        template <typename F>
+        void query(const aabb &box, F &&f) const
+        {
+            if (box.empty())
+                return;
+
+            uint32_t stamp = next_stamp();
+            auto visit = [&](const std::vector<uint32_t> &ids)
+            {
+                for (uint32_t id : ids)
+                {
+                    const item &it = _items[id];
+                    if (it.stamp != stamp && it.box.intersects(box))
+                    {
+                        it.stamp = stamp;
+                        f(id);
+                    }
+                }
+            };
+
+            int cx0, cy0, cx1, cy1;
+            cell_range(box, cx0, cy0, cx1, cy1);
+            if ((int64_t)(cx1 - cx0 + 1) * (cy1 - cy0 + 1) > (int64_t)_cells.size())
+            {
+                // The box spans more cells than the grid has, visiting the map is cheaper
+                for (const auto &c : _cells)
+                    visit(c.second);
+            }
+            else
+            {
+                for (int cy = cy0; cy <= cy1; cy++)
+                {
+                    for (int cx = cx0; cx <= cx1; cx++)
+                    {
+                        auto c = _cells.find(key(cx, cy));
+                        if (c != _cells.end())
+                            visit(c->second);
+                    }
+                }
+            }
+            visit(_large);
+        }
+
+        /**
+         * @brief Call f(id) once for every box containing the point, in no particular order
+         */
+        template <typename F>
+        void query(const sgp_point &p, F &&f) const
+        {
+            query(aabb(p.x, p.y, p.x, p.y), f);
+        }
+
+    public:
+        static constexpr int64_t max_item_cells = 256; // Larger boxes are tested by every query
+
+    protected:
+        class item
+        {
+        public:
+            aabb box;
+            mutable uint32_t stamp = 0; // Last query that found the box
+            bool large = false;
+        };
+
+        static uint64_t key(int cx, int cy)
+        {
+            return ((uint64_t)(uint32_t)cx << 32) | (uint32_t)cy;
+        }
+
+        int cell_of(float v) const
+        {
+            // Clamped so that far away or non finite coordinates still map to a cell
+            float c = std::floor(v * _inv_cell_size);
+            return c >= -1e9f && c <= 1e9f ? (int)c : (c > 0.0f ? 1000000000 : -1000000000);
+        }
+
+        void cell_range(const aabb &box, int &cx0, int &cy0, int &cx1, int &cy1) const
+        {
+            cx0 = cell_of(box.x0);
+            cy0 = cell_of(box.y0);
+            cx1 = cell_of(box.x1);
+            cy1 = cell_of(box.y1);
+        }
+
+        void link(uint32_t id)
+        {
+            item &it = _items[id];
+            it.large = false;
+            if (it.box.empty())
+                return;
+
+            int cx0, cy0, cx1, cy1;
+            cell_range(it.box, cx0, cy0, cx1, cy1);
+            if ((int64_t)(cx1 - cx0 + 1) * (cy1 - cy0 + 1) > max_item_cells)
+            {
+                it.large = true;
+                _large.push_back(id);
+                return;
+            }
+
+            for (int cy = cy0; cy <= cy1; cy++)
+                for (int cx = cx0; cx <= cx1; cx++)
+                    _cells[key(cx, cy)].push_back(id);
+        }
+
+        void unlink(uint32_t id)
+        {
+            const item &it = _items[id];
+            if (it.box.empty())
+                return;
+
+            auto erase = [id](std::vector<uint32_t> &ids)
+            {
+                auto i = std::find(ids.begin(), ids.end(), id);
+                if (i == ids.end())
+                    return;
+                *i = ids.back();
+                ids.pop_back();
+            };
+
+            if (it.large)
+            {
+                erase(_large);
+                return;
+            }
+
+            int cx0, cy0, cx1, cy1;
+            cell_range(it.box, cx0, cy0, cx1, cy1);
+            for (int cy = cy0; cy <= cy1; cy++)
+            {
+                for (int cx = cx0; cx <= cx1; cx++)
+                {
+                    auto c = _cells.find(key(cx, cy));
+                    if (c == _cells.end())
+                        continue;
+                    erase(c->second);
+                    if (c->second.empty())
+                        _cells.erase(c);
+                }
+            }
+        }
+
+        uint32_t next_stamp() const
+        {
+            if (++_stamp == 0)
+            {
+                for (const item &it : _items)
+                    it.stamp = 0;
+                _stamp = 1;
+            }
+            return _stamp;
+        }
+
+    protected:
+        float _inv_cell_size;
+        std::unordered_map<uint64_t, std::vector<uint32_t>> _cells;
+        std::vector<item> _items;
+        std::vector<uint32_t> _free;
+        std::vector<uint32_t> _large;
+        size_t _count = 0;
+        mutable uint32_t _stamp = 0;
+    };
+
+    /**
+     * @brief Batch kernels for the geometry inner loops
+     *
+     * The kernels work on contiguous arrays of sgp_point. SSE2 and NEON versions are selected
+     * at compile time, the scalar loops handle the remaining elements and the other targets.
+     * Define IO2D_NO_SIMD to use the scalar versions only.
+     */
+    class simd
+    {
+    public:
+        /**
+         * @brief Compute the unit direction and the length of count segments
+         *
+         * Segment i goes from points[i] to points[i + 1], so points must have count + 1 elements.
+         * Segments must not have zero length.
+         *
+         * @param points The polyline points
+         * @param count The number of segments
+         * @param directions Receives count unit directions
+         * @param lengths Receives count lengths
+         */
+        static void segment_directions(const sgp_point *points, size_t count, sgp_point *directions, float *lengths)
+        {
+            size_t i = 0;
+#if defined(IO2D_SIMD_SSE2)
+            for (; i + 4 <= count; i += 4)
+            {
+                const float *p = &points[i].x;
+                __m128 a0 = _mm_loadu_ps(p);
+                __m128 a1 = _mm_loadu_ps(p + 4);
+                __m128 b0 = _mm_loadu_ps(p + 2);
+                __m128 b1 = _mm_loadu_ps(p + 6);
+
+                // De-interleave 4 segment starts and ends into x and y lanes
+                __m128 ax = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 ay = _mm_shuffle_ps(a0, a1, _MM_SHUFFLE(3, 1, 3, 1));
+                __m128 bx = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(2, 0, 2, 0));
+                __m128 by = _mm_shuffle_ps(b0, b1, _MM_SHUFFLE(3, 1, 3, 1));
+
+                __m128 dx = _mm_sub_ps(bx, ax);
+                __m128 dy = _mm_sub_ps(by, ay);
+                __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+                dx = _mm_div_ps(dx, len);
+                dy = _mm_div_ps(dy, len);
+
+                _mm_storeu_ps(lengths + i, len);
+                _mm_storeu_ps(&directions[i].x, _mm_unpacklo_ps(dx, dy));
+                _mm_storeu_ps(&directions[i + 2].x, _mm_unpackhi_ps(dx, dy));
+            }
+#elif defined(IO2D_SIMD_NEON)
+            for (; i + 4 <= count; i += 4)
+            {
+                float32x4x2_t a = vld2q_f32(&points[i].x);
+                float32x4x2_t b = vld2q_f32(&points[i + 1].x);
+
+                float32x4_t dx = vsubq_f32(b.val[0], a.val[0]);
+                float32x4_t dy = vsubq_f32(b.val[1], a.val[1]);
+                float32x4_t len2 = vmlaq_f32(vmulq_f32(dx, dx), dy, dy);
+
+                // Reciprocal square root estimate refined with 2 Newton-Raphson steps
+                float32x4_t inv = vrsqrteq_f32(len2);
+                inv = vmulq_f32(inv, vrsqrtsq_f32(vmulq_f32(len2, inv), inv));
+                inv = vmulq_f32(inv, vrsqrtsq_f32(vmulq_f32(len2, inv), inv));
+
+                float32x4x2_t d;
+                d.val[0] = vmulq_f32(dx, inv);
+                d.val[1] = vmulq_f32(dy, inv);
+                vst2q_f32(&directions[i].x, d);
+                vst1q_f32(lengths + i, vmulq_f32(len2, inv));
+            }
+#endif
+            for (; i < count; i++)
+            {
+                float dx = points[i + 1].x - points[i].x;
+                float dy = points[i + 1].y - points[i].y;
+                float len = std::sqrt(dx * dx + dy * dy);
+                directions[i] = sgp_point{dx / len, dy / len};
+                lengths[i] = len;
+            }
+        }
+
+        /**
+         * @brief Apply the affine transformation m to count points, in and out may be the same array
+         *
+         * Each output point is (m[0] * x + m[1] * y + m[2], m[3] * x + m[4] * y + m[5]). With the
+         * cos and sin of a unit circle as input this evaluates the points of an ellipse.
+         */
+        static void affine_points(const sgp_point *in, size_t count, const float m[6], sgp_point *out)
+        {
+            size_t i = 0;
+#if defined(IO2D_SIMD_SSE2)
+            // 2 points per register: x0 y0 x1 y1
+            __m128 mx = _mm_setr_ps(m[0], m[3], m[0], m[3]);
+            __m128 my = _mm_setr_ps(m[1], m[4], m[1], m[4]);
+            __m128 mt = _mm_setr_ps(m[2], m[5], m[2], m[5]);
+            for (; i + 2 <= count; i += 2)
+            {
+                __m128 v = _mm_loadu_ps(&in[i].x);
+                __m128 xx = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 0, 0));
+                __m128 yy = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 1, 1));
+                __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xx, mx), _mm_mul_ps(yy, my)), mt);
+                _mm_storeu_ps(&out[i].x, r);
+            }
+#elif defined(IO2D_SIMD_NEON)
+            for (; i + 4 <= count; i += 4)
+            {
+                float32x4x2_t v = vld2q_f32(&in[i].x);
+                float32x4x2_t r;
+                r.val[0] = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(m[2]), v.val[0], m[0]), v.val[1], m[1]);
+                r.val[1] = vmlaq_n_f32(vmlaq_n_f32(vdupq_n_f32(m[5]), v.val[0], m[3]), v.val[1], m[4]);
+                vst2q_f32(&out[i].x, r);
+            }
+#endif
+            for (; i < count; i++)
+            {
+                float x = in[i].x;
+                float y = in[i].y;
+                out[i] = sgp_point{m[0] * x + m[1] * y + m[2], m[3] * x + m[4] * y + m[5]};
+            }
+        }
+    };
+
+    /**
+     * @brief Append triangles to a vector through a cursor kept in registers
+     *
+     * vector::emplace_back stores the new end back to memory after every element, which makes
+     * each write depend on the previous one. The cursor writes straight into the vector storage,
+     * grows it in large steps and trims the unused tail when it is destroyed.
+     */
+    class triangle_writer
+    {
+    public:
+        /**
+         * @param out The vector the triangles are appended to
+         * @param expected The number of triangles that will probably be written
+         */
+        triangle_writer(std::vector<sgp_triangle> &out, size_t expected) : _out(out)
+        {
+            size_t used = _out.size();
+            _out.resize(used + expected);
+            _cur = _out.data() + used;
+            _end = _out.data() + _out.size();
+        }
+
+        ~triangle_writer()
+        {
+            _out.resize(_cur - _out.data());
+        }
+
+        triangle_writer(const triangle_writer &) = delete;
+        triangle_writer &operator=(const triangle_writer &) = delete;
+
+        void emplace_back(const sgp_triangle &t)
+        {
+            if (_cur == _end)
+                grow();
+            *_cur++ = t;
+        }
+
+        /**
+         * @brief Get the number of triangles in the output vector, the ones written included
+         */
+        size_t size() const
+        {
+            return _cur - _out.data();
+        }
+
+        /**
+         * @brief Append a quad as 2 triangles 0-1-3 and 1-3-2
+         */
+        void add_quad(const sgp_point &p0, const sgp_point &p1, const sgp_point &p2, const sgp_point &p3)
+        {
+            if (_end - _cur < 2)
+                grow();
+            _cur[0] = sgp_triangle{p0, p1, p3};
+            _cur[1] = sgp_triangle{p1, p3, p2};
+            _cur += 2;
+        }
+
+    protected:
+        void grow()
+        {
+            size_t used = _cur - _out.data();
+            _out.resize(used * 2 + min_growth);
+            _cur = _out.data() + used;
+            _end = _out.data() + _out.size();
+        }
+
+    protected:
+        static constexpr size_t min_growth = 64;
+
+        std::vector<sgp_triangle> &_out;
+        sgp_triangle *_cur;
+        sgp_triangle *_end;
+    };
+
+    /**
+     * @brief Counters and timings of one frame
+     *
+     * Only collected when IO2D_STATS is defined before including io2d.h, otherwise the
+     * instrumentation compiles to nothing. See canvas::stats().
+     */
+    class frame_stats
+    {
+    public:
+        uint32_t primitives = 0;      // Path elements stroked or filled
+        uint32_t vertices = 0;        // Vertices submitted to sokol_gp
+        uint32_t static_vertices = 0; // Vertices drawn from static_geometry buffers, not uploaded
+        uint32_t commands = 0;        // sokol_gp draw commands issued
+        uint32_t gpu_draws = 0;       // sg_draw calls left after the sokol_gp batch optimizer
+        uint32_t merged_commands = 0; // Draw commands merged by the batch optimizer
+        double tessellate_ms = 0.0;   // CPU time spent tessellating
+        double flush_ms = 0.0;        // CPU time spent in sgp_flush, sgp_end and sg_commit
+        double frame_ms = 0.0;        // CPU time from the canvas creation to the commit
+        uint32_t culled = 0;          // Path elements and shapes skipped because they are not visible
+
+        /**
+         * @brief Get the statistics of the frame being recorded on the calling thread
+         */
+        static frame_stats &current()
+        {
+            thread_local frame_stats s;
+            return s;
+        }
+    };
+
+    /**
+     * @brief Use of the sokol_gp vertex and command buffers, counted even without IO2D_STATS
+     *
+     * sokol_gp discards the whole frame when a draw does not fit in the buffers sized by
+     * sgp_setup(). The canvas checks these counts before its draws: the commands are flushed
+     * when they run out, a draw whose vertices do not fit is skipped, and the buffers are grown
+     * between frames to hold the high-water marks. A flush does not free vertices, every flush
+     * of a frame is appended to the same sokol_gp vertex buffer.
+     */
+    class sgp_usage
+    {
+    public:
+        uint32_t vertices = 0;          // Vertices submitted since the frame began
+        uint32_t commands = 0;          // Commands submitted since the last flush, sokol_gp merges some of them
+        uint32_t forced_commands = 0;   // Commands flushed early since the last flush() because the buffer was full
+        uint32_t dropped_vertices = 0;  // Vertices of the draws skipped in the frame because they did not fit
+        uint32_t vertex_capacity = 0;   // max_vertices of the sokol_gp buffers used by the frame
+        uint32_t command_capacity = 0;  // max_commands of the sokol_gp buffers used by the frame
+
+        uint32_t peak_vertices = 0;     // Most vertices a frame needed, the dropped ones included
+        uint32_t peak_commands = 0;     // Most commands submitted between two flushes, not counting the early flushes of a full buffer
+        uint32_t overflowed_frames = 0; // Frames with draws skipped or discarded by sokol_gp
+        uint32_t resizes = 0;           // Times the buffers were grown
+        uint32_t canvases = 0;          // Live canvases, the frame begins with the first one
+
+        bool grow = true;               // Grow the buffers between frames, false keeps the sgp_setup() sizes
+        uint32_t max_vertices = 0;      // Limit of the vertex buffer growth, 0 for none
+        uint32_t max_commands = 0;      // Limit of the command buffer growth, 0 for none
+
+        /**
+         * @brief Check if a draw fits in the vertices left, counting it as dropped otherwise
+         */
+        bool fits(size_t vertex_count)
+        {
+            if (vertices + vertex_count + reserved_vertices <= vertex_capacity)
+                return true;
+            dropped_vertices += (uint32_t)vertex_count;
+            return false;
+        }
+
+        /**
+         * @brief Check if the commands left must be flushed before a draw
+         */
+        bool flush_needed(uint32_t command_count) const
+        {
+            return commands + command_count + reserved_commands > command_capacity;
+        }
+
+        /**
+         * @brief Record the commands as flushed
+         *
+         * @param early The flush only made room in the full buffer, the next one counts the commands
+         */
+        void flushed(bool early = false)
+        {
+            if (early)
+            {
+                forced_commands += commands;
+            }
+            else
+            {
+                peak_commands = std::max(peak_commands, forced_commands + commands);
+                forced_commands = 0;
+            }
+            commands = 0;
+        }
+
+        /**
+         * @brief Get the usage of the sokol_gp buffers on the calling thread
+         */
+        static sgp_usage &current()
+        {
+            thread_local sgp_usage u;
+            return u;
+        }
+
+        // Left for the draws that are not checked: clears, viewports and the redraw target copy
+        static constexpr uint32_t reserved_vertices = 64;
+        static constexpr uint32_t reserved_commands = 16;
+    };
+
+#ifdef IO2D_STATS
+    /**
+     * @brief Add the time elapsed during its lifetime to a frame_stats field, in milliseconds
+     */
+    class stats_timer
+    {
+    public:
+        explicit stats_timer(double &ms) : _ms(ms), _start(now()) {}
+        ~stats_timer() { _ms += stm_ms(stm_since(_start)); }
+
+        stats_timer(const stats_timer &) = delete;
+        stats_timer &operator=(const stats_timer &) = delete;
+
+        static uint64_t now()
+        {
+            static const bool ready = (stm_setup(), true);
+            (void)ready;
+            return stm_now();
+        }
+
+    protected:
+        double &_ms;
+        uint64_t _start;
+    };
+
+#define IO2D_STATS_ADD(field, value) (::io2d::frame_stats::current().field += (value))
+#define IO2D_STATS_TIME(field) ::io2d::stats_timer io2d_stats_timer_##field(::io2d::frame_stats::current().field)
+#else
+#define IO2D_STATS_ADD(field, value) ((void)0)
+#define IO2D_STATS_TIME(field) ((void)0)
+#endif
+
+// Count vertices or commands submitted to sokol_gp in sgp_usage, and in frame_stats with IO2D_STATS
+#define IO2D_SUBMIT_ADD(field, value) (::io2d::sgp_usage::current().field += (value), IO2D_STATS_ADD(field, value))
+
+    /**
+     * @brief Tessellated geometry ready to be submitted to sokol_gp
+     *
+     * Thick strokes and fills are stored as triangles, 1 pixel strokes as lines.
+     * The color is not part of the geometry so the same vertices can be drawn with any style.
+     */
+    class geometry
+    {
+    public:
+        void clear()
+        {
+            triangles.clear();
+            lines.clear();
+            triangle_distances.clear();
+            line_distances.clear();
+        }
+
+        bool empty() const
+        {
+            return triangles.empty() && lines.empty();
+        }
+
+        /**
+         * @brief Get the number of vertices submitted by draw()
+         */
+        size_t vertex_count() const
+        {
+            return triangles.size() * 3 + lines.size() * 2;
+        }
+
+        /**
+         * @brief Add a quad as 2 triangles 0-1-3 and 1-3-2 (see path_line::get_thick_line_points)
+         */
+        void add_quad(const sgp_point &p0, const sgp_point &p1, const sgp_point &p2, const sgp_point &p3)
+        {
+            triangles.emplace_back(sgp_triangle{p0, p1, p3});
+            triangles.emplace_back(sgp_triangle{p1, p3, p2});
+        }
+
+        /**
+         * @brief Add the segments of a line strip
+         */
+        void add_lines_strip(const sgp_point *points, size_t count)
+        {
+            for (size_t i = 1; i < count; i++)
+            {
+                lines.emplace_back(sgp_line{points[i - 1], points[i]});
+            }
+        }
+
+        /**
+         * @brief Get the bounding box of the triangles and lines
+         *
+         * @return false if the geometry is empty
+         */
+        bool bounds(sgp_rect &out) const
+        {
+            if (empty())
+                return false;
+
+            float x0 = std::numeric_limits<float>::max();
+            float y0 = std::numeric_limits<float>::max();
+            float x1 = std::numeric_limits<float>::lowest();
+            float y1 = std::numeric_limits<float>::lowest();
+            auto add = [&](const sgp_point &p)
+            {
+                x0 = std::min(x0, p.x);
+                y0 = std::min(y0, p.y);
+                x1 = std::max(x1, p.x);
+                y1 = std::max(y1, p.y);
+            };
+            for (const sgp_triangle &t : triangles)
+            {
+                add(t.a);
+                add(t.b);
+                add(t.c);
+            }
+            for (const sgp_line &l : lines)
+            {
+                add(l.a);
+                add(l.b);
+            }
+            out = sgp_rect{x0, y0, x1 - x0, y1 - y0};
+            return true;
+        }
+
+#ifdef SOKOL_GP_INCLUDED
+        /**
+         * @brief Submit the geometry to sokol_gp using the given color
+         */
+        void draw(const rgba_color &color) const
+        {
+            draw_triangles(color);
+            draw_lines(color);
+        }
+
+        /**
+         * @brief Submit only the triangles, every sokol_gp triangle draw shares one pipeline per blend mode
+         */
+        void draw_triangles(const rgba_color &color) const
+        {
+            if (triangles.empty())
+                return;
+
+            sgp_set_color(color.r, color.g, color.b, color.a);
+            sgp_draw_filled_triangles(triangles.data(), triangles.size());
+            IO2D_SUBMIT_ADD(commands, 1);
+            IO2D_SUBMIT_ADD(vertices, triangles.size() * 3);
+        }
+
+        /**
+         * @brief Submit only the lines
+         */
+        void draw_lines(const rgba_color &color) const
+        {
+            if (lines.empty())
+                return;
+
+            sgp_set_color(color.r, color.g, color.b, color.a);
+            sgp_draw_lines(lines.data(), lines.size());
+            IO2D_SUBMIT_ADD(commands, 1);
+            IO2D_SUBMIT_ADD(vertices, lines.size() * 2);
+        }
+
+        /**
+         * @brief Submit the geometry painted with a gradient, or with color when paint is null
+         *
+         * Defined in io2d.h, the gradients are drawn by its gradient_shader.
+         */
+        void draw(const rgba_color &color, const gradient *paint) const;
+        void draw_triangles(const rgba_color &color, const gradient *paint) const;
+        void draw_lines(const rgba_color &color, const gradient *paint) const;
+#endif
+
+    public:
+        std::vector<sgp_triangle> triangles;
+        std::vector<sgp_line> lines;
+        std::vector<float> triangle_distances; // Arc length at every triangle vertex, see tessellator::dash_distances
+        std::vector<float> line_distances;     // Arc length at every line end
+    };
+
+    /**
+     * @brief Ear clipping triangulator for simple polygons
+     *
+     * The polygon is kept in a doubly linked list so clipping an ear is O(1), and only the
+     * reflex vertices, the only ones that can lie inside an ear, are tested. They are stored in
+     * a uniform grid so each ear test looks at the few vertices near the ear instead of the whole
+     * polygon. Both windings are accepted. The containers are reused between calls.
+     */
+    class ear_clipper
+    {
+    public:
+        /**
+         * @brief Triangulate a simple polygon, appending the triangles to out
+         *
+         * @param polygon The polygon points, the last point may repeat the first one
+         * @param count The number of points
+         * @param out The triangles are appended here
+         * @return false if no ear could be found, e.g. for self intersecting polygons, in that case
+         *         nothing is appended
+         */
+        bool triangulate(const sgp_point *polygon, size_t count, std::vector<sgp_triangle> &out)
+        {
+            if (count > 1 && polygon[0].x == polygon[count - 1].x && polygon[0].y == polygon[count - 1].y)
+                count--;
+            if (count < 3)
+                return true;
+
+            int n = static_cast<int>(count);
+            size_t first_triangle = out.size();
+
+            // Shoelace formula, the sign gives the winding
+            double area = 0.0;
+            for (int i = 0; i < n; i++)
+            {
+                const sgp_point &a = polygon[i];
+                const sgp_point &b = polygon[(i + 1) % n];
+                area += (double)a.x * b.y - (double)b.x * a.y;
+            }
+            _winding = area >= 0.0 ? 1.0f : -1.0f;
+
+            _prev.resize(n);
+            _next.resize(n);
+            _reflex.resize(n);
+            for (int i = 0; i < n; i++)
+            {
+                _prev[i] = (i + n - 1) % n;
+                _next[i] = (i + 1) % n;
+            }
+            for (int i = 0; i < n; i++)
+            {
+                _reflex[i] = turn(polygon, _prev[i], i, _next[i]) < 0.0f;
+            }
+
+            build_grid(polygon, n);
+
+            int remaining = n;
+            int ear = 0;
+            int stop = ear;
+
+            while (remaining > 3)
+            {
+                int p = _prev[ear];
+                int nx = _next[ear];
+
+                if (is_ear(polygon, p, ear, nx))
+                {
+                    if (turn(polygon, p, ear, nx) != 0.0f)
+                        out.emplace_back(sgp_triangle{polygon[p], polygon[ear], polygon[nx]});
+
+                    // Unlink the ear, its neighbours can only become more convex
+                    _next[p] = nx;
+                    _prev[nx] = p;
+                    _reflex[ear] = false;
+                    remaining--;
+
+                    if (_reflex[p] && turn(polygon, _prev[p], p, nx) >= 0.0f)
+                        _reflex[p] = false;
+                    if (_reflex[nx] && turn(polygon, p, nx, _next[nx]) >= 0.0f)
+                        _reflex[nx] = false;
+
+                    ear = nx;
+                    stop = ear;
+                    continue;
+                }
+
+                ear = nx;
+                if (ear == stop)
+                {
+                    out.resize(first_triangle);
+                    return false;
+                }
+            }
+
+            int p = _prev[ear];
+            int nx = _next[ear];
+            if (turn(polygon, p, ear, nx) != 0.0f)
+                out.emplace_back(sgp_triangle{polygon[p], polygon[ear], polygon[nx]});
+
+            return true;
+        }
+
+    protected:
+        /**
+         * @brief Cross product of a-b-c multiplied by the winding, positive for convex vertices
+         */
+        float turn(const sgp_point *polygon, int a, int b, int c) const
+        {
+            const sgp_point &pa = polygon[a];
+            const sgp_point &pb = polygon[b];
+            const sgp_point &pc = polygon[c];
+
+            return _winding * ((pb.x - pa.x) * (pc.y - pa.y) - (pb.y - pa.y) * (pc.x - pa.x));
+        }
+
+        static float cross(const sgp_point &a, const sgp_point &b, const sgp_point &c)
+        {
+            return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        }
+
+        static bool point_in_triangle(const sgp_point &p, const sgp_point &a, const sgp_point &b, const sgp_point &c)
+        {
+            float d1 = cross(a, b, p);
+            float d2 = cross(b, c, p);
+            float d3 = cross(c, a, p);
+            bool has_neg = (d1 < 0) || (d2 < 0) || (d3 < 0);
+            bool has_pos = (d1 > 0) || (d2 > 0) || (d3 > 0);
+            return !(has_neg && has_pos);
+        }
+
+        static bool same_point(const sgp_point &a, const sgp_point &b)
+        {
+            return a.x == b.x && a.y == b.y;
+        }
+
+        /**
+         * @brief Check that b is convex and that no reflex vertex lies inside a-b-c
+         */
+        bool is_ear(const sgp_point *polygon, int a, int b, int c) const
+        {
+            float t = turn(polygon, a, b, c);
+            if (t < 0.0f)
+                return false;
+
+            // Collinear vertex, clipping it adds no triangle
+            if (t == 0.0f)
+                return true;
+
+            const sgp_point &pa = polygon[a];
+            const sgp_point &pb = polygon[b];
+            const sgp_point &pc = polygon[c];
+
+            int cx0, cy0, cx1, cy1;
+            cell_of(sgp_point{std::min({pa.x, pb.x, pc.x}), std::min({pa.y, pb.y, pc.y})}, cx0, cy0);
+            cell_of(sgp_point{std::max({pa.x, pb.x, pc.x}), std::max({pa.y, pb.y, pc.y})}, cx1, cy1);
+
+            for (int cy = cy0; cy <= cy1; cy++)
+            {
+                for (int cx = cx0; cx <= cx1; cx++)
+                {
+                    int cell = cy * _grid_w + cx;
+                    for (int k = _cell_start[cell]; k < _cell_start[cell + 1]; k++)
+                    {
+                        int v = _cell_items[k];
+                        if (!_reflex[v] || v == a || v == b || v == c)
+                            continue;
+
+                        const sgp_point &pv = polygon[v];
+                        if (same_point(pv, pa) || same_point(pv, pb) || same_point(pv, pc))
+                            continue;
+
+                        if (point_in_triangle(pv, pa, pb, pc))
+                            return false;
+                    }
+                }
+            }
+
+            return true;
+        }
+
+        /**
+         * @brief Bucket the reflex vertices in a grid of about one vertex per cell
+         */
+        void build_grid(const sgp_point *polygon, int n)
+        {
+            int reflex_count = 0;
+            _min = polygon[0];
+            sgp_point max = polygon[0];
+            for (int i = 0; i < n; i++)
+            {
+                _min.x = std::min(_min.x, polygon[i].x);
+                _min.y = std::min(_min.y, polygon[i].y);
+                max.x = std::max(max.x, polygon[i].x);
+                max.y = std::max(max.y, polygon[i].y);
+                reflex_count += _reflex[i];
+            }
+
+            int side = std::max(1, static_cast<int>(std::sqrt(static_cast<float>(reflex_count))));
+            _grid_w = side;
+            _grid_h = side;
+            _inv_cell_w = max.x > _min.x ? _grid_w / (max.x - _min.x) : 0.0f;
+            _inv_cell_h = max.y > _min.y ? _grid_h / (max.y - _min.y) : 0.0f;
+
+            // Counting sort of the reflex vertices by cell
+            _cell_start.assign(_grid_w * _grid_h + 1, 0);
+            for (int i = 0; i < n; i++)
+            {
+                if (_reflex[i])
+                    _cell_start[cell_index(polygon[i]) + 1]++;
+            }
+            for (size_t c = 1; c < _cell_start.size(); c++)
+            {
+                _cell_start[c] += _cell_start[c - 1];
+            }
+
+            _cell_items.resize(reflex_count);
+            _cell_fill.assign(_cell_start.begin(), _cell_start.end() - 1);
+            for (int i = 0; i < n; i++)
+            {
+                if (_reflex[i])
+                    _cell_items[_cell_fill[cell_index(polygon[i])]++] = i;
+            }
+        }
+
+        void cell_of(const sgp_point &p, int &cx, int &cy) const
+        {
+            cx = std::clamp(static_cast<int>((p.x - _min.x) * _inv_cell_w), 0, _grid_w - 1);
+            cy = std::clamp(static_cast<int>((p.y - _min.y) * _inv_cell_h), 0, _grid_h - 1);
+        }
+
+        int cell_index(const sgp_point &p) const
+        {
+            int cx, cy;
+            cell_of(p, cx, cy);
+            return cy * _grid_w + cx;
+        }
+
+    protected:
+        std::vector<int> _prev;
+        std::vector<int> _next;
+        std::vector<uint8_t> _reflex;
+        std::vector<int> _cell_start;
+        std::vector<int> _cell_fill;
+        std::vector<int> _cell_items;
+        sgp_point _min;
+        float _inv_cell_w = 0.0f;
+        float _inv_cell_h = 0.0f;
+        int _grid_w = 1;
+        int _grid_h = 1;
+        float _winding = 1.0f;
+    };
+
+    /**
+     * @brief Scratch buffers reused while tessellating
+     *
+     * The tessellation functions append into these buffers instead of returning new
+     * containers, so after the first frames they stop allocating.
+     */
+    class tessellator
+    {
+    public:
+        /**
+         * @brief Get the tessellator used on the calling thread when none is given
+         */
+        static tessellator &get_default()
+        {
+            thread_local tessellator t;
+            return t;
+        }
+
+    public:
+        geometry output;                      // Geometry of the path being stroked or filled
+        std::vector<sgp_point> points;        // Flattened curve points
+        std::vector<sgp_point> stroke_points; // Polyline being stroked, without repeated points
+        std::vector<sgp_point> stroke_directions; // Unit direction of each stroke_points segment
+        std::vector<float> stroke_lengths;        // Length of each stroke_points segment
+        std::vector<sgp_point> dash_points;       // Dash being stroked, see stroker::stroke_dashed()
+        std::vector<sgp_point> dash_directions;
+        std::vector<float> dash_lengths;
+        std::vector<int> indices;             // Polygon triangulation indices
+        std::vector<sgp_point> outline;       // Closed outline of the element being stencil filled
+        ear_clipper ears;                     // Polygon triangulation
+
+        float tolerance = default_tessellation_tolerance; // Maximum curve flattening error, in path units
+        bool dash_distances = false; // Dashed strokes are not cut, their geometry gets the arc lengths instead
+    };
+
+    /**
+     * @brief Turn polylines into triangle lists with joins and caps
+     *
+     * Every segment is a quad, the outer side of each joint is closed with a miter, bevel or
+     * round join and open polylines get butt, square or round caps. The whole polyline ends
+     * up in one triangle list that is submitted with a single draw.
+     *
+     * On the inner side of a joint the quads of the two segments overlap, this is not visible
+     * with opaque colors but translucent strokes are blended twice there.
+     */
+    class stroker
+    {
+    public:
+        /**
+         * @brief Append the triangles stroking a polyline
+         *
+         * @param points The polyline points
+         * @param count The number of points
+         * @param closed If true the last point is joined to the first one and no caps are added
+         * @param style The stroke style, only the geometry fields are used
+         * @param out The triangles are appended here
+         * @param t Gives the buffers storing the polyline without repeated points and its segments
+         */
+        static void stroke_polyline(const sgp_point *points, size_t count, bool closed, const stroke_style_s &style,
+                                    std::vector<sgp_triangle> &out, tessellator &t)
+        {
+            size_t n = prepare(points, count, closed, t);
+            if (n < 2)
+                return;
+
+            // 2 triangles per segment, plus a few for the joins and the caps
+            triangle_writer w(out, (closed ? n : n - 1) * 2 + n + 8);
+            stroke_run(t.stroke_points.data(), t.stroke_directions.data(), t.stroke_lengths.data(), n, closed, style, t.tolerance, w);
+        }
+
+        /**
+         * @brief Append the dashes stroking a polyline, as triangles or, for 1 pixel strokes, as lines
+         *
+         * The dashes are cut in one pass over the segments accumulating the arc length, each one
+         * is stroked with its caps and joins into the same output. With t.dash_distances the
+         * polyline is not cut: the whole stroke is appended with the arc length of every vertex,
+         * for dashes evaluated per fragment.
+         *
+         * @param style The stroke style, dashed() must be true
+         */
+        static void stroke_dashed(const sgp_point *points, size_t count, bool closed, const stroke_style_s &style,
+                                  geometry &out, tessellator &t)
+        {
+            size_t n = prepare(points, count, closed, t);
+            if (n < 2)
+                return;
+
+            const sgp_point *p = t.stroke_points.data();
+            const sgp_point *dir = t.stroke_directions.data();
+            const float *len = t.stroke_lengths.data();
+            size_t segments = closed ? n : n - 1;
+            bool lines = style.width == 1.0f;
+
+            if (t.dash_distances)
+            {
+                if (lines)
+                {
+                    float s = 0.0f;
+                    for (size_t i = 0; i < segments; i++)
+                    {
+                        out.lines.emplace_back(sgp_line{p[i], p[(i + 1) % n]});
+                        out.line_distances.push_back(s);
+                        s += len[i];
+                        out.line_distances.push_back(s);
+                    }
+                }
+                else
+                {
+                    triangle_writer w(out.triangles, segments * 2 + n + 8);
+                    stroke_run(p, dir, len, n, closed, style, t.tolerance, w, &out.triangle_distances);
+                }
+                return;
+            }
+
+            // Find the dash or gap at the start and how much of it is left
+            const std::array<float, stroke_style_s::max_dashes> &dashes = style.dashes;
+            size_t dash_count = style.dash_count;
+            float period = style.dash_period();
+            float phase = std::fmod(style.dash_offset, period);
+            if (phase < 0.0f)
+                phase += period;
+            size_t k = 0;
+            while (phase >= dashes[k])
+            {
+                phase -= dashes[k];
+                k = (k + 1) % dash_count;
+            }
+            float remaining = dashes[k] - phase;
+            bool on = k % 2 == 0;
+
+            std::vector<sgp_point> &dash = t.dash_points;
+            std::vector<sgp_point> &dash_dir = t.dash_directions;
+            std::vector<float> &dash_len = t.dash_lengths;
+            sgp_point start_dir = dir[0]; // Direction of a dash of zero length
+            float from = 0.0f;            // Position of the last dash point in the current segment
+            auto extend = [&](const sgp_point &q, const sgp_point &d, float length)
+            {
+                if (length <= 0.0f)
+                    return;
+                dash.push_back(q);
+                dash_dir.push_back(d);
+                dash_len.push_back(length);
+            };
+
+            triangle_writer w(out.triangles, lines ? 0 : segments + 8);
+            auto emit = [&]()
+            {
+                if (lines)
+                {
+                    for (size_t i = 1; i < dash.size(); i++)
+                        out.lines.emplace_back(sgp_line{dash[i - 1], dash[i]});
+                }
+                else if (dash.size() > 1)
+                {
+                    stroke_run(dash.data(), dash_dir.data(), dash_len.data(), dash.size(), false, style, t.tolerance, w);
+                }
+                else if (style.cap != line_cap::butt)
+                {
+                    // A dash of zero length is only its two caps
+                    float hw = style.width / 2.0f;
+                    add_cap(dash[0], sgp_point{-start_dir.x, -start_dir.y}, hw, style.cap, t.tolerance, w);
+                    add_cap(dash[0], start_dir, hw, style.cap, t.tolerance, w);
+                }
+            };
+            auto begin = [&](const sgp_point &q, const sgp_point &d, float pos)
+            {
+                dash.assign(1, q);
+                dash_dir.clear();
+                dash_len.clear();
+                start_dir = d;
+                from = pos;
+            };
+
+            if (on)
+                begin(p[0], dir[0], 0.0f);
+            for (size_t i = 0; i < segments; i++)
+            {
+                const sgp_point &a = p[i];
+                const sgp_point &d = dir[i];
+                float l = len[i];
+                float pos = 0.0f;
+                from = 0.0f;
+                while (remaining <= l - pos)
+                {
+                    pos += remaining;
+                    sgp_point q{a.x + d.x * pos, a.y + d.y * pos};
+                    if (on)
+                    {
+                        extend(q, d, pos - from);
+                        emit();
+                    }
+                    else
+                    {
+                        begin(q, d, pos);
+                    }
+                    k = (k + 1) % dash_count;
+                    remaining = dashes[k];
+                    on = !on;
+                }
+                remaining -= l - pos;
+                if (on)
+                    extend(p[(i + 1) % n], d, l - from);
+            }
+            if (on)
+                emit();
+        }
+
+        /**
+         * @brief Drop the repeated points of a polyline and compute its segments in t
+         *
+         * @param closed Set to false when the polyline is too short to be closed
+         * @return The number of points kept in t.stroke_points
+         */
+        static size_t prepare(const sgp_point *points, size_t count, bool &closed, tessellator &t)
+        {
+            std::vector<sgp_point> &scratch = t.stroke_points;
+
+            // Zero length segments have no direction, drop them
+            scratch.resize(count);
+            size_t kept = 0;
+            for (size_t i = 0; i < count; i++)
+            {
+                if (kept == 0 || scratch[kept - 1].x != points[i].x || scratch[kept - 1].y != points[i].y)
+                    scratch[kept++] = points[i];
+            }
+            scratch.resize(kept);
+            if (closed && scratch.size() > 1 && scratch.front().x == scratch.back().x && scratch.front().y == scratch.back().y)
+                scratch.pop_back();
+
+            size_t n = scratch.size();
+            if (n < 2)
+                return n;
+
+            // A closed path with 2 points is a line going back and forth
+            if (n < 3)
+                closed = false;
+
+            // Segment i goes from point i to point i + 1, the closing segment is the last one
+            size_t segments = closed ? n : n - 1;
+            std::vector<sgp_point> &dir = t.stroke_directions;
+            std::vector<float> &len = t.stroke_lengths;
+            dir.resize(segments);
+            len.resize(segments);
+            simd::segment_directions(scratch.data(), n - 1, dir.data(), len.data());
+            if (closed)
+            {
+                len[n - 1] = segment_length(scratch[n - 1], scratch[0]);
+                dir[n - 1] = direction(scratch[n - 1], scratch[0]);
+            }
+            return n;
+        }
+
+        /**
+         * @brief Stroke a polyline without repeated points
+         *
+         * @param p The n points
+         * @param dir The unit direction of each segment, segment i goes from point i to the next one
+         * @param len The length of each segment
+         * @param tolerance The maximum chord error of the round joins and caps
+         * @param distances When not null gets the arc length of every vertex appended, 3 per triangle
+         */
+        static void stroke_run(const sgp_point *p, const sgp_point *dir, const float *len, size_t n, bool closed,
+                               const stroke_style_s &style, float tolerance, triangle_writer &w, std::vector<float> *distances = nullptr)
+        {
+            float hw = style.width / 2.0f;
+            joint prev;
+
+            // The joins and caps at a vertex take its arc length, segment quads go from one to the next
+            auto mark = [&](float s)
+            {
+                if (distances)
+                    distances->resize(w.size() * 3, s);
+            };
+            auto mark_quad = [&](float s0, float s1)
+            {
+                if (!distances)
+                    return;
+                const float quad[6] = {s0, s1, s0, s1, s0, s1};
+                distances->insert(distances->end(), quad, quad + 6);
+            };
+
+            if (closed)
+            {
+                prev = make_joint(p[0], dir[n - 1], len[n - 1], dir[0], len[0], hw, style, tolerance, w);
+            }
+            else
+            {
+                prev = make_cap(p[0], sgp_point{-dir[0].x, -dir[0].y}, hw, style.cap, tolerance, w);
+            }
+            mark(0.0f);
+            joint first = prev;
+            float s = 0.0f;
+
+            for (size_t i = 1; i < n; i++)
+            {
+                joint j;
+                if (i < n - 1 || closed)
+                    j = make_joint(p[i], dir[i - 1], len[i - 1], dir[i], len[i], hw, style, tolerance, w);
+                else
+                    j = make_cap(p[i], dir[i - 1], hw, style.cap, tolerance, w);
+                mark(s + len[i - 1]);
+
+                add_quad(w, prev.out_left, j.in_left, j.in_right, prev.out_right);
+                mark_quad(s, s + len[i - 1]);
+                s += len[i - 1];
+                prev = j;
+            }
+
+            if (closed)
+            {
+                add_quad(w, prev.out_left, first.in_left, first.in_right, prev.out_right);
+                mark_quad(s, s + len[n - 1]);
+            }
+        }
+
+        /**
+         * @brief The stroke outline points around a polyline vertex
+         *
+         * The in points end the incoming segment and the out points start the outgoing one,
+         * left and right are relative to the polyline direction.
+         */
+        struct joint
+        {
+            sgp_point in_left;
+            sgp_point in_right;
+            sgp_point out_left;
+            sgp_point out_right;
+        };
+
+        /**
+         * @brief Compute the outline points at the vertex curr and append its join triangles
+         *
+         * When the turn is gentle enough the two segments share the miter points, so the outline
+         * needs no join triangles and has no overlap. Sharper turns keep the segment ends square
+         * and close the outer side with add_join().
+         *
+         * @param curr The vertex
+         * @param d0 The unit direction of the incoming segment
+         * @param len0 The length of the incoming segment
+         * @param d1 The unit direction of the outgoing segment
+         * @param len1 The length of the outgoing segment
+         */
+        static joint make_joint(const sgp_point &curr, const sgp_point &d0, float len0, const sgp_point &d1, float len1, float hw,
+                                const stroke_style_s &style, float tolerance, triangle_writer &out)
+        {
+            sgp_point n0{-d0.y * hw, d0.x * hw};
+            sgp_point n1{-d1.y * hw, d1.x * hw};
+            float dot = d0.x * d1.x + d0.y * d1.y;
+
+            if (dot > -0.999f)
+            {
+                // (miter length / half width)^2 and the squared length the inner miter point takes along the segments,
+                // compared squared to avoid the square roots
+                float inv = 1.0f / (1.0f + dot);
+                float ratio2 = 2.0f * inv;
+                float inner2 = hw * hw * (1.0f - dot) * inv;
+                float min_len = std::min(len0, len1);
+                bool shared = false;
+
+                if (inner2 <= min_len * min_len)
+                {
+                    if (style.join == line_join::miter)
+                    {
+                        shared = ratio2 <= style.miter_limit * style.miter_limit;
+                    }
+                    else
+                    {
+                        // Less than a quarter of pixel from the exact join: (sqrt(ratio2) - 1) * hw < 0.25
+                        float limit = 1.0f + 0.25f / hw;
+                        shared = ratio2 < limit * limit;
+                    }
+                }
+
+                if (shared)
+                {
+                    sgp_point m{(n0.x + n1.x) * inv, (n0.y + n1.y) * inv};
+                    sgp_point l{curr.x + m.x, curr.y + m.y};
+                    sgp_point r{curr.x - m.x, curr.y - m.y};
+
+                    return joint{l, r, l, r};
+                }
+            }
+
+            add_join(curr, d0, d1, hw, style, tolerance, out);
+
+            return joint{sgp_point{curr.x + n0.x, curr.y + n0.y},
+                         sgp_point{curr.x - n0.x, curr.y - n0.y},
+                         sgp_point{curr.x + n1.x, curr.y + n1.y},
+                         sgp_point{curr.x - n1.x, curr.y - n1.y}};
+        }
+
+        /**
+         * @brief Compute the outline points at the end point p and append its cap triangles
+         *
+         * @param p The end point
+         * @param d The direction pointing out of the polyline
+         * @return The in points are left and right relative to d, the out points are swapped so
+         *         they are relative to the polyline direction when p is the first point
+         */
+        static joint make_cap(const sgp_point &p, const sgp_point &d, float hw, line_cap cap, float tolerance, triangle_writer &out)
+        {
+            add_cap(p, d, hw, cap, tolerance, out);
+
+            sgp_point l{p.x - d.y * hw, p.y + d.x * hw};
+            sgp_point r{p.x + d.y * hw, p.y - d.x * hw};
+
+            return joint{l, r, r, l};
+        }
+
+        static float segment_length(const sgp_point &a, const sgp_point &b)
+        {
+            return std::sqrt((b.x - a.x) * (b.x - a.x) + (b.y - a.y) * (b.y - a.y));
+        }
+
+        /**
+         * @brief Get the unit vector going from a to b
+         */
+        static sgp_point direction(const sgp_point &a, const sgp_point &b)
+        {
+            float dx = b.x - a.x;
+            float dy = b.y - a.y;
+            float len = std::sqrt(dx * dx + dy * dy);
+
+            return sgp_point{dx / len, dy / len};
+        }
+
+        /**
+         * @brief Append the triangles closing the outer side of the joint at p
+         *
+         * @param p The joint point
+         * @param d0 The direction of the incoming segment
+         * @param d1 The direction of the outgoing segment
+         * @param hw Half of the stroke width
+         * @param style The stroke style, gives the join type and the miter limit
+         * @param tolerance The maximum chord error of a round join
+         * @param out The triangles are appended here
+         */
+        static void add_join(const sgp_point &p, const sgp_point &d0, const sgp_point &d1, float hw,
+                             const stroke_style_s &style, float tolerance, triangle_writer &out)
+        {
+            float cross = d0.x * d1.y - d0.y * d1.x;
+            float dot = d0.x * d1.x + d0.y * d1.y;
+
+            // Straight joint, the segment quads already touch
+            if (std::abs(cross) < 1e-6f && dot > 0.0f)
+                return;
+
+            // The outer side is the opposite of the turn direction
+            float side = cross > 0.0f ? -hw : hw;
+            sgp_point n0{-d0.y * side, d0.x * side};
+            sgp_point n1{-d1.y * side, d1.x * side};
+            sgp_point o0{p.x + n0.x, p.y + n0.y};
+            sgp_point o1{p.x + n1.x, p.y + n1.y};
+
+            switch (style.join)
+            {
+            case line_join::miter:
+            {
+                // The miter length divided by the width is 1 / cos(turn / 2) = sqrt(2 / (1 + dot))
+                if (dot > -1.0f && 2.0f <= style.miter_limit * style.miter_limit * (1.0f + dot))
+                {
+                    sgp_point tip{p.x + (n0.x + n1.x) / (1.0f + dot),
+                                  p.y + (n0.y + n1.y) / (1.0f + dot)};
+                    out.emplace_back(sgp_triangle{p, o0, tip});
+                    out.emplace_back(sgp_triangle{p, tip, o1});
+                }
+                else
+                {
+                    out.emplace_back(sgp_triangle{p, o0, o1});
+                }
+                break;
+            }
+            case line_join::bevel:
+                out.emplace_back(sgp_triangle{p, o0, o1});
+                break;
+            case line_join::round:
+            {
+                float angle = std::acos(std::clamp(dot, -1.0f, 1.0f));
+                add_fan(p, n0, cross > 0.0f ? angle : -angle, hw, tolerance, out);
+                break;
+            }
+            }
+        }
+
+        /**
+         * @brief Append the triangles of the cap at the end point p
+         *
+         * @param p The end point
+         * @param d The direction pointing out of the polyline
+         * @param hw Half of the stroke width
+         * @param cap The cap type
+         * @param tolerance The maximum chord error of a round cap
+         * @param out The triangles are appended here
+         */
+        static void add_cap(const sgp_point &p, const sgp_point &d, float hw, line_cap cap, float tolerance, triangle_writer &out)
+        {
+            sgp_point n{-d.y * hw, d.x * hw};
+
+            switch (cap)
+            {
+            case line_cap::butt:
+                break;
+            case line_cap::square:
+            {
+                sgp_point e{d.x * hw, d.y * hw};
+                add_quad(out,
+                         sgp_point{p.x + n.x, p.y + n.y},
+                         sgp_point{p.x + n.x + e.x, p.y + n.y + e.y},
+                         sgp_point{p.x - n.x + e.x, p.y - n.y + e.y},
+                         sgp_point{p.x - n.x, p.y - n.y});
+                break;
+            }
+            case line_cap::round:
+                add_fan(p, n, -M_PI, hw, tolerance, out);
+                break;
+            }
+        }
+
+        /**
+         * @brief Append a triangle fan around center, starting from the offset v and rotating by angle
+         *
+         * @param tolerance The maximum chord error, as for the arcs of the paths
+         */
+        static void add_fan(const sgp_point &center, sgp_point v, float angle, float radius, float tolerance, triangle_writer &out)
+        {
+            int segments = arc_segment_count(radius, angle, tolerance);
+            float step = angle / segments;
+            float c = std::cos(step);
+            float s = std::sin(step);
+
+            for (int i = 0; i < segments; i++)
+            {
+                sgp_point next{v.x * c - v.y * s, v.x * s + v.y * c};
+                out.emplace_back(sgp_triangle{center,
+                                              sgp_point{center.x + v.x, center.y + v.y},
+                                              sgp_point{center.x + next.x, center.y + next.y}});
+                v = next;
+            }
+        }
+
+        /**
+         * @brief Append a quad as 2 triangles 0-1-3 and 1-3-2
+         */
+        static void add_quad(triangle_writer &out, const sgp_point &p0, const sgp_point &p1, const sgp_point &p2, const sgp_point &p3)
+        {
+            out.add_quad(p0, p1, p2, p3);
+        }
+    };
+
+    /**
+     * @brief Base class for path elements
+     */
+    class abstract_sub_path
+    {
+    public:
+        abstract_sub_path() {}
+        virtual ~abstract_sub_path() {}
+
+        /**
+         * @brief Append the vertices needed to stroke the element with the given width
+         */
+        virtual void tessellate_stroke(const stroke_style_s &style, geometry &out, tessellator &t) const = 0;
+
+        /**
+         * @brief Append the vertices needed to fill the element
+         */
+        virtual void tessellate_fill(geometry &out, tessellator &t) const = 0;
+
+        /**
+         * @brief Append the outline of the element as a closed polygon, the closing edge is implicit
+         *
+         * Used by the stencil fill, elements without an area append nothing.
+         */
+        virtual void append_outline(std::vector<sgp_point> &out, tessellator &t) const = 0;
+
+#ifdef SOKOL_GP_INCLUDED
+        /**
+         * @brief Draw the element using the stroke style
+         */
+        void stroke(const stroke_style_s &style) const
+        {
+            tessellator &t = tessellator::get_default();
+            t.output.clear();
+            tessellate_stroke(style, t.output, t);
+            t.output.draw(style.color);
+        }
+
+        /**
+         * @brief Fill the element using the fill style
+         */
+        void fill(const fill_style_s &style) const
+        {
+            tessellator &t = tessellator::get_default();
+            t.output.clear();
+            tessellate_fill(t.output, t);
+            t.output.draw(style.color);
+        }
+#endif
+    };
+
+    /**
+     * @brief A line path element
+     */
+    class path_line : public abstract_sub_path
+    {
+    public:
+        path_line(const sgp_point &pt1, const sgp_point &pt2) : _pt1(pt1),
+                                                                _pt2(pt2)
+        {
+        }
+        virtual ~path_line() {}
+
+        void tessellate_stroke(const stroke_style_s &style, geometry &out, tessellator &t) const override
+        {
+            if (style.dashed())
+            {
+                std::array<sgp_point, 2> points = {_pt1, _pt2};
+                stroker::stroke_dashed(points.data(), points.size(), false, style, out, t);
+            }
+            else if (style.width == 1.0f)
+            {
+                out.lines.emplace_back(sgp_line{_pt1, _pt2});
+            }
+            else
+            {
+                std::array<sgp_point, 2> points = {_pt1, _pt2};
+                stroker::stroke_polyline(points.data(), points.size(), false, style, out.triangles, t);
+            }
+        }
+
+        /**
+         * @brief Fill does nothing for line
+         */
+        void tessellate_fill(geometry &/*out*/, tessellator &/*t*/) const override
+        {
+        }
+
+        void append_outline(std::vector<sgp_point> &/*out*/, tessellator &/*t*/) const override
+        {
+        }
+
+        /**
+         * @brief Get the 4 points for draw a thick line using triangle strip
+         *
+         * 0  S   1
+         * +--+--+
+         * |    /|
+         * |   / |
+         * |  /  |
+         * | /   |
+         * |/    |
+         * +--+--+
+         * 3  E   2
+         *
+         * To draw a line with thickness starting from S end ending to E we need to create
+         * a rectangle using 2 triangles 0-1-3 and 1-3-2. This means the triangle strip must be
+         * drawn using the points in the order 0, 1, 3, 2
+         *
+         * @param start The start point
+         * @param end The end point
+         * @param thickness The line thickness
+         * @param out The array receiving the 4 points
+         */
+        static void get_thick_line_points(sgp_point start, sgp_point end, float thickness, sgp_point *out)
+        {
+            float d = std::sqrt((end.x - start.x) * (end.x - start.x) + (end.y - start.y) * (end.y - start.y));
+            float y_shift = thickness * (end.x - start.x) / (d * 2.0f);
+            float x_shift = -thickness * (end.y - start.y) / (d * 2.0f);
+
+            out[0] = sgp_point{start.x - x_shift, start.y - y_shift};
+            out[1] = sgp_point{start.x + x_shift, start.y + y_shift};
+            out[2] = sgp_point{end.x + x_shift, end.y + y_shift};
+            out[3] = sgp_point{end.x - x_shift, end.y - y_shift};
+        }
+
+        /**
+         * @brief Get an array of 4 points for draw a thick line using triangle strip
+         *
+         * @return std::vector<sgp_point> The array of points
+         */
+        static std::vector<sgp_point> get_thick_line_points(sgp_point start, sgp_point end, float thickness)
+        {
+            std::vector<sgp_point> points(4);
+            get_thick_line_points(start, end, thickness, points.data());
+
+            return points;
+        }
+
+#ifdef SOKOL_GP_INCLUDED
+        /**
+         * @brief Draw a thick line using triangle strip
+         */
+        static void draw_thik_line(sgp_point start, sgp_point end, float thickness)
+        {
+            sgp_point line_points[4];
+            get_thick_line_points(start, end, thickness, line_points);
+
+            std::array<sgp_point, 4> points = {line_points[0],
+                                               line_points[1],
+                                               line_points[3],
+                                               line_points[2]};
+
+            sgp_draw_filled_triangles_strip(points.data(), points.size());
+        }
+
+        /**
+         * @brief Draw a thick line strip with miter joins and butt caps using a single draw
+         */
+        static void draw_thik_lines(const std::vector<sgp_point> &points, float thickness)
+        {
+            if (points.size() < 2)
+                return;
+
+            tessellator &t = tessellator::get_default();
+            stroke_style_s style;
+            style.width = thickness;
+
+            t.output.clear();
+            stroker::stroke_polyline(points.data(), points.size(), false, style, t.output.triangles, t);
+            sgp_draw_filled_triangles(t.output.triangles.data(), t.output.triangles.size());
+        }
+#endif
+
+    protected:
+        sgp_point _pt1;
+        sgp_point _pt2;
+    };
+
+    /**
+     * @brief A rectangle path element
+     */
+    class path_rect : public abstract_sub_path
+    {
+    public:
+        path_rect(const sgp_point &pt1, const sgp_point &pt2) : _pt1(pt1),
+                                                                _pt2(pt2)
+        {
+        }
+        virtual ~path_rect() {}
+
+        void tessellate_stroke(const stroke_style_s &style, geometry &out, tessellator &t) const override
+        {
+            std::array<sgp_point, 5> points = {sgp_point{_pt1.x, _pt1.y},
+                                               sgp_point{_pt2.x, _pt1.y},
+                                               sgp_point{_pt2.x, _pt2.y},
+                                               sgp_point{_pt1.x, _pt2.y},
+                                               sgp_point{_pt1.x, _pt1.y}};
+            if (style.dashed())
+            {
+                stroker::stroke_dashed(points.data(), points.size(), true, style, out, t);
+            }
+            else if (style.width == 1.0f)
+            {
+                out.add_lines_strip(points.data(), points.size());
+            }
+            else
+            {
+                stroker::stroke_polyline(points.data(), points.size(), true, style, out.triangles, t);
+            }
+        }
+
+        void tessellate_fill(geometry &out, tessellator &/*t*/) const override
+        {
+            out.add_quad(sgp_point{_pt1.x, _pt1.y},
+                         sgp_point{_pt2.x, _pt1.y},
+                         sgp_point{_pt2.x, _pt2.y},
+                         sgp_point{_pt1.x, _pt2.y});
+        }
+
+        void append_outline(std::vector<sgp_point> &out, tessellator &/*t*/) const override
+        {
+            out.emplace_back(sgp_point{_pt1.x, _pt1.y});
+            out.emplace_back(sgp_point{_pt2.x, _pt1.y});
+            out.emplace_back(sgp_point{_pt2.x, _pt2.y});
+            out.emplace_back(sgp_point{_pt1.x, _pt2.y});
+        }
+
+    protected:
+        sgp_point _pt1;
+        sgp_point _pt2;
+    };
+
+    /**
+     * @brief An ellipse path element
+     */
+    class path_ellipse : public abstract_sub_path
+    {
+    public:
+        struct ellipse_data
+        {
+            float cx; // Center x
+            float cy; // Center y
+            float rx; // Radius x
+            float ry; // Radius y
+        };
+
+    public:
+        path_ellipse(const sgp_point &pt1, const sgp_point &pt2, float alpha_start = 0.0f, float alpha_end = M_PI * 2) : _pt1(pt1),
+                                                                                                                         _pt2(pt2),
+                                                                                                                         _alpha_start(alpha_start),
+                                                                                                                         _alpha_end(alpha_end)
+        {
+        }
+        virtual ~path_ellipse() {}
+
+        void tessellate_stroke(const stroke_style_s &style, geometry &out, tessellator &t) const override
+        {
+            t.points.clear();
+            append_ellipse_points(_pt1, _pt2, _alpha_start, _alpha_end, t.points, t.tolerance);
+
+            bool closed = _alpha_end - _alpha_start >= 2.0f * M_PI - 1e-4f;
+            if (style.dashed())
+            {
+                stroker::stroke_dashed(t.points.data(), t.points.size(), closed, style, out, t);
+            }
+            else if (style.width == 1.0f)
+            {
+                out.add_lines_strip(t.points.data(), t.points.size());
+            }
+            else
+            {
+                stroker::stroke_polyline(t.points.data(), t.points.size(), closed, style, out.triangles, t);
+            }
+        }
+
+        void tessellate_fill(geometry &out, tessellator &t) const override
+        {
+            append_ellipse_triangles(_pt1, _pt2, _alpha_start, _alpha_end, out.triangles, t.tolerance);
+        }
+
+        void append_outline(std::vector<sgp_point> &out, tessellator &t) const override
+        {
+            // A partial ellipse is filled as a pie, like tessellate_fill() does
+            if (_alpha_end - _alpha_start < 2.0f * M_PI - 1e-4f)
+            {
+                auto ed = get_ellipse_data(_pt1, _pt2);
+                out.emplace_back(sgp_point{ed.cx, ed.cy});
+            }
+            append_ellipse_points(_pt1, _pt2, _alpha_start, _alpha_end, out, t.tolerance);
+        }
+
+        /**
+         * @brief Call f for each point approximating the ellipse
+         *
+         * The number of points is the smallest one keeping the chord error below the tolerance,
+         * measured on the largest radius. Both the start and the end point are always generated.
+         *
+         * @param start The bounding box start point
+         * @param end The bounding box end point
+         * @param alpha_start The starting angle in radians
+         * @param alpha_end The ending angle in radians
+         * @param tolerance The maximum chord error, in path units
+         * @param f The function receiving each sgp_point
+         */
+        template <typename F>
+        static void for_each_ellipse_point(sgp_point start, sgp_point end, float alpha_start, float alpha_end, float tolerance, F &&f)
+        {
+            if (alpha_end < alpha_start)
+                return;
+
+            auto ed = get_ellipse_data(start, end);
+
+            int segments = arc_segment_count(std::max(std::abs(ed.rx), std::abs(ed.ry)), alpha_end - alpha_start, tolerance);
+
+            for_each_arc_angle(alpha_start, alpha_end, segments, [&](float c, float s)
+                               { f(sgp_point{ed.cx + c * ed.rx, ed.cy + s * ed.ry}); });
+        }
+
+        /**
+         * @brief Append the points approximating the ellipse to out
+         */
+        static void append_ellipse_points(sgp_point start, sgp_point end, float alpha_start, float alpha_end, std::vector<sgp_point> &out,
+                                          float tolerance = default_tessellation_tolerance)
+        {
+            for_each_ellipse_point(start, end, alpha_start, alpha_end, tolerance, [&](const sgp_point &p)
+                                   { out.emplace_back(p); });
+        }
+
+        /**
+         * @brief Append the triangle fan filling the ellipse to out
+         */
+        static void append_ellipse_triangles(sgp_point start, sgp_point end, float alpha_start, float alpha_end, std::vector<sgp_triangle> &out,
+                                             float tolerance = default_tessellation_tolerance)
+        {
+            auto ed = get_ellipse_data(start, end);
+            sgp_point center_point{ed.cx, ed.cy};
+            sgp_point prev;
+            bool has_prev = false;
+
+            for_each_ellipse_point(start, end, alpha_start, alpha_end, tolerance, [&](const sgp_point &p)
+                                   {
+                                       if (has_prev)
+                                           out.emplace_back(sgp_triangle{center_point, prev, p});
+                                       prev = p;
+                                       has_prev = true; });
+        }
+
+        /**
+         * @brief Get an array of points approximating the ellipse
+         *
+         * @return std::vector<sgp_point> The array of points
+         */
+        static std::vector<sgp_point> get_ellipse_points(sgp_point start, sgp_point end, float alpha_start = 0.0f, float alpha_end = M_PI * 2)
+        {
+            std::vector<sgp_point> points;
+            append_ellipse_points(start, end, alpha_start, alpha_end, points);
+
+            return points;
+        }
+
+        static std::vector<sgp_triangle> get_ellipse_triangles(sgp_point start, sgp_point end, float alpha_start = 0.0f, float alpha_end = M_PI * 2)
+        {
+            std::vector<sgp_triangle> triangles;
+            append_ellipse_triangles(start, end, alpha_start, alpha_end, triangles);
+
+            return triangles;
+        }
+
+        static ellipse_data get_ellipse_data(sgp_point start, sgp_point end)
+        {
+            ellipse_data e;
+
+            e.rx = (end.x - start.x) / 2.0f;
+            e.ry = (end.y - start.y) / 2.0f;
+            e.cx = start.x + e.rx;
+            e.cy = start.y + e.ry;
+
+            return e;
+        }
+
+    protected:
+        sgp_point _pt1;
+        sgp_point _pt2;
+        float _alpha_start;
+        float _alpha_end;
+    };
+
+    /**
+     * @brief A rounded rectangle path element
+     */
+    class path_roundrect : public abstract_sub_path
+    {
+    public:
+        /**
+         * @brief Bounding box and angles of a corner arc
+         */
+        struct corner_arc
+        {
+            sgp_point start;
+            sgp_point end;
+            float alpha_start;
+            float alpha_end;
+        };
+
+    public:
+        path_roundrect(const sgp_point &pt1, const sgp_point &pt2, float rx, float ry) : _pt1(pt1),
+                                                                                         _pt2(pt2),
+                                                                                         _rx(rx),
+                                                                                         _ry(ry)
+        {
+        }
+        virtual ~path_roundrect() {}
+
+        void tessellate_stroke(const stroke_style_s &style, geometry &out, tessellator &t) const override
+        {
+            // The corner arcs in clockwise order, the straight sides connect each arc to the next one
+            t.points.clear();
+            append_outline(t.points, t);
+
+            if (t.points.empty())
+                return;
+
+            if (style.dashed())
+            {
+                stroker::stroke_dashed(t.points.data(), t.points.size(), true, style, out, t);
+            }
+            else if (style.width == 1.0f)
+            {
+                out.add_lines_strip(t.points.data(), t.points.size());
+                out.lines.emplace_back(sgp_line{t.points.back(), t.points.front()});
+            }
+            else
+            {
+                stroker::stroke_polyline(t.points.data(), t.points.size(), true, style, out.triangles, t);
+            }
+        }
+
+        void tessellate_fill(geometry &out, tessellator &t) const override
+        {
+            int segments = corner_segments(t.tolerance);
+            auto arcs = get_corner_arcs();
+            triangle_writer w(out.triangles, segments * 4 + 6);
+            for (int i = 0; i < 4; i++)
+            {
+                sgp_point center{(arcs[i].start.x + arcs[i].end.x) / 2.0f, (arcs[i].start.y + arcs[i].end.y) / 2.0f};
+                t.points.clear();
+                append_corner_points(arcs[i], i, segments, t.points);
+                for (size_t k = 1; k < t.points.size(); k++)
+                {
+                    w.emplace_back(sgp_triangle{center, t.points[k - 1], t.points[k]});
+                }
+            }
+
+            // Horizontal band, then the top and bottom bands between the corners
+            w.add_quad(sgp_point{_pt1.x, _pt1.y + _ry}, sgp_point{_pt2.x, _pt1.y + _ry},
+                       sgp_point{_pt2.x, _pt2.y - _ry}, sgp_point{_pt1.x, _pt2.y - _ry});
+            w.add_quad(sgp_point{_pt1.x + _rx, _pt1.y}, sgp_point{_pt2.x - _rx, _pt1.y},
+                       sgp_point{_pt2.x - _rx, _pt1.y + _ry}, sgp_point{_pt1.x + _rx, _pt1.y + _ry});
+            w.add_quad(sgp_point{_pt1.x + _rx, _pt2.y - _ry}, sgp_point{_pt2.x - _rx, _pt2.y - _ry},
+                       sgp_point{_pt2.x - _rx, _pt2.y}, sgp_point{_pt1.x + _rx, _pt2.y});
+        }
+
+        void append_outline(std::vector<sgp_point> &out, tessellator &t) const override
+        {
+            int segments = corner_segments(t.tolerance);
+            auto arcs = get_corner_arcs();
+            for (int i = 0; i < 4; i++)
+            {
+                append_corner_points(arcs[i], i, segments, out);
+            }
+        }
+
+        /**
+         * @brief Get the number of segments of each corner arc for a tolerance in path units
+         */
+        int corner_segments(float tolerance) const
+        {
+            return arc_segment_count(std::max(std::abs(_rx), std::abs(_ry)), (float)M_PI_2, tolerance);
+        }
+
+        /**
+         * @brief Append the points of a corner arc to out
+         *
+         * The points are a quarter circle table turned by a multiple of 90 degrees and scaled
+         * to the corner with simd::affine_points(), so no sin/cos is evaluated.
+         *
+         * @param arc The corner arc, as returned by get_corner_arcs()
+         * @param index The corner index in get_corner_arcs() order
+         * @param segments The number of segments of the arc
+         * @param out The points are appended here
+         */
+        static void append_corner_points(const corner_arc &arc, int index, int segments, std::vector<sgp_point> &out)
+        {
+            float rx = (arc.end.x - arc.start.x) / 2.0f;
+            float ry = (arc.end.y - arc.start.y) / 2.0f;
+            float cx = arc.start.x + rx;
+            float cy = arc.start.y + ry;
+
+            // Top-left starts at 180 degrees, top-right at 270, bottom-right at 0, bottom-left at 90
+            const float m[4][6] = {{-rx, 0.0f, cx, 0.0f, -ry, cy},
+                                   {0.0f, rx, cx, -ry, 0.0f, cy},
+                                   {rx, 0.0f, cx, 0.0f, ry, cy},
+                                   {0.0f, -rx, cx, ry, 0.0f, cy}};
+
+            const std::vector<sgp_point> &table = quarter_circle(segments);
+            size_t first = out.size();
+            out.insert(out.end(), table.begin(), table.end());
+            simd::affine_points(out.data() + first, table.size(), m[index], out.data() + first);
+        }
+
+        /**
+         * @brief Get the cos and sin of segments + 1 angles evenly spaced from 0 to 90 degrees
+         *
+         * A table is built the first time a segment count is requested, then it is shared by all
+         * the rounded rectangles drawn on the thread.
+         */
+        static const std::vector<sgp_point> &quarter_circle(int segments)
+        {
+            thread_local std::vector<std::vector<sgp_point>> tables;
+            thread_local std::vector<sgp_point> large;
+
+            // Segment counts this large only come from huge radii or tiny tolerances, they are not cached
+            constexpr int max_cached_segments = 1024;
+            std::vector<sgp_point> *table = &large;
+            if (segments <= max_cached_segments)
+            {
+                if (segments >= (int)tables.size())
+                    tables.resize(segments + 1);
+                table = &tables[segments];
+                if (!table->empty())
+                    return *table;
+            }
+
+            table->clear();
+            for_each_arc_angle(0.0f, (float)M_PI_2, segments, [&](float c, float s)
+                               { table->emplace_back(sgp_point{c, s}); });
+            return *table;
+        }
+
+        /**
+         * @brief Get the 4 corner arcs in the order top-left, top-right, bottom-right, bottom-left
+         */
+        std::array<corner_arc, 4> get_corner_arcs() const
+        {
+            return {corner_arc{sgp_point{_pt1.x, _pt1.y},
+                               sgp_point{_pt1.x + _rx * 2, _pt1.y + _ry * 2},
+                               (float)M_PI,
+                               (float)M_PI_2 * 3.0f},
+                    corner_arc{sgp_point{_pt2.x - _rx * 2, _pt1.y},
+                               sgp_point{_pt2.x, _pt1.y + _ry * 2},
+                               (float)M_PI_2 * 3.0f,
+                               (float)M_PI * 2.0f},
+                    corner_arc{sgp_point{_pt2.x - _rx * 2, _pt2.y - _ry * 2},
+                               sgp_point{_pt2.x, _pt2.y},
+                               0.0f,
+                               (float)M_PI_2},
+                    corner_arc{sgp_point{_pt1.x, _pt2.y - _ry * 2},
+                               sgp_point{_pt1.x + _rx * 2, _pt2.y},
+                               (float)M_PI_2,
+                               (float)M_PI}};
+        }
+
+    protected:
+        sgp_point _pt1;
+        sgp_point _pt2;
+        float _rx;
+        float _ry;
+    };
+
+    class sub_path : public abstract_sub_path
+    {
+    public:
+        sub_path() {}
+        virtual ~sub_path() {}
+
+        void clear()
+        {
+            _points.clear();
+            _closed = false;
+        }
+
+        void move_to(const sgp_point &pt)
+        {
+            _points.emplace_back(pt);
+        }
+
+        void line_to(const sgp_point &pt)
+        {
+            if (_points.empty())
+                return;
+
+            _points.emplace_back(pt);
+            _closed = false;
+        }
+
+        void arc_to(const sgp_point &pt1, const sgp_point &pt2, float radius, float tolerance = default_tessellation_tolerance)
+        {
+            if (_points.empty())
+                return;
+
+            sgp_point p0 = _points.back();
+            append_arc_to_points(p0, pt1, pt2, radius, _points, tolerance);
+            _closed = false;
+        }
+
+        /**
+         * @brief Add a quadratic Bezier curve from the last point, like quadraticCurveTo() of the HTML5 canvas
+         *
+         * @param cp The control point
+         * @param pt The end point
+         * @param tolerance The maximum chord error, in path units
+         */
+        void quadratic_curve_to(const sgp_point &cp, const sgp_point &pt, float tolerance = default_tessellation_tolerance)
+        {
+            if (_points.empty())
+                return;
+
+            append_quadratic_points(_points.back(), cp, pt, _points, tolerance);
+            _closed = false;
+        }
+
+        /**
+         * @brief Add a cubic Bezier curve from the last point, like bezierCurveTo() of the HTML5 canvas
+         *
+         * @param cp1 The control point of the start
+         * @param cp2 The control point of the end
+         * @param pt The end point
+         * @param tolerance The maximum chord error, in path units
+         */
+        void bezier_curve_to(const sgp_point &cp1, const sgp_point &cp2, const sgp_point &pt, float tolerance = default_tessellation_tolerance)
+        {
+            if (_points.empty())
+                return;
+
+            append_cubic_points(_points.back(), cp1, cp2, pt, _points, tolerance);
+            _closed = false;
+        }
+
+        void close_path()
+        {
+            if (_points.empty())
+                return;
+            _points.emplace_back(_points.front());
+            _closed = true;
+        }
+
+        void tessellate_stroke(const stroke_style_s &style, geometry &out, tessellator &t) const override
+        {
+            if (style.dashed())
+            {
+                stroker::stroke_dashed(_points.data(), _points.size(), _closed, style, out, t);
+            }
+            else if (style.width == 1.0f)
+            {
+                out.add_lines_strip(_points.data(), _points.size());
+            }
+            else
+            {
+                stroker::stroke_polyline(_points.data(), _points.size(), _closed, style, out.triangles, t);
+            }
+        }
+
+        void tessellate_fill(geometry &out, tessellator &t) const override
+        {
+            if (!t.ears.triangulate(_points.data(), _points.size(), out.triangles))
+                triangulate_polygon(_points, out.triangles, t.indices);
+        }
+
+        void append_outline(std::vector<sgp_point> &out, tessellator &/*t*/) const override
+        {
+            out.insert(out.end(), _points.begin(), _points.end());
+        }
+
+        static float cross_product(const sgp_point &a, const sgp_point &b, const sgp_point &c)
+        {
+            return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        }
+
+        static float distance(const sgp_point &p1, const sgp_point &p2)
+        {
+            return std::sqrt(std::pow(p2.x - p1.x, 2) + std::pow(p2.y - p1.y, 2));
+        }
+
+        static float angle_between_vectors(const sgp_point &p1, const sgp_point &p2, const sgp_point &p3)
+        {
+            double v1_x = p2.x - p1.x;
+            double v1_y = p2.y - p1.y;
+            double v2_x = p3.x - p2.x;
+            double v2_y = p3.y - p2.y;
+            double dot = v1_x * v2_x + v1_y * v2_y;
+            double mag1 = std::sqrt(v1_x * v1_x + v1_y * v1_y);
+            double mag2 = std::sqrt(v2_x * v2_x + v2_y * v2_y);
+            return std::acos(dot / (mag1 * mag2));
+        }
+
+        /**
+         * @brief Get the circle of the arc append_arc_to_points() appends and the point the arc ends on
+         *
+         * @return false if the arc is degenerate
+         */
+        static bool arc_to_circle(const sgp_point &p0, const sgp_point &p1, const sgp_point &p2, float radius,
+                                  sgp_point &center, sgp_point &end)
+        {
+            float dx1 = p0.x - p1.x;
+            float dy1 = p0.y - p1.y;
+            float dx2 = p2.x - p1.x;
+            float dy2 = p2.y - p1.y;
+            float len1 = std::hypot(dx1, dy1);
+            float len2 = std::hypot(dx2, dy2);
+            dx1 /= len1;
+            dy1 /= len1;
+            dx2 /= len2;
+            dy2 /= len2;
+
+            float angle = std::acos(dx1 * dx2 + dy1 * dy2);
+            float dist = radius / std::tan(angle / 2.0f);
+            float bisect_x = dx1 + dx2;
+            float bisect_y = dy1 + dy2;
+            float bisect_len = std::hypot(bisect_x, bisect_y);
+            float d = radius / std::sin(angle / 2.0f) / bisect_len;
+            center = sgp_point{p1.x + bisect_x * d, p1.y + bisect_y * d};
+            end = sgp_point{p1.x + dx2 * dist, p1.y + dy2 * dist};
+
+            return std::isfinite(center.x) && std::isfinite(center.y) && std::isfinite(end.x) && std::isfinite(end.y);
+        }
+
+        static std::vector<sgp_point> get_arc_to_points(const sgp_point &p0, const sgp_point &p1, const sgp_point &p2, float radius)
+        {
+            std::vector<sgp_point> arcPoints;
+            append_arc_to_points(p0, p1, p2, radius, arcPoints);
+
+            return arcPoints;
+        }
+
+        /**
+         * @brief Append the points of the arc tangent to the lines p0-p1 and p1-p2 to out
+         *
+         * @param tolerance The maximum chord error, in path units
+         */
+        static void append_arc_to_points(const sgp_point &p0, const sgp_point &p1, const sgp_point &p2, float radius, std::vector<sgp_point> &out,
+                                         float tolerance = default_tessellation_tolerance)
+        {
+            // Direction vectors
+            float dx1 = p0.x - p1.x;
+            float dy1 = p0.y - p1.y;
+            float dx2 = p2.x - p1.x;
+            float dy2 = p2.y - p1.y;
+
+            // Normalize direction vectors
+            float len1 = std::hypot(dx1, dy1);
+            float len2 = std::hypot(dx2, dy2);
+            dx1 /= len1;
+            dy1 /= len1;
+            dx2 /= len2;
+            dy2 /= len2;
+
+            // Compute angle between vectors
+            float angle = std::acos(dx1 * dx2 + dy1 * dy2);
+            float tanHalfAngle = std::tan(angle / 2.0);
+
+            // Distance from intersection point to tangent points
+            float dist = radius / tanHalfAngle;
+
+            // Compute tangent points
+            sgp_point tangent1 = {p1.x + dx1 * dist, p1.y + dy1 * dist};
+            sgp_point tangent2 = {p1.x + dx2 * dist, p1.y + dy2 * dist};
+
+            // Compute arc center
+            float bisectX = dx1 + dx2;
+            float bisectY = dy1 + dy2;
+            float bisectLen = std::hypot(bisectX, bisectY);
+            bisectX /= bisectLen;
+            bisectY /= bisectLen;
+
+            sgp_point center = {
+                p1.x + bisectX * radius / std::sin(angle / 2.0f),
+                p1.y + bisectY * radius / std::sin(angle / 2.0f)};
+
+            // Compute start and end angles
+            float startAngle = std::atan2(tangent1.y - center.y, tangent1.x - center.x);
+            float endAngle = std::atan2(tangent2.y - center.y, tangent2.x - center.x);
+
+            // Determine arc direction
+            bool clockwise = (dx1 * dy2 - dy1 * dx2) < 0;
+
+            // Compute angle difference
+            float deltaAngle = endAngle - startAngle;
+            if (clockwise && deltaAngle < 0)
+                deltaAngle += 2 * M_PI;
+            if (!clockwise && deltaAngle > 0)
+                deltaAngle -= 2 * M_PI;
+
+            // Number of segments keeping the chord error within the tolerance
+            int segments = arc_segment_count(radius, deltaAngle, tolerance);
+
+            // Generate arc points
+            for_each_arc_angle(startAngle, startAngle + deltaAngle, segments, [&](float c, float s)
+                               { out.push_back(sgp_point{center.x + radius * c, center.y + radius * s}); });
+        }
+
+        /**
+         * @brief Append the points of a quadratic Bezier curve to out, p0 excluded
+         *
+         * @param tolerance The maximum chord error, in path units
+         */
+        static void append_quadratic_points(sgp_point p0, const sgp_point &p1, const sgp_point &p2, std::vector<sgp_point> &out,
+                                            float tolerance = default_tessellation_tolerance)
+        {
+            // p0 may be an element of out, it is copied before out grows
+            const sgp_point points[3] = {p0, p1, p2};
+            int segments = bezier_segment_count(points, 2, tolerance);
+            for_each_quadratic_point(p0, p1, p2, segments, [&](const sgp_point &p)
+                                     { out.push_back(p); });
+        }
+
+        /**
+         * @brief Append the points of a cubic Bezier curve to out, p0 excluded
+         *
+         * @param tolerance The maximum chord error, in path units
+         */
+        static void append_cubic_points(sgp_point p0, const sgp_point &p1, const sgp_point &p2, const sgp_point &p3, std::vector<sgp_point> &out,
+                                        float tolerance = default_tessellation_tolerance)
+        {
+            const sgp_point points[4] = {p0, p1, p2, p3};
+            int segments = bezier_segment_count(points, 3, tolerance);
+            for_each_cubic_point(p0, p1, p2, p3, segments, [&](const sgp_point &p)
+                                 { out.push_back(p); });
+        }
+
+        static float cross(const sgp_point &a, const sgp_point &b, const sgp_point &c)
+        {
+            return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+        }
+
+        static bool is_convex(const sgp_point &prev, const sgp_point &curr, const sgp_point &next)
+        {
+            return cross(prev, curr, next) < 0;
+        }
+
+        static bool point_in_triangle(const sgp_point &p, const sgp_triangle &t)
+        {
+            double d1 = cross(t.a, t.b, p);
+            double d2 = cross(t.b, t.c, p);
+            double d3 = cross(t.c, t.a, p);
+            bool has_neg = (d1 < 0) || (d2 < 0) || (d3 < 0);
+            bool has_pos = (d1 > 0) || (d2 > 0) || (d3 > 0);
+            return !(has_neg && has_pos);
+        }
+
+        static std::vector<sgp_triangle> triangulate_polygon(const std::vector<sgp_point> &polygon)
+        {
+            std::vector<sgp_triangle> triangles;
+            std::vector<int> indices;
+            triangulate_polygon(polygon, triangles, indices);
+
+            return triangles;
+        }
+
+        /**
+         * @brief Triangulate a simple polygon by naive ear clipping, appending the triangles to out
+         *
+         * This is O(n^3) in the worst case and expects a clockwise polygon (in screen coordinates), it is
+         * kept as a fallback for ear_clipper.
+         *
+         * @param polygon The polygon points
+         * @param out The triangles are appended here, nothing is appended if the triangulation fails
+         * @param indices Scratch buffer for the remaining polygon indices
+         */
+        static void triangulate_polygon(const std::vector<sgp_point> &polygon, std::vector<sgp_triangle> &out, std::vector<int> &indices)
+        {
+            int n = polygon.size();
+            if (n < 3)
+                return;
+
+            size_t first_triangle = out.size();
+
+            indices.resize(n);
+            for (int i = 0; i < n; ++i)
+                indices[i] = i;
+
+            while (indices.size() > 3)
+            {
+                bool ear_found = false;
+                for (size_t i = 0; i < indices.size(); ++i)
+                {
+                    int prev = indices[(i + indices.size() - 1) % indices.size()];
+                    int curr = indices[i];
+                    int next = indices[(i + 1) % indices.size()];
+
+                    sgp_point a = polygon[prev];
+                    sgp_point b = polygon[curr];
+                    sgp_point c = polygon[next];
+
+                    if (!is_convex(a, b, c))
+                        continue;
+
+                    sgp_triangle ear = {a, b, c};
+                    bool contains_point = false;
+                    for (int j : indices)
+                    {
+                        if (j == prev || j == curr || j == next)
+                            continue;
+                        if (point_in_triangle(polygon[j], ear))
+                        {
+                            contains_point = true;
+                            break;
+                        }
+                    }
+
+                    if (!contains_point)
+                    {
+                        out.push_back(ear);
+                        indices.erase(indices.begin() + i);
+                        ear_found = true;
+                        break;
+                    }
+                }
+
+                if (!ear_found)
+                {
+                    out.resize(first_triangle); // Fallback in case of failure
+                    return;
+                }
+            }
+
+            // Triangolo finale
+            if (indices.size() == 3)
+            {
+                out.push_back({polygon[indices[0]], polygon[indices[1]], polygon[indices[2]]});
+            }
+        }
+
+    protected:
+        std::vector<sgp_point> _points;
+        bool _closed = false;
+    };
+}
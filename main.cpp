@@ -3,6 +3,7 @@
 // Includes Sokol GFX, Sokol GP and Sokol APP, doing all implementations.
 #define SOKOL_IMPL
 #define SOKOL_GLES3
+#define STB_IMAGE_IMPLEMENTATION
 
 #include "sokol_app.h"
 #include "sokol_log.h"
@@ -12,6 +13,13 @@
 #include <iostream>
 #include <cstdlib>
 #include <cmath>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+// Keeps the last frame, the static scene is drawn once and presented again on next frames.
+static std::unique_ptr<io2d::redraw_target> redraw;
 
 void test_arc_to(io2d::canvas& c)
 {
@@ -44,6 +52,365 @@ void test_arc_to(io2d::canvas& c)
     c.fill();
 }
 
+void test_cached_path(io2d::canvas& c)
+{
+    // Tessellated once, then redrawn every frame from the cached vertices
+    static io2d::cached_path widgets;
+    static bool widgets_built = false;
+
+    if (!widgets_built)
+    {
+        c.begin_path();
+        for (int i = 0; i < 8; i++)
+        {
+            float x = 550.0f + (i % 4) * 50.0f;
+            float y = 50.0f + (i / 4) * 50.0f;
+            c.roundrect(sgp_point{x, y}, sgp_point{x + 40.0f, y + 40.0f}, 8.0f, 8.0f);
+        }
+        widgets = c.make_cached_path();
+        widgets_built = true;
+    }
+
+    c.fill_style.color = io2d::rgba_color(0xffe9edc9);
+    c.stroke_style.width = 2.0f;
+    c.stroke_style.color = io2d::rgba_color(0xffd4a373);
+    c.draw(widgets);
+
+    // Same vertices, moved down by a transformation
+    sgp_mat2x3 t = io2d::mat2x3_identity();
+    t.v[1][2] = 120.0f;
+    c.draw(widgets, t);
+}
+
+void test_fill_rule(io2d::canvas& c)
+{
+    // Self-intersecting star, the center is a hole with evenodd and filled with nonzero
+    for (int r = 0; r < 2; r++)
+    {
+        float cx = 600.0f + r * 120.0f;
+        float cy = 380.0f;
+
+        c.begin_path();
+        for (int i = 0; i < 5; i++)
+        {
+            float a = -M_PI_2 + i * 4.0f * M_PI / 5.0f;
+            sgp_point p{cx + 50.0f * std::cos(a), cy + 50.0f * std::sin(a)};
+            if (i == 0)
+                c.move_to(p);
+            else
+                c.line_to(p);
+        }
+        c.close_path();
+
+        c.fill_style.color = io2d::rgba_color(0xffccd5ae);
+        c.fill(r == 0 ? io2d::fill_rule::nonzero : io2d::fill_rule::evenodd);
+    }
+}
+
+void test_batches(io2d::canvas& c)
+{
+    // A small scatter plot: one quad per point instead of a tessellated path per point
+    static std::vector<io2d::rect_instance> bars;
+    static std::vector<io2d::circle_instance> dots;
+    if (dots.empty())
+    {
+        for (int i = 0; i < 40; i++)
+        {
+            float x = 560.0f + i * 5.0f;
+            float y = 520.0f - 40.0f * std::sin(i * 0.3f);
+            bars.push_back({sgp_rect{x - 1.0f, y, 2.0f, 560.0f - y}, io2d::rgba_color(0xffe9edc9)});
+            dots.push_back({sgp_point{x, y}, 2.5f, io2d::rgba_color(0xffd4a373)});
+        }
+    }
+
+    c.draw_rects(bars);
+    sgp_set_blend_mode(SGP_BLENDMODE_BLEND);
+    c.draw_circles(dots);
+    sgp_reset_blend_mode();
+}
+
+void test_transform(io2d::canvas& c)
+{
+    // One blade tessellated once, drawn 8 times with a different rotation
+    static io2d::cached_path blade;
+    static bool blade_built = false;
+
+    if (!blade_built)
+    {
+        c.begin_path();
+        c.move_to(sgp_point{0.0f, 0.0f});
+        c.line_to(sgp_point{50.0f, -8.0f});
+        c.arc_to(sgp_point{60.0f, 0.0f}, sgp_point{50.0f, 8.0f}, 6.0f);
+        c.line_to(sgp_point{50.0f, 8.0f});
+        c.close_path();
+        blade = c.make_cached_path();
+        blade_built = true;
+    }
+
+    c.save();
+    c.translate(1060.0f, 150.0f);
+    c.fill_style.color = io2d::rgba_color(0xffe9edc9);
+    c.stroke_style.width = 2.0f;
+    c.stroke_style.color = io2d::rgba_color(0xffd4a373);
+    for (int i = 0; i < 8; i++)
+    {
+        c.draw(blade);
+        c.rotate(M_PI / 4.0f);
+    }
+    c.restore();
+}
+
+void test_sdf_shapes(io2d::canvas& c)
+{
+    // Antialiased without MSAA, each shape is a single quad
+    sgp_set_blend_mode(SGP_BLENDMODE_BLEND);
+    c.fill_style.color = io2d::rgba_color(0xffe9edc9);
+    c.stroke_style.color = io2d::rgba_color(0xffd4a373);
+    c.stroke_style.width = 3.0f;
+    c.draw_ellipse(sgp_point{820, 330}, sgp_point{940, 430});
+    c.draw_roundrect(sgp_point{820, 450}, sgp_point{940, 520}, 16.0f, 10.0f);
+
+    c.stroke_style.cap = io2d::line_cap::round;
+    c.stroke_style.width = 6.0f;
+    c.draw_line(sgp_point{820, 560}, sgp_point{940, 590});
+    c.stroke_style.cap = io2d::line_cap::butt;
+    sgp_reset_blend_mode();
+}
+
+void test_images(io2d::canvas& c)
+{
+    // Icons packed into one atlas page, all of them are drawn by a single textured draw
+    static std::vector<uint32_t> icons;
+    if (icons.empty())
+    {
+        constexpr int size = 24;
+        std::vector<uint8_t> pixels(size * size * 4);
+        for (int i = 0; i < 12; i++)
+        {
+            for (int y = 0; y < size; y++)
+            {
+                for (int x = 0; x < size; x++)
+                {
+                    float dx = x + 0.5f - size * 0.5f, dy = y + 0.5f - size * 0.5f;
+                    float d = std::sqrt(dx * dx + dy * dy) / (size * 0.5f);
+                    uint8_t *p = &pixels[(y * size + x) * 4];
+                    p[0] = (uint8_t)(80 + i * 14);
+                    p[1] = (uint8_t)(200 - y * 4);
+                    p[2] = (uint8_t)(120 + x * 4);
+                    p[3] = d < 1.0f ? 255 : 0;
+                }
+            }
+            icons.push_back(io2d::image_atlas::get_default().add(pixels.data(), size, size));
+        }
+    }
+
+    sgp_set_blend_mode(SGP_BLENDMODE_BLEND);
+    for (size_t i = 0; i < icons.size(); i++)
+        c.draw_image(icons[i], sgp_point{1000.0f + (i % 4) * 34.0f, 300.0f + (i / 4) * 34.0f});
+    c.draw_image(icons[0], sgp_rect{1000.0f, 410.0f, 64.0f, 64.0f});
+    sgp_reset_blend_mode();
+}
+
+void test_gradients(io2d::canvas& c)
+{
+    // The gradients are evaluated per pixel, each shape has the vertices of a solid fill
+    static io2d::gradient linear = io2d::gradient::linear({1000, 0}, {1100, 0});
+    static io2d::gradient radial = io2d::gradient::radial({1145, 545}, 4, {1150, 550}, 40);
+    static io2d::gradient conic = io2d::gradient::conic(0.0f, {1230, 550});
+    if (linear.stops.empty())
+    {
+        linear.add_color_stop(0.0f, io2d::rgba_color(0xffff0000));
+        linear.add_color_stop(0.5f, io2d::rgba_color(0xffffff00));
+        linear.add_color_stop(1.0f, io2d::rgba_color(0xff0000ff));
+        radial.add_color_stop(0.0f, io2d::rgba_color(0xffffffff));
+        radial.add_color_stop(1.0f, io2d::rgba_color(0xff008040));
+        for (int i = 0; i <= 6; i++)
+            conic.add_color_stop(i / 6.0f, io2d::rgba_color(i % 2 ? 0xff2060ff : 0xffff6020));
+    }
+
+    c.fill_style.gradient = &linear;
+    c.begin_path();
+    c.rectangle({1000, 510}, {1100, 590});
+    c.fill();
+
+    c.fill_style.gradient = &radial;
+    c.begin_path();
+    c.ellipse({1110, 510}, {1190, 590});
+    c.fill();
+
+    c.fill_style.gradient = &conic;
+    c.stroke_style.gradient = &linear;
+    c.stroke_style.width = 6;
+    c.begin_path();
+    c.ellipse({1200, 520}, {1260, 580});
+    c.fill();
+    c.stroke();
+
+    c.fill_style.gradient = nullptr;
+    c.stroke_style.gradient = nullptr;
+    c.stroke_style.width = 1;
+}
+
+void test_dashes(io2d::canvas& c)
+{
+    // Dashes cut on the CPU, with round caps
+    c.stroke_style.color = io2d::rgba_color(0xff264653);
+    c.stroke_style.width = 4.0f;
+    c.stroke_style.cap = io2d::line_cap::round;
+    c.stroke_style.set_line_dash({12, 8, 0, 8});
+    c.begin_path();
+    c.move_to({1000, 620});
+    c.line_to({1080, 690});
+    c.line_to({1120, 620});
+    c.stroke();
+    c.stroke_style.cap = io2d::line_cap::butt;
+
+    // Marching ants: the cached selection is tessellated once, only the dash offset changes
+    static io2d::cached_path selection = []
+    {
+        io2d::path p;
+        p.rectangle({1140, 615}, {1255, 695});
+        return io2d::cached_path(p);
+    }();
+    c.stroke_style.color = io2d::rgba_color(0xff000000);
+    c.stroke_style.width = 1.0f;
+    c.stroke_style.set_line_dash({6, 4}, -(float)(sapp_frame_count() % 10));
+    c.stroke(selection);
+    c.stroke_style.set_line_dash({});
+}
+
+void test_curves(io2d::canvas& c)
+{
+    // An icon made of cubic curves, flattened once and cached like an imported SVG path
+    static io2d::cached_path heart = []
+    {
+        io2d::path p;
+        p.move_to({860, 700});
+        p.bezier_curve_to({800, 660}, {810, 610}, {840, 612});
+        p.bezier_curve_to({852, 613}, {860, 625}, {860, 632});
+        p.bezier_curve_to({860, 625}, {868, 613}, {880, 612});
+        p.bezier_curve_to({910, 610}, {920, 660}, {860, 700});
+        p.close_path();
+        return io2d::cached_path(p);
+    }();
+    c.fill_style.color = io2d::rgba_color(0xffe76f51);
+    c.stroke_style.color = io2d::rgba_color(0xff264653);
+    c.stroke_style.width = 2.0f;
+    c.draw(heart);
+
+    // A wave of quadratic curves, flattened on every draw
+    c.begin_path();
+    c.move_to({930, 655});
+    for (int i = 0; i < 4; i++)
+        c.quadratic_curve_to({940.0f + i * 20.0f, i % 2 ? 695.0f : 615.0f}, {950.0f + i * 20.0f, 655});
+    c.stroke_style.width = 3.0f;
+    c.stroke();
+}
+
+void test_static_geometry(io2d::canvas& c)
+{
+    // A floor plan uploaded once into a vertex buffer of packed vertices, they are never copied again
+    static io2d::static_geometry plan;
+    if (plan.empty())
+    {
+        io2d::path rooms;
+        io2d::path walls;
+        for (int i = 0; i < 6; i++)
+        {
+            float x = 420.0f + (i % 3) * 120.0f;
+            float y = 610.0f + (i / 3) * 45.0f;
+            rooms.rectangle({x, y}, {x + 120.0f, y + 45.0f});
+            walls.move_to({x + 50.0f, y});
+            walls.line_to({x, y});
+            walls.line_to({x, y + 45.0f});
+            walls.line_to({x + 120.0f, y + 45.0f});
+        }
+        io2d::fill_style_s floor;
+        floor.color = io2d::rgba_color(0xffedede9);
+        io2d::stroke_style_s wall(io2d::rgba_color(0xff6b705c));
+        wall.width = 4.0f;
+        wall.cap = io2d::line_cap::square;
+        plan.add_fill(rooms, floor);
+        plan.add_stroke(walls, wall);
+        plan.upload(io2d::vertex_format::packed);
+    }
+
+    c.draw(plan);
+}
+
+// A live chart recorded by an ingest thread, the frame callback only replays its last frame
+static io2d::display_list_pipeline ingest;
+static std::atomic<bool> ingest_running{false};
+static std::thread ingest_thread;
+static uint64_t ingest_shown = 0;
+
+static void record_ingest()
+{
+    io2d::path background;
+    background.rectangle({20, 615}, {400, 695});
+    io2d::path samples;
+    for (uint64_t tick = 0; ingest_running; tick++)
+    {
+        samples.begin();
+        for (int i = 0; i <= 76; i++)
+        {
+            float t = (tick + i) * 0.15f;
+            sgp_point pt = {20.0f + i * 5.0f, 655.0f - 30.0f * std::sin(t) * std::cos(t * 0.23f)};
+            if (i == 0)
+                samples.move_to(pt);
+            else
+                samples.line_to(pt);
+        }
+
+        io2d::display_list &l = ingest.begin_recording();
+        l.fill_style.color = io2d::rgba_color(0xffedede9);
+        l.fill(background);
+        l.stroke_style.color = io2d::rgba_color(0xff2a9d8f);
+        l.stroke_style.width = 2.0f;
+        l.stroke_style.join = io2d::line_join::round;
+        l.stroke(samples);
+        ingest.end_recording();
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(16));
+    }
+}
+
+void test_display_list(io2d::canvas& c)
+{
+    c.draw(ingest);
+}
+
+void test_clip(io2d::canvas& c)
+{
+    // Round the corners of the live chart through the stencil, the grid lines drawn over it
+    // span the whole window and are clipped with it
+    c.save();
+    c.begin_path();
+    c.roundrect({20, 615}, {400, 695}, 12.0f, 12.0f);
+    c.clip();
+    test_display_list(c);
+    c.begin_path();
+    for (int i = 1; i < 4; i++)
+        c.line({0.0f, 615.0f + i * 20.0f}, {1280.0f, 615.0f + i * 20.0f});
+    c.stroke_style.width = 1.0f;
+    c.stroke_style.color = io2d::rgba_color(0xffd6d6cf);
+    c.stroke();
+    c.restore();
+}
+
+void test_text(io2d::canvas& c)
+{
+    // Captions of the live chart, their glyphs and layouts are cached after the first frame
+    c.fill_style.color = io2d::rgba_color(0xff264653);
+    c.text_style.size = 16.0f;
+    c.text_style.baseline = io2d::text_baseline::top;
+    c.fill_text("Ingest", {26, 620});
+    c.text_style.size = 8.0f;
+    c.text_style.align = io2d::text_align::right;
+    c.fill_text("display list, 60 Hz", {394, 620});
+    c.text_style = io2d::text_style_s();
+}
+
 // Called on every frame of the application.
 static void frame(void)
 {
@@ -51,7 +418,24 @@ static void frame(void)
     int width = sapp_width(), height = sapp_height();
     float ratio = width / (float)height;
 
-    io2d::canvas c(width, height);
+#ifdef IO2D_STATS
+    // The overlay changes on every frame
+    redraw->invalidate();
+#endif
+    // The marching ants of test_dashes() move on every frame
+    redraw->invalidate(sgp_rect{1135, 610, 125, 90});
+    // The ingest thread has published a new frame of its chart
+    if (ingest.version() != ingest_shown)
+    {
+        ingest_shown = ingest.version();
+        redraw->invalidate(sgp_rect{20, 615, 380, 80});
+    }
+    // Images decoded in the background appear once they are packed
+    if (io2d::image_atlas::get_default().update())
+        redraw->invalidate();
+    io2d::canvas c(*redraw, width, height);
+    if (!c.redraw_needed())
+        return;
 
     c.fill_style.color = io2d::rgba_color(0xfffefae0);
     c.clear();
@@ -81,6 +465,22 @@ static void frame(void)
     c.stroke();
 
     test_arc_to(c);
+    test_cached_path(c);
+    test_fill_rule(c);
+    test_batches(c);
+    test_sdf_shapes(c);
+    test_transform(c);
+    test_images(c);
+    test_gradients(c);
+    test_dashes(c);
+    test_curves(c);
+    test_static_geometry(c);
+    test_clip(c);
+    test_text(c);
+
+#ifdef IO2D_STATS
+    c.draw_stats_overlay(sgp_point{10, 10});
+#endif
 }    
 
 // Called when the application is initializing.
@@ -98,7 +498,8 @@ static void init(void)
         std::exit(EXIT_FAILURE);
     }
 
-    // Initialize Sokol GP, adjust the size of command buffers for your own use.
+    // Initialize Sokol GP with the default buffer sizes, the canvas grows them between frames
+    // when a frame needs more, see io2d::sgp_usage.
     sgp_desc sgpdesc = {0};
     sgp_setup(&sgpdesc);
     if (!sgp_is_valid())
@@ -106,12 +507,21 @@ static void init(void)
         std::cerr << "Failed to create Sokol GP context: " << sgp_get_error_message(sgp_get_last_error()) << std::endl;
         std::exit(EXIT_FAILURE);
     }
+
+    redraw = std::make_unique<io2d::redraw_target>();
+
+    ingest_running = true;
+    ingest_thread = std::thread(record_ingest);
 }
 
 // Called when the application is shutting down.
 static void cleanup(void)
 {
+    ingest_running = false;
+    ingest_thread.join();
+
     // Cleanup Sokol GP and Sokol GFX resources.
+    redraw.reset();
     sgp_shutdown();
     sg_shutdown();
 }
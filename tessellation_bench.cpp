@@ -0,0 +1,244 @@
+// CPU only benchmark of the io2d tessellation helpers. It includes io2d_geometry.h alone, so it
+// does not need sokol_gfx nor a GPU and can be run under perf or VTune.
+//
+// Usage: io2d_tessellation_bench [filter] [min_ms]
+//   filter  Run only the cases whose name contains this string
+//   min_ms  Minimum time spent measuring each case, 200 ms by default
+
+#include "io2d_geometry.h"
+
+#include <iostream>
+#include <iomanip>
+#include <functional>
+#include <memory>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
+
+struct bench_case
+{
+    std::string name;
+    std::string params;
+    std::function<size_t()> run; // Returns the size of the output, so it is not optimized away
+};
+
+// Regular polygon, or a star when inner_radius differs from the radius. The winding is the one
+// expected by sub_path::triangulate_polygon().
+static std::vector<sgp_point> make_polygon(int count, float radius, float inner_radius)
+{
+    std::vector<sgp_point> points(count);
+    for (int i = 0; i < count; i++)
+    {
+        float a = -2.0f * static_cast<float>(M_PI) * i / count;
+        float r = (i & 1) ? inner_radius : radius;
+        points[i] = sgp_point{500.0f + std::cos(a) * r, 500.0f + std::sin(a) * r};
+    }
+    return points;
+}
+
+static std::vector<bench_case> make_cases()
+{
+    std::vector<bench_case> cases;
+
+    for (int count : {1000, 10000})
+    {
+        std::vector<sgp_point> points = make_polygon(count, 300.0f, 300.0f);
+        std::string params = "segments=" + std::to_string(count);
+
+        cases.push_back({"thick_line_points", params, [points]()
+                         {
+                             sgp_point quad[4];
+                             size_t n = 0;
+                             for (size_t i = 1; i < points.size(); i++)
+                             {
+                                 io2d::path_line::get_thick_line_points(points[i - 1], points[i], 4.0f, quad);
+                                 n += quad[2].x > 0.0f;
+                             }
+                             return n;
+                         }});
+        cases.push_back({"thick_line_points_vector", params, [points]()
+                         {
+                             size_t n = 0;
+                             for (size_t i = 1; i < points.size(); i++)
+                                 n += io2d::path_line::get_thick_line_points(points[i - 1], points[i], 4.0f).size();
+                             return n;
+                         }});
+
+        io2d::stroke_style_s style;
+        style.width = 4.0f;
+        cases.push_back({"stroke_polyline", params, [points, style, t = std::make_shared<io2d::tessellator>()]()
+                         {
+                             t->output.clear();
+                             io2d::stroker::stroke_polyline(points.data(), points.size(), false, style, t->output.triangles, *t);
+                             return t->output.triangles.size();
+                         }});
+        style.set_line_dash({8.0f, 4.0f});
+        cases.push_back({"stroke_dashed", params, [points, style, t = std::make_shared<io2d::tessellator>()]()
+                         {
+                             t->output.clear();
+                             io2d::stroker::stroke_dashed(points.data(), points.size(), false, style, t->output, *t);
+                             return t->output.triangles.size();
+                         }});
+    }
+
+    for (float radius : {4.0f, 40.0f, 400.0f})
+    {
+        sgp_point start = {100.0f, 100.0f};
+        sgp_point end = {100.0f + radius * 2.0f, 100.0f + radius};
+        std::string params = "radius=" + std::to_string(static_cast<int>(radius));
+
+        cases.push_back({"ellipse_points", params, [start, end]()
+                         { return io2d::path_ellipse::get_ellipse_points(start, end).size(); }});
+        cases.push_back({"ellipse_points_append", params, [start, end, points = std::vector<sgp_point>()]() mutable
+                         {
+                             points.clear();
+                             io2d::path_ellipse::append_ellipse_points(start, end, 0.0f, M_PI * 2, points);
+                             return points.size();
+                         }});
+        cases.push_back({"ellipse_triangles", params, [start, end]()
+                         { return io2d::path_ellipse::get_ellipse_triangles(start, end).size(); }});
+    }
+
+    for (float radius : {5.0f, 50.0f, 500.0f})
+    {
+        sgp_point p0 = {0.0f, 0.0f};
+        sgp_point p1 = {2000.0f, 0.0f};
+        sgp_point p2 = {2000.0f, 2000.0f};
+        std::string params = "radius=" + std::to_string(static_cast<int>(radius));
+
+        cases.push_back({"arc_to_points", params, [p0, p1, p2, radius]()
+                         { return io2d::sub_path::get_arc_to_points(p0, p1, p2, radius).size(); }});
+    }
+
+    for (float size : {20.0f, 200.0f, 2000.0f})
+    {
+        sgp_point p0 = {0.0f, 0.0f};
+        sgp_point p1 = {0.0f, size};
+        sgp_point p2 = {size, size};
+        sgp_point p3 = {size, 0.0f};
+        std::string params = "size=" + std::to_string(static_cast<int>(size));
+
+        cases.push_back({"quadratic_points", params, [p0, p1, p2, points = std::vector<sgp_point>()]() mutable
+                         {
+                             points.clear();
+                             io2d::sub_path::append_quadratic_points(p0, p1, p2, points);
+                             return points.size();
+                         }});
+        cases.push_back({"cubic_points", params, [p0, p1, p2, p3, points = std::vector<sgp_point>()]() mutable
+                         {
+                             points.clear();
+                             io2d::sub_path::append_cubic_points(p0, p1, p2, p3, points);
+                             return points.size();
+                         }});
+    }
+
+    for (int count : {16, 256, 1024})
+    {
+        for (bool concave : {false, true})
+        {
+            std::vector<sgp_point> polygon = make_polygon(count, 400.0f, concave ? 200.0f : 400.0f);
+            std::string params = std::string(concave ? "concave" : "convex") + " points=" + std::to_string(count);
+
+            cases.push_back({"triangulate_polygon", params, [polygon]()
+                             { return io2d::sub_path::triangulate_polygon(polygon).size(); }});
+            cases.push_back({"ear_clipper", params, [polygon, ears = io2d::ear_clipper(), out = std::vector<sgp_triangle>()]() mutable
+                             {
+                                 out.clear();
+                                 ears.triangulate(polygon.data(), polygon.size(), out);
+                                 return out.size();
+                             }});
+        }
+    }
+
+    for (int count : {10000, 200000})
+    {
+        // Boxes of 2 to 12 units spread over a square holding about one box per 100 square units
+        auto grid = std::make_shared<io2d::spatial_grid>(16.0f);
+        auto boxes = std::make_shared<std::vector<io2d::aabb>>();
+        float side = std::sqrt(count * 100.0f);
+        uint32_t state = 11;
+        auto random = [&state]()
+        {
+            state = state * 1664525u + 1013904223u;
+            return (state >> 8) * (1.0f / 16777216.0f);
+        };
+        for (int i = 0; i < count; i++)
+        {
+            float x = random() * side;
+            float y = random() * side;
+            boxes->emplace_back(x, y, x + 2.0f + random() * 10.0f, y + 2.0f + random() * 10.0f);
+            grid->insert(boxes->back());
+        }
+        std::string params = "boxes=" + std::to_string(count);
+        io2d::aabb view(side * 0.5f, side * 0.5f, side * 0.5f + 320.0f, side * 0.5f + 180.0f);
+
+        cases.push_back({"spatial_grid_point", params, [grid, side, i = 0]() mutable
+                         {
+                             size_t n = 0;
+                             float t = (i++ % 1000) * 0.001f;
+                             grid->query(sgp_point{side * t, side * (1.0f - t)}, [&n](uint32_t)
+                                         { n++; });
+                             return n + 1;
+                         }});
+        cases.push_back({"spatial_grid_view", params, [grid, view]()
+                         {
+                             size_t n = 0;
+                             grid->query(view, [&n](uint32_t)
+                                         { n++; });
+                             return n;
+                         }});
+        cases.push_back({"linear_scan_view", params, [boxes, view]()
+                         {
+                             size_t n = 0;
+                             for (const io2d::aabb &b : *boxes)
+                                 n += b.intersects(view);
+                             return n;
+                         }});
+    }
+
+    return cases;
+}
+
+int main(int argc, char *argv[])
+{
+    std::string filter = argc > 1 ? argv[1] : "";
+    double min_ms = argc > 2 ? std::atof(argv[2]) : 200.0;
+    if (min_ms <= 0.0)
+    {
+        std::cerr << "Usage: io2d_tessellation_bench [filter] [min_ms]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    using clock = std::chrono::steady_clock;
+
+    std::cout << std::left << std::setw(26) << "case" << std::setw(26) << "params" << std::right
+              << std::setw(12) << "calls" << std::setw(14) << "ns/call" << std::setw(10) << "output" << std::endl;
+
+    for (const bench_case &c : make_cases())
+    {
+        if (c.name.find(filter) == std::string::npos)
+            continue;
+
+        // Warm up the caches and the reused containers
+        size_t output = c.run();
+
+        // Double the batch until it lasts long enough for the clock resolution
+        size_t calls = 0;
+        double elapsed_ms = 0.0;
+        for (size_t batch = 1; elapsed_ms < min_ms; batch *= 2)
+        {
+            clock::time_point start = clock::now();
+            for (size_t i = 0; i < batch; i++)
+                output = c.run();
+            elapsed_ms += std::chrono::duration<double, std::milli>(clock::now() - start).count();
+            calls += batch;
+        }
+
+        std::cout << std::left << std::setw(26) << c.name << std::setw(26) << c.params << std::right
+                  << std::setw(12) << calls << std::fixed << std::setprecision(1)
+                  << std::setw(14) << elapsed_ms * 1e6 / calls << std::setw(10) << output << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}